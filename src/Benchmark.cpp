@@ -0,0 +1,512 @@
+/* *****************************************************************************
+** MIT License
+**
+** Copyright (c) 2022 Quentin Quadrat
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+********************************************************************************
+*/
+
+#include "BookmarkLoader.hpp"
+#include "Corpus.hpp"
+#include "IslandedBrowser.hpp"
+#include "LayoutMetrics.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <omp.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#if defined(__GLIBC__)
+#  include <malloc.h>
+#endif
+
+//------------------------------------------------------------------------------
+//! \brief Replace the bookmarks generated from the Firefox export (see
+//! bookmarks/parser.py): the benchmark starts from an empty database and fills
+//! it with synthetic bookmarks.
+void IslandedBrowser::init(Bookmarks& /*bookmarks*/, Folders& /*folders*/)
+{}
+
+// *****************************************************************************
+//! \brief Headless benchmark of the application on synthetic bookmark trees
+//! (see Corpus): no window is opened. For each shape, number of nodes and
+//! number of threads, it times the creation of the graph, the reset of the
+//! layout, a given number of layout steps, the removal of overlaps and
+//! picking, and prints a JSON object per line on the standard output.
+//! Optionally, the quality of the layout (see LayoutMetrics) is sampled every
+//! few steps, out of the timings, to plot the quality against the time spent.
+//! Given a Firefox JSON export, only the loading of the bookmarks is timed.
+// *****************************************************************************
+class Benchmark
+{
+public:
+
+    // *************************************************************************
+    //! \brief Command line options.
+    // *************************************************************************
+    struct Options
+    {
+        std::vector<Corpus::Shape> shapes{ Corpus::Shape::Flat, Corpus::Shape::Deep,
+                                           Corpus::Shape::Balanced, Corpus::Shape::PowerLaw };
+        std::vector<size_t> nodes{ 1000u, 10000u, 100000u };
+        std::vector<size_t> threads;
+        size_t steps = 20u;
+        size_t picks = 1000u;
+        //! \brief Measure the quality every this number of steps (0: never).
+        size_t sample = 0u;
+        uint64_t seed = 1u;
+        ForceDirectedGraph::Repulsion repulsion = ForceDirectedGraph::Repulsion::BarnesHut;
+        ForceDirectedGraph::Leaves leaves = ForceDirectedGraph::Leaves::Simulated;
+        ForceDirectedGraph::Engine engine = ForceDirectedGraph::Engine::Forces;
+        ForceDirectedGraph::ForceModel model = ForceDirectedGraph::ForceModel::FruchtermanReingold;
+        //! \brief Firefox bookmarks exported as JSON file to load (if any).
+        std::string json;
+    };
+
+    //----------------------------------------------------------------------
+    //! \brief Parse the command line.
+    //! \return false on unknown or ill-formed option.
+    //----------------------------------------------------------------------
+    static bool parse(int argc, char* argv[], Options& options);
+
+    //----------------------------------------------------------------------
+    //! \brief Run all the measures described by the options.
+    //----------------------------------------------------------------------
+    static void run(Options const& options);
+
+    //----------------------------------------------------------------------
+    //! \brief Time the loading of the given JSON file and print the result.
+    //! \return false if the file cannot be loaded.
+    //----------------------------------------------------------------------
+    static bool load(std::string const& path);
+
+private:
+
+    //----------------------------------------------------------------------
+    //! \brief Time each stage on the given corpus and print the results.
+    //----------------------------------------------------------------------
+    static void measure(IslandedBrowser& browser, Options const& options,
+                        Corpus::Shape const shape, size_t const threads,
+                        std::vector<Folder> const& folders,
+                        std::vector<Bookmark> const& bookmarks,
+                        double const generation);
+
+    //----------------------------------------------------------------------
+    //! \brief Milliseconds elapsed since the given time point.
+    //----------------------------------------------------------------------
+    static double elapsed(std::chrono::steady_clock::time_point const& start)
+    {
+        return std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Start a new measure of the peak resident set size: on Linux,
+    //! writing 5 to /proc/self/clear_refs lowers the high water mark to the
+    //! current resident set size. Elsewhere the peak stays the one of the
+    //! whole process. Forking a process per measure is not an option: the
+    //! OpenMP runtime of GCC hangs in the child once the parent used it.
+    //----------------------------------------------------------------------
+    static void reset_peak_rss()
+    {
+#if defined(__GLIBC__)
+        // Give the memory freed by previous measures back to the system
+        malloc_trim(0u);
+#endif
+        FILE* file = fopen("/proc/self/clear_refs", "w");
+        if (file != nullptr)
+        {
+            fputs("5", file);
+            fclose(file);
+        }
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Peak resident set size in kilobytes since the last call to
+    //! reset_peak_rss() (VmHWM of /proc/self/status), or since the start of
+    //! the process when not available. Memory still held from previous
+    //! measures is included.
+    //----------------------------------------------------------------------
+    static long peak_rss()
+    {
+        long peak = -1;
+        FILE* file = fopen("/proc/self/status", "r");
+        if (file != nullptr)
+        {
+            char line[256];
+            while ((peak < 0) && (fgets(line, sizeof(line), file) != nullptr))
+            {
+                if (sscanf(line, "VmHWM: %ld kB", &peak) != 1)
+                    peak = -1;
+            }
+            fclose(file);
+        }
+        if (peak >= 0)
+            return peak;
+
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss;
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Names of the layout settings, as given on the command line.
+    //----------------------------------------------------------------------
+    static const char* name(ForceDirectedGraph::Repulsion const mode)
+    {
+        static const char* names[] = { "exact", "barnes-hut", "simd", "cell-list" };
+        return names[size_t(mode)];
+    }
+
+    static const char* name(ForceDirectedGraph::Leaves const mode)
+    {
+        return (mode == ForceDirectedGraph::Leaves::Fans) ? "fans" : "simulated";
+    }
+
+    static const char* name(ForceDirectedGraph::Engine const mode)
+    {
+        return (mode == ForceDirectedGraph::Engine::Stress) ? "stress" : "forces";
+    }
+
+    static const char* name(ForceDirectedGraph::ForceModel const laws)
+    {
+        static const char* names[] = { "fr", "forceatlas2", "linlog" };
+        return names[size_t(laws)];
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Parse a comma separated list of numbers.
+    //----------------------------------------------------------------------
+    static bool numbers(const char* text, std::vector<size_t>& values);
+};
+
+//------------------------------------------------------------------------------
+bool Benchmark::numbers(const char* text, std::vector<size_t>& values)
+{
+    values.clear();
+    while (*text != '\0')
+    {
+        char* end;
+        const unsigned long long value = strtoull(text, &end, 10);
+        if ((end == text) || ((*end != ',') && (*end != '\0')))
+            return false;
+        values.push_back(size_t(value));
+        text = (*end == ',') ? end + 1 : end;
+    }
+    return !values.empty();
+}
+
+//------------------------------------------------------------------------------
+bool Benchmark::parse(int argc, char* argv[], Options& options)
+{
+    using Layout = ForceDirectedGraph;
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        const char* value = strchr(arg, '=');
+        if (value == nullptr)
+            return false;
+        const std::string key(arg, size_t(value - arg));
+        const std::string text(++value);
+
+        std::vector<size_t> list;
+        if (key == "--shapes")
+        {
+            options.shapes.clear();
+            size_t start = 0u;
+            while (start <= text.size())
+            {
+                size_t end = text.find(',', start);
+                end = (end == std::string::npos) ? text.size() : end;
+                Corpus::Shape shape;
+                if (!Corpus::parse(text.substr(start, end - start), shape))
+                    return false;
+                options.shapes.push_back(shape);
+                start = end + 1u;
+            }
+        }
+        else if (key == "--nodes")
+        {
+            if (!numbers(value, options.nodes))
+                return false;
+        }
+        else if (key == "--threads")
+        {
+            if (!numbers(value, options.threads))
+                return false;
+        }
+        else if ((key == "--steps") || (key == "--picks") || (key == "--seed") ||
+                 (key == "--sample"))
+        {
+            if (!numbers(value, list) || (list.size() != 1u))
+                return false;
+            if (key == "--steps")
+                options.steps = list[0];
+            else if (key == "--picks")
+                options.picks = list[0];
+            else if (key == "--sample")
+                options.sample = list[0];
+            else
+                options.seed = list[0];
+        }
+        else if (key == "--repulsion")
+        {
+            if (text == "exact")
+                options.repulsion = Layout::Repulsion::Exact;
+            else if (text == "barnes-hut")
+                options.repulsion = Layout::Repulsion::BarnesHut;
+            else if (text == "simd")
+                options.repulsion = Layout::Repulsion::SIMD;
+            else if (text == "cell-list")
+                options.repulsion = Layout::Repulsion::CellList;
+            else
+                return false;
+        }
+        else if (key == "--leaves")
+        {
+            if (text == "simulated")
+                options.leaves = Layout::Leaves::Simulated;
+            else if (text == "fans")
+                options.leaves = Layout::Leaves::Fans;
+            else
+                return false;
+        }
+        else if (key == "--engine")
+        {
+            if (text == "forces")
+                options.engine = Layout::Engine::Forces;
+            else if (text == "stress")
+                options.engine = Layout::Engine::Stress;
+            else
+                return false;
+        }
+        else if (key == "--json")
+        {
+            if (text.empty())
+                return false;
+            options.json = text;
+        }
+        else if (key == "--model")
+        {
+            if (text == "fr")
+                options.model = Layout::ForceModel::FruchtermanReingold;
+            else if (text == "forceatlas2")
+                options.model = Layout::ForceModel::ForceAtlas2;
+            else if (text == "linlog")
+                options.model = Layout::ForceModel::LinLog;
+            else
+                return false;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool Benchmark::load(std::string const& path)
+{
+    IslandedBrowser::Bookmarks bookmarks;
+    IslandedBrowser::Folders folders;
+    BookmarkLoader loader;
+
+    reset_peak_rss();
+    auto const start = std::chrono::steady_clock::now();
+    if (!loader.load(path, bookmarks, folders))
+    {
+        fprintf(stderr, "%s\n", loader.error().c_str());
+        return false;
+    }
+    const double loading = elapsed(start);
+
+    struct stat status;
+    const long long bytes = (stat(path.c_str(), &status) == 0) ? status.st_size : 0;
+    printf("{\"json\": \"%s\", \"bytes\": %lld, \"folders\": %zu, \"bookmarks\": %zu, "
+           "\"load_ms\": %.3f, \"peak_rss_kb\": %ld}\n",
+           path.c_str(), bytes, folders.size(), bookmarks.size(), loading, peak_rss());
+    fflush(stdout);
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void Benchmark::run(Options const& options)
+{
+    // Thread scaling: 1, 2, 4 ... up to all the cores by default
+    std::vector<size_t> threads(options.threads);
+    if (threads.empty())
+    {
+        const size_t cores = size_t(omp_get_max_threads());
+        for (size_t t = 1u; t < cores; t *= 2u)
+        {
+            threads.push_back(t);
+        }
+        threads.push_back(cores);
+    }
+
+    // Each configuration has its own corpus and browser, released before
+    // the next one so that its memory does not weigh on the next peak RSS.
+    for (auto const& shape: options.shapes)
+    {
+        for (auto const& count: options.nodes)
+        {
+            std::vector<Folder> folders;
+            std::vector<Bookmark> bookmarks;
+            auto const start = std::chrono::steady_clock::now();
+            Corpus::generate(shape, count, options.seed, folders, bookmarks);
+            const double generation = elapsed(start);
+
+            for (auto const& t: threads)
+            {
+                // No cache nor snapshot file: each measure lays the graph out
+                // from scratch
+                IslandedBrowser browser(sf::Vector2f(WINDOWS_WIDTH, WINDOWS_HEIGHT), "", "", "");
+                browser.layout().repulsion(options.repulsion);
+                browser.layout().leaves(options.leaves);
+                browser.layout().engine(options.engine);
+                browser.layout().model(options.model);
+                measure(browser, options, shape, t, folders, bookmarks, generation);
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void Benchmark::measure(IslandedBrowser& browser, Options const& options,
+                        Corpus::Shape const shape, size_t const threads,
+                        std::vector<Folder> const& folders,
+                        std::vector<Bookmark> const& bookmarks,
+                        double const generation)
+{
+    omp_set_num_threads(int(threads));
+    reset_peak_rss();
+
+    browser.m_folders.clear();
+    browser.m_bookmarks.clear();
+    for (auto const& folder: folders)
+    {
+        browser.m_folders[int(folder.id)] = folder;
+    }
+    for (auto const& bookmark: bookmarks)
+    {
+        browser.m_bookmarks[int(bookmark.id)] = bookmark;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    browser.createGraph();
+    const double creation = elapsed(start);
+
+    ForceDirectedGraph& layout = browser.m_force_directed;
+    start = std::chrono::steady_clock::now();
+    layout.reset();
+    const double reset = elapsed(start);
+
+    LayoutMetrics<2u> metrics;
+    auto sample = [&](size_t const step, double const time)
+    {
+        auto const begin = std::chrono::steady_clock::now();
+        LayoutMetrics<2u>::Metrics const& m = metrics.measure(layout);
+        printf("{\"shape\": \"%s\", \"nodes\": %zu, \"threads\": %zu, \"step\": %zu, "
+               "\"elapsed_ms\": %.3f, \"stress\": %.5f, \"edge_cv\": %.5f, "
+               "\"overlaps\": %zu, \"crossings\": %zu, \"metrics_ms\": %.3f}\n",
+               Corpus::name(shape), layout.vertices().size(), threads, step, time,
+               double(m.stress), double(m.edge_cv), m.overlaps, m.crossings,
+               elapsed(begin));
+    };
+
+    double stepping = 0.0;
+    size_t steps = 0u;
+    for (; (steps < options.steps) && !layout.converged(); ++steps)
+    {
+        if ((options.sample != 0u) && (steps % options.sample == 0u))
+            sample(steps, stepping);
+
+        start = std::chrono::steady_clock::now();
+        layout.update();
+        stepping += elapsed(start);
+    }
+    if (options.sample != 0u)
+        sample(steps, stepping);
+
+    start = std::chrono::steady_clock::now();
+    const size_t overlapping = layout.separate();
+    const double separation = elapsed(start);
+    if (options.sample != 0u)
+        sample(steps, stepping + separation);
+
+    // Pick at the position of pseudo-random vertices: the linear search
+    // stops at a random rank. Then gather the URLs below the picked node.
+    browser.topology();
+    browser.publish();
+    ForceDirectedGraph::Vertices const& vertices = layout.vertices();
+    uint64_t state = options.seed;
+    size_t hits = 0u, bytes = 0u;
+    start = std::chrono::steady_clock::now();
+    for (size_t p = 0u; (p < options.picks) && !vertices.empty(); ++p)
+    {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        sf::Vector2f const& position = vertices[(state >> 33) % vertices.size()].position;
+        DiGraph::Index node;
+        if (browser.pick(sf::Vector2i(int(position.x), int(position.y)), node))
+        {
+            ++hits;
+            bytes += browser.m_subtrees.urls(node).size();
+        }
+    }
+    const double picking = elapsed(start);
+
+    printf("{\"shape\": \"%s\", \"nodes\": %zu, \"edges\": %zu, \"threads\": %zu, "
+           "\"repulsion\": \"%s\", \"leaves\": \"%s\", \"engine\": \"%s\", \"model\": \"%s\", "
+           "\"generate_ms\": %.3f, \"create_graph_ms\": %.3f, \"reset_ms\": %.3f, "
+           "\"steps\": %zu, \"steps_ms\": %.3f, \"steps_per_sec\": %.3f, "
+           "\"separate_ms\": %.3f, \"overlapping\": %zu, "
+           "\"picks\": %zu, \"hits\": %zu, \"url_bytes\": %zu, \"pick_ms\": %.3f, \"peak_rss_kb\": %ld}\n",
+           Corpus::name(shape), browser.m_digraph.size(), browser.m_digraph.edges(), threads,
+           name(options.repulsion), name(options.leaves), name(options.engine),
+           name(options.model), generation, creation, reset,
+           steps, stepping, (stepping > 0.0) ? 1000.0 * double(steps) / stepping : 0.0,
+           separation, overlapping,
+           options.picks, hits, bytes, picking, peak_rss());
+    fflush(stdout);
+}
+
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    Benchmark::Options options;
+    if (!Benchmark::parse(argc, argv, options))
+    {
+        fprintf(stderr,
+                "Usage: %s [--shapes=flat,deep,balanced,powerlaw] [--nodes=1000,10000,100000]\n"
+                "       [--threads=1,2,4] [--steps=20] [--picks=1000] [--seed=1] [--sample=0]\n"
+                "       [--repulsion=exact|barnes-hut|simd|cell-list]\n"
+                "       [--leaves=simulated|fans] [--engine=forces|stress]\n"
+                "       [--model=fr|forceatlas2|linlog] [--json=bookmarks.json]\n",
+                argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (!options.json.empty())
+        return Benchmark::load(options.json) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+    Benchmark::run(options);
+    return EXIT_SUCCESS;
+}
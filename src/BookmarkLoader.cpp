@@ -0,0 +1,395 @@
+/* *****************************************************************************
+** MIT License
+**
+** Copyright (c) 2022 Quentin Quadrat
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+********************************************************************************
+*/
+
+#include "BookmarkLoader.hpp"
+#include "MappedFile.hpp"
+#include <limits>
+
+static constexpr size_t NONE = std::numeric_limits<size_t>::max();
+
+//------------------------------------------------------------------------------
+bool BookmarkLoader::load(std::string const& path, std::map<int, Bookmark>& bookmarks,
+                          std::map<int, Folder>& folders)
+{
+    MappedFile file(path);
+    if (file.data() == nullptr)
+    {
+        m_error = "Cannot read the bookmarks file " + path;
+        return false;
+    }
+
+    if (!parse(file.data(), file.size(), bookmarks, folders))
+    {
+        m_error = path + ": " + m_error;
+        return false;
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool BookmarkLoader::parse(const char* text, size_t const size,
+                           std::map<int, Bookmark>& bookmarks,
+                           std::map<int, Folder>& folders)
+{
+    m_begin = m_cursor = text;
+    m_end = text + size;
+    m_nodes.clear();
+    m_stack.clear();
+    m_error.clear();
+
+    // The root folder
+    whitespaces();
+    if (!expect('{'))
+        return false;
+    m_nodes.emplace_back();
+    m_nodes.back().parent = NONE;
+    m_stack.push_back({ false, 0u, 0u });
+
+    while (!m_stack.empty())
+    {
+        Frame& frame = m_stack.back();
+        whitespaces();
+        if (m_cursor == m_end)
+            return fail("unexpected end of file");
+
+        // End of the object or array, or separator before the next item
+        const char closing = frame.children ? ']' : '}';
+        if (*m_cursor == closing)
+        {
+            ++m_cursor;
+            m_stack.pop_back();
+            continue ;
+        }
+        if ((frame.count++ != 0u) && !expect(','))
+            return false;
+
+        // Array of children: each object is a node
+        if (frame.children)
+        {
+            whitespaces();
+            if ((m_cursor != m_end) && (*m_cursor == '{'))
+            {
+                ++m_cursor;
+                const size_t parent = frame.node;
+                m_nodes.emplace_back();
+                m_nodes.back().parent = parent;
+                m_stack.push_back({ false, m_nodes.size() - 1u, 0u });
+            }
+            else if (!skip())
+            {
+                return false;
+            }
+            continue ;
+        }
+
+        // Member of a node. Note: frame may be invalidated by push_back.
+        const size_t index = frame.node;
+        if (!string(&m_key) || !expect(':'))
+            return false;
+
+        whitespaces();
+        Node& node = m_nodes[index];
+        const bool null = (m_cursor != m_end) && (*m_cursor == 'n');
+        if (m_key == "id")
+        {
+            if (!integer(node.id))
+                return false;
+            node.has_id = true;
+        }
+        else if ((m_key == "title") && !null)
+        {
+            if (!string(&node.title))
+                return false;
+            node.has_title = true;
+        }
+        else if ((m_key == "uri") && !null)
+        {
+            if (!string(&node.uri))
+                return false;
+            node.has_uri = true;
+        }
+        else if (m_key == "children")
+        {
+            if (!expect('['))
+                return false;
+            node.has_children = true;
+            m_stack.push_back({ true, index, 0u });
+        }
+        else if (!skip())
+        {
+            return false;
+        }
+    }
+
+    // Fill the collections in the order nodes were opened: parents first.
+    for (auto const& node: m_nodes)
+    {
+        if (!node.has_id)
+            return fail("node without identifier");
+    }
+    for (auto& node: m_nodes)
+    {
+        const size_t id = size_t(node.id - 1);
+        const size_t parent = (node.parent == NONE) ? 0u : size_t(m_nodes[node.parent].id - 1);
+        if (node.has_children)
+        {
+            Folder& folder = folders[int(id)];
+            folder.title = std::move(node.title);
+            folder.id = id;
+            folder.parent = parent;
+        }
+        else if (node.has_uri && node.has_title)
+        {
+            Bookmark& bookmark = bookmarks[int(id)];
+            bookmark.title = std::move(node.title);
+            bookmark.uri = std::move(node.uri);
+            bookmark.id = id;
+            bookmark.parent = parent;
+        }
+    }
+    m_nodes.clear();
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void BookmarkLoader::whitespaces()
+{
+    while ((m_cursor != m_end) &&
+           ((*m_cursor == ' ') || (*m_cursor == '\n') || (*m_cursor == '\r') || (*m_cursor == '\t')))
+    {
+        ++m_cursor;
+    }
+}
+
+//------------------------------------------------------------------------------
+bool BookmarkLoader::expect(char const c)
+{
+    whitespaces();
+    if ((m_cursor == m_end) || (*m_cursor != c))
+    {
+        const char expected[] = { '\'', c, '\'', ' ', 'e', 'x', 'p', 'e', 'c', 't', 'e', 'd', '\0' };
+        return fail(expected);
+    }
+    ++m_cursor;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+//! \brief Append the UTF-8 encoding of the given code point.
+static void utf8(std::string& text, uint32_t const code)
+{
+    if (code < 0x80u)
+    {
+        text += char(code);
+    }
+    else if (code < 0x800u)
+    {
+        text += char(0xc0u | (code >> 6));
+        text += char(0x80u | (code & 0x3fu));
+    }
+    else if (code < 0x10000u)
+    {
+        text += char(0xe0u | (code >> 12));
+        text += char(0x80u | ((code >> 6) & 0x3fu));
+        text += char(0x80u | (code & 0x3fu));
+    }
+    else
+    {
+        text += char(0xf0u | (code >> 18));
+        text += char(0x80u | ((code >> 12) & 0x3fu));
+        text += char(0x80u | ((code >> 6) & 0x3fu));
+        text += char(0x80u | (code & 0x3fu));
+    }
+}
+
+//------------------------------------------------------------------------------
+//! \brief Read the 4 hexadecimal digits of an \u escape sequence.
+static bool hexadecimal(const char*& cursor, const char* const end, uint32_t& code)
+{
+    if (end - cursor < 4)
+        return false;
+
+    code = 0u;
+    for (int i = 0; i < 4; ++i, ++cursor)
+    {
+        const char c = *cursor;
+        code <<= 4;
+        if ((c >= '0') && (c <= '9'))
+            code |= uint32_t(c - '0');
+        else if ((c >= 'a') && (c <= 'f'))
+            code |= uint32_t(c - 'a' + 10);
+        else if ((c >= 'A') && (c <= 'F'))
+            code |= uint32_t(c - 'A' + 10);
+        else
+            return false;
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool BookmarkLoader::string(std::string* text)
+{
+    if (!expect('"'))
+        return false;
+    if (text != nullptr)
+        text->clear();
+
+    for (;;)
+    {
+        // Copy the longest run without quote nor escape at once
+        const char* run = m_cursor;
+        while ((m_cursor != m_end) && (*m_cursor != '"') && (*m_cursor != '\\'))
+        {
+            ++m_cursor;
+        }
+        if (text != nullptr)
+            text->append(run, m_cursor);
+
+        if (m_cursor == m_end)
+            return fail("unterminated string");
+        if (*m_cursor++ == '"')
+            return true;
+
+        // Escape sequence
+        if (m_cursor == m_end)
+            return fail("unterminated string");
+        const char c = *m_cursor++;
+        char decoded;
+        switch (c)
+        {
+        case '"': decoded = '"'; break;
+        case '\\': decoded = '\\'; break;
+        case '/': decoded = '/'; break;
+        case 'b': decoded = '\b'; break;
+        case 'f': decoded = '\f'; break;
+        case 'n': decoded = '\n'; break;
+        case 'r': decoded = '\r'; break;
+        case 't': decoded = '\t'; break;
+        case 'u':
+            {
+                uint32_t code;
+                if (!hexadecimal(m_cursor, m_end, code))
+                    return fail("invalid \\u escape sequence");
+
+                // Surrogate pair
+                if ((code >= 0xd800u) && (code < 0xdc00u) && (m_end - m_cursor >= 6) &&
+                    (m_cursor[0] == '\\') && (m_cursor[1] == 'u'))
+                {
+                    const char* low = m_cursor + 2;
+                    uint32_t second;
+                    if (hexadecimal(low, m_end, second) && (second >= 0xdc00u) && (second < 0xe000u))
+                    {
+                        code = 0x10000u + ((code - 0xd800u) << 10) + (second - 0xdc00u);
+                        m_cursor = low;
+                    }
+                }
+                if (text != nullptr)
+                    utf8(*text, code);
+            }
+            continue ;
+        default:
+            return fail("invalid escape sequence");
+        }
+        if (text != nullptr)
+            *text += decoded;
+    }
+}
+
+//------------------------------------------------------------------------------
+bool BookmarkLoader::integer(long long& value)
+{
+    whitespaces();
+    const bool negative = (m_cursor != m_end) && (*m_cursor == '-');
+    if (negative)
+        ++m_cursor;
+
+    const char* digits = m_cursor;
+    value = 0;
+    while ((m_cursor != m_end) && (*m_cursor >= '0') && (*m_cursor <= '9'))
+    {
+        value = value * 10 + (*m_cursor++ - '0');
+    }
+    if (m_cursor == digits)
+        return fail("integer expected");
+    if (negative)
+        value = -value;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool BookmarkLoader::skip()
+{
+    whitespaces();
+    if (m_cursor == m_end)
+        return fail("value expected");
+
+    // Strings may hold brackets
+    if (*m_cursor == '"')
+        return string(nullptr);
+
+    // Scalars: number, true, false or null
+    if ((*m_cursor != '{') && (*m_cursor != '['))
+    {
+        const char* start = m_cursor;
+        while ((m_cursor != m_end) && (*m_cursor != ',') && (*m_cursor != '}') &&
+               (*m_cursor != ']') && (*m_cursor != ' ') && (*m_cursor != '\n') &&
+               (*m_cursor != '\r') && (*m_cursor != '\t'))
+        {
+            ++m_cursor;
+        }
+        return (m_cursor != start) || fail("value expected");
+    }
+
+    // Objects and arrays: only count the nesting depth
+    size_t depth = 0u;
+    do
+    {
+        if (m_cursor == m_end)
+            return fail("unexpected end of file");
+
+        const char c = *m_cursor;
+        if (c == '"')
+        {
+            if (!string(nullptr))
+                return false;
+            continue ;
+        }
+        if ((c == '{') || (c == '['))
+            ++depth;
+        else if ((c == '}') || (c == ']'))
+            --depth;
+        ++m_cursor;
+    } while (depth != 0u);
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool BookmarkLoader::fail(const char* reason)
+{
+    m_error = std::string(reason) + " at byte " + std::to_string(m_cursor - m_begin);
+    return false;
+}
@@ -0,0 +1,129 @@
+/* *****************************************************************************
+** MIT License
+**
+** Copyright (c) 2022 Quentin Quadrat
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+********************************************************************************
+*/
+
+#ifndef BOOKMARKLOADER_HPP
+#  define BOOKMARKLOADER_HPP
+
+#  include "Bookmarks.hpp"
+#  include <map>
+#  include <string>
+#  include <vector>
+
+// *****************************************************************************
+//! \brief Load the bookmarks exported by Firefox as JSON file at runtime (see
+//! https://support.mozilla.org/en-US/kb/restore-bookmarks-from-backup-or-move-them).
+//!
+//! The file is mapped in memory and read once by a streaming tokenizer: no
+//! document tree is built, only the fields of the nodes (id, title, uri and
+//! children) are decoded, other values are skipped. Nodes with children are
+//! folders, nodes with an URI are bookmarks (separators are ignored).
+//! Identifiers follow bookmarks/parser.py: Firefox identifiers minus one, the
+//! root folder being 0 and its own parent.
+// *****************************************************************************
+class BookmarkLoader
+{
+public:
+
+    //----------------------------------------------------------------------
+    //! \brief Parse the given JSON file and add its folders and bookmarks to
+    //! the given collections (replacing the ones with the same identifier).
+    //! \return false if the file cannot be read or is not a valid export. The
+    //! collections are then unchanged and error() tells why.
+    //----------------------------------------------------------------------
+    bool load(std::string const& path, std::map<int, Bookmark>& bookmarks,
+              std::map<int, Folder>& folders);
+
+    //----------------------------------------------------------------------
+    //! \brief Same than load() but parse the JSON text held in memory.
+    //----------------------------------------------------------------------
+    bool parse(const char* text, size_t const size, std::map<int, Bookmark>& bookmarks,
+               std::map<int, Folder>& folders);
+
+    //----------------------------------------------------------------------
+    //! \brief Return the reason of the last failure.
+    //----------------------------------------------------------------------
+    inline std::string const& error() const
+    {
+        return m_error;
+    }
+
+private:
+
+    // *************************************************************************
+    //! \brief Fields of a node, in the order the nodes are opened.
+    // *************************************************************************
+    struct Node
+    {
+        //! \brief Firefox identifier.
+        long long id = 0;
+        //! \brief Index of the parent node in m_nodes (npos for the root).
+        size_t parent;
+        std::string title;
+        std::string uri;
+        bool has_id = false;
+        bool has_title = false;
+        bool has_uri = false;
+        bool has_children = false;
+    };
+
+    // *************************************************************************
+    //! \brief Object or array being read.
+    // *************************************************************************
+    struct Frame
+    {
+        //! \brief Node object, or array of the children of the node.
+        bool children;
+        //! \brief Index of the node in m_nodes.
+        size_t node;
+        //! \brief Number of members or elements already read.
+        size_t count;
+    };
+
+    //! \brief Tokenizer primitives. They advance m_cursor and return false on
+    //! syntax error.
+    void whitespaces();
+    bool expect(char const c);
+    bool string(std::string* text);
+    bool integer(long long& value);
+    bool skip();
+    bool fail(const char* reason);
+
+private:
+
+    //! \brief Text being parsed.
+    const char* m_begin = nullptr;
+    const char* m_cursor = nullptr;
+    const char* m_end = nullptr;
+    //! \brief Nodes read so far.
+    std::vector<Node> m_nodes;
+    //! \brief Objects and arrays being read.
+    std::vector<Frame> m_stack;
+    //! \brief Key of the member being read.
+    std::string m_key;
+    //! \brief Reason of the last failure.
+    std::string m_error;
+};
+
+#endif
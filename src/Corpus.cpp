@@ -0,0 +1,169 @@
+/* *****************************************************************************
+** MIT License
+**
+** Copyright (c) 2022 Quentin Quadrat
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+********************************************************************************
+*/
+
+#include "Corpus.hpp"
+#include <deque>
+
+//------------------------------------------------------------------------------
+//! \brief SplitMix64 generator: same sequence on every platform, contrary to
+//! the distributions of <random>.
+static uint64_t next(uint64_t& state)
+{
+    uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+//------------------------------------------------------------------------------
+static void folder(std::vector<Folder>& folders, size_t const id, size_t const parent)
+{
+    folders.push_back({ "Folder " + std::to_string(id), id, parent });
+}
+
+//------------------------------------------------------------------------------
+static void bookmark(std::vector<Bookmark>& bookmarks, size_t const id, size_t const parent)
+{
+    bookmarks.push_back({ "Bookmark " + std::to_string(id),
+                          "https://example.com/" + std::to_string(id), id, parent });
+}
+
+//------------------------------------------------------------------------------
+const char* Corpus::name(Shape const shape)
+{
+    switch (shape)
+    {
+    case Shape::Flat:
+        return "flat";
+    case Shape::Deep:
+        return "deep";
+    case Shape::Balanced:
+        return "balanced";
+    case Shape::PowerLaw:
+    default:
+        return "powerlaw";
+    }
+}
+
+//------------------------------------------------------------------------------
+bool Corpus::parse(std::string const& name, Shape& shape)
+{
+    for (auto const s: { Shape::Flat, Shape::Deep, Shape::Balanced, Shape::PowerLaw })
+    {
+        if (name == Corpus::name(s))
+        {
+            shape = s;
+            return true;
+        }
+    }
+    return false;
+}
+
+//------------------------------------------------------------------------------
+void Corpus::generate(Shape const shape, size_t const count, uint64_t const seed,
+                      std::vector<Folder>& folders, std::vector<Bookmark>& bookmarks)
+{
+    folders.clear();
+    bookmarks.clear();
+    if (count == 0u)
+        return ;
+
+    folder(folders, 0u, 0u);
+    size_t id = 1u;
+    switch (shape)
+    {
+    case Shape::Flat:
+        for (; id < count; ++id)
+        {
+            bookmark(bookmarks, id, 0u);
+        }
+        break;
+
+    case Shape::Deep:
+    {
+        size_t parent = 0u;
+        size_t depth = 0u;
+        while (id < count)
+        {
+            for (size_t b = 0u; (b < BOOKMARKS_PER_FOLDER) && (id < count); ++b)
+            {
+                bookmark(bookmarks, id++, parent);
+            }
+            if (id < count)
+            {
+                depth = (depth < MAX_DEPTH) ? depth + 1u : 1u;
+                folder(folders, id, (depth == 1u) ? 0u : parent);
+                parent = id++;
+            }
+        }
+        break;
+    }
+
+    case Shape::Balanced:
+    {
+        // Breadth first: the tree is complete up to its last level
+        std::deque<size_t> queue{ 0u };
+        while (id < count)
+        {
+            const size_t parent = queue.front();
+            queue.pop_front();
+            for (size_t b = 0u; (b < BOOKMARKS_PER_FOLDER) && (id < count); ++b)
+            {
+                bookmark(bookmarks, id++, parent);
+            }
+            for (size_t f = 0u; (f < FOLDERS_PER_FOLDER) && (id < count); ++f)
+            {
+                folder(folders, id, parent);
+                queue.push_back(id++);
+            }
+        }
+        break;
+    }
+
+    case Shape::PowerLaw:
+    default:
+    {
+        // Each folder appears once plus once per child: drawing a slot
+        // uniformly draws a folder proportionally to its children plus one.
+        uint64_t state = seed;
+        std::vector<size_t> slots{ 0u };
+        for (; id < count; ++id)
+        {
+            const size_t parent = slots[next(state) % slots.size()];
+            if (next(state) % FOLDER_RATIO == 0u)
+            {
+                folder(folders, id, parent);
+                slots.push_back(id);
+            }
+            else
+            {
+                bookmark(bookmarks, id, parent);
+            }
+            slots.push_back(parent);
+        }
+        break;
+    }
+    }
+}
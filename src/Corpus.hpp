@@ -0,0 +1,102 @@
+/* *****************************************************************************
+** MIT License
+**
+** Copyright (c) 2022 Quentin Quadrat
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+********************************************************************************
+*/
+
+#ifndef CORPUS_HPP
+#  define CORPUS_HPP
+
+#  include "Bookmarks.hpp"
+#  include <string>
+#  include <vector>
+#  include <cstdint>
+
+// *****************************************************************************
+//! \brief Generator of synthetic bookmark trees, to benchmark the application
+//! on various shapes and sizes without a Firefox export.
+//!
+//! Identifiers follow the convention of bookmarks/parser.py: the root folder
+//! has the identifier 0 and is its own parent, other nodes are numbered from
+//! 1. The same shape, number of nodes and seed always give the same tree.
+// *****************************************************************************
+class Corpus
+{
+public:
+
+    // *************************************************************************
+    //! \brief Shape of the generated tree.
+    // *************************************************************************
+    enum class Shape
+    {
+        //! \brief All bookmarks in the root folder.
+        Flat,
+        //! \brief Chains of nested folders, each one holding a few bookmarks.
+        //! A new chain starts from the root every MAX_DEPTH folders.
+        Deep,
+        //! \brief Complete tree: each folder holds the same number of
+        //! bookmarks and sub-folders.
+        Balanced,
+        //! \brief Preferential attachment: a node is added to a folder with a
+        //! probability proportional to its number of children plus one, giving
+        //! a power-law distribution of the fan-out (few huge folders, many
+        //! small ones).
+        PowerLaw
+    };
+
+    //----------------------------------------------------------------------
+    //! \brief Return the name of the given shape ("flat", "deep", "balanced"
+    //! or "powerlaw").
+    //----------------------------------------------------------------------
+    static const char* name(Shape const shape);
+
+    //----------------------------------------------------------------------
+    //! \brief Return the shape of the given name.
+    //! \return false if the name is unknown.
+    //----------------------------------------------------------------------
+    static bool parse(std::string const& name, Shape& shape);
+
+    //----------------------------------------------------------------------
+    //! \brief Generate a tree.
+    //! \param[in] shape shape of the tree.
+    //! \param[in] count number of nodes (folders and bookmarks, root folder
+    //! included).
+    //! \param[in] seed seed of the pseudo-random choices.
+    //! \param[out] folders the generated folders.
+    //! \param[out] bookmarks the generated bookmarks.
+    //----------------------------------------------------------------------
+    static void generate(Shape const shape, size_t const count, uint64_t const seed,
+                         std::vector<Folder>& folders,
+                         std::vector<Bookmark>& bookmarks);
+
+    //! \brief Depth of the chains of Shape::Deep. Keeps recursive traversals
+    //! of the tree (see IslandedBrowser::getURL()) within the stack.
+    static constexpr size_t MAX_DEPTH = 256u;
+    //! \brief Bookmarks per folder of Shape::Deep and Shape::Balanced.
+    static constexpr size_t BOOKMARKS_PER_FOLDER = 8u;
+    //! \brief Sub-folders per folder of Shape::Balanced.
+    static constexpr size_t FOLDERS_PER_FOLDER = 4u;
+    //! \brief A node of Shape::PowerLaw is a folder once in this number.
+    static constexpr uint64_t FOLDER_RATIO = 8u;
+};
+
+#endif
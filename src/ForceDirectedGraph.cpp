@@ -25,133 +25,2973 @@
 
 #include "ForceDirectedGraph.hpp"
 #include "Settings.hpp"
+#include <deque>
+#include <memory>
+#include <set>
+#include <limits>
+#include <numeric>
+#include <omp.h>
 
 //------------------------------------------------------------------------------
-ForceDirectedGraph::ForceDirectedGraph(sf::Vector2f const dimension, DiGraph& digraph)
-    : m_digraph(digraph), m_width(dimension.x), m_height(dimension.y)
+//! \brief Margin kept between vertices and the layout bounds along the given
+//! axis (the message bar is drawn at the bottom of the window).
+static inline float border(size_t const axis)
+{
+    return (axis == 0u) ? LAYOUT_BORDER_X
+        : ((axis == 1u) ? LAYOUT_BORDER_Y : NODE_RADIUS);
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+ForceDirectedLayout<D>::ForceDirectedLayout(Vector const dimension, DiGraph const& digraph)
+    : m_digraph(digraph), m_dimension(dimension)
 {}
 
 //------------------------------------------------------------------------------
-void ForceDirectedGraph::reset()
+template<size_t D>
+void ForceDirectedLayout<D>::reset()
 {
-    // convert std::set to std::vector to have direct access
-    std::vector<DiGraph::Node> nodes(m_digraph.nodes().begin(),
-                                     m_digraph.nodes().end());
-    N = nodes.size();
-    K = sqrtf(m_width * m_height / float(N));
-    m_temperature = m_width + m_height;
+    // Vertices share the dense indices of the graph nodes. Masses and radii
+    // are only given by the layout owning this one (see fans()).
+    N = m_digraph.size();
+    if (m_masses.size() != N)
+        m_masses.clear();
+    if (m_radii.size() != N)
+        m_radii.clear();
+    m_mass = m_masses.empty() ? float(N)
+           : std::accumulate(m_masses.begin(), m_masses.end(), 0.0f);
+    float volume = 1.0f;
+    for (size_t i = 0u; i < D; ++i)
+    {
+        volume *= coordinate(m_dimension, i);
+    }
+    K = root(volume / m_mass);
+    m_temperature = extent();
     m_vertices.resize(N);
 
-    // Copy graph nodes to Graph vertices
-    #pragma omp parallel for default(shared) schedule(dynamic)
+    // Initial positions in [0 1]^D
+    if (m_initialization == Initialization::Radial)
+    {
+        radial();
+    }
+    else
+    {
+        #pragma omp parallel for default(shared) schedule(static)
+        for (size_t n = 0u; n < N; ++n)
+        {
+            m_vertices[n].position = random(id(n));
+        }
+    }
+
+    wake();
+
+    #pragma omp parallel for default(shared) schedule(static)
     for (size_t n = 0u; n < N; ++n)
     {
         Vertex& v = m_vertices[n];
-        v.id = nodes[n];
-        v.position.x *= m_width;
-        v.position.y *= m_height;
-        v.displacement.x = 0.0f;
-        v.displacement.y = 0.0f;
-        v.color = (m_digraph.degree(v.id) == 0u)
-                  ? BOOKMARK_COLOR
-                  : FOLDER_COLOR;
+        for (size_t i = 0u; i < D; ++i)
+        {
+            coordinate(v.position, i) *= coordinate(m_dimension, i);
+        }
+        v.displacement = Space<D>::splat(0.0f);
+        v.color = (m_digraph.degree(DiGraph::Index(n)) == 0u) ? BOOKMARK_COLOR : FOLDER_COLOR;
     }
 
-    // Lookup table: Node ID to index on the vector
-    std::map<size_t, size_t> lookup;
+    // Build the undirected adjacency as compressed sparse rows. First pass:
+    // count edges "source node" -> "destination node" and their reverse.
+    std::vector<uint32_t> counts(N + 1u, 0u);
+    #pragma omp parallel for default(shared) schedule(dynamic, 256)
     for (size_t n = 0u; n < N; ++n)
     {
-        lookup[m_vertices[n].id] = n;
+        #pragma omp atomic
+        counts[n] += uint32_t(m_digraph.degree(DiGraph::Index(n)));
+
+        for (auto const& j: m_digraph.neighbors(DiGraph::Index(n)))
+        {
+            #pragma omp atomic
+            counts[j] += 1u;
+        }
     }
+    prefix_sum(counts, m_offsets);
 
-    // Add edges "source node" -> "destination node"
-    #pragma omp parallel for default(shared) schedule(dynamic)
+    // Second pass: scatter both directions of each edge
+    std::vector<uint32_t> cursors(m_offsets.begin(), m_offsets.end() - 1);
+    std::vector<uint32_t> adjacency(m_offsets[N]);
+    #pragma omp parallel for default(shared) schedule(dynamic, 256)
     for (size_t n = 0u; n < N; ++n)
     {
-        Vertex& v = m_vertices[n];
-        DiGraph::Neighbors const& neighbors = m_digraph.neighbors(v.id);
-        v.neighbors.resize(neighbors.size());
+        for (auto const& j: m_digraph.neighbors(DiGraph::Index(n)))
+        {
+            uint32_t slot;
+
+            #pragma omp atomic capture
+            slot = cursors[n]++;
+            adjacency[slot] = j;
+
+            #pragma omp atomic capture
+            slot = cursors[j]++;
+            adjacency[slot] = uint32_t(n);
+        }
+    }
+
+    // Sort rows (the scatter order depends on threads) and remove duplicated
+    // edges (when both "a -> b" and "b -> a" exist).
+    #pragma omp parallel for default(shared) schedule(dynamic, 256)
+    for (size_t n = 0u; n < N; ++n)
+    {
+        auto const first = adjacency.begin() + m_offsets[n];
+        auto const last = adjacency.begin() + m_offsets[n + 1u];
+        std::sort(first, last);
+        counts[n] = uint32_t(std::unique(first, last) - first);
+    }
+
+    std::vector<uint32_t> offsets;
+    prefix_sum(counts, offsets);
+    m_adjacency.resize(offsets[N]);
+
+    #pragma omp parallel for default(shared) schedule(static)
+    for (size_t n = 0u; n < N; ++n)
+    {
+        std::copy(adjacency.begin() + m_offsets[n],
+                  adjacency.begin() + m_offsets[n] + counts[n],
+                  m_adjacency.begin() + offsets[n]);
+    }
+    m_offsets.swap(offsets);
+
+    // Charges of degree weighted force models and adaptive speed
+    m_charges.resize(N);
+    for (size_t n = 0u; n < N; ++n)
+    {
+        m_charges[n] = mass(n) * float(neighbors(n).size() + 1u);
+    }
+    m_previous_forces.assign(N, Space<D>::splat(0.0f));
+    m_speed = 1.0f;
+
+    // The stress engine needs graph distances: place vertices from them
+    // (folders only simulated: their own layout does it).
+    const bool fan = (m_leaves == Leaves::Fans) && (N > 0u);
+    m_majorization = (m_engine == Engine::Stress) && !fan && pivot_mds();
+    if (!m_majorization)
+    {
+        m_pivots.clear();
+        m_pivot_distances.clear();
+        m_pivot_weights.clear();
+    }
+
+    m_fans.reset();
+    if (fan)
+    {
+        fans();
+    }
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+void ForceDirectedLayout<D>::fans()
+{
+    m_fans = std::make_unique<Fans>();
+    Fans& f = *m_fans;
 
-        size_t i = neighbors.size();
-        while (i--)
+    // Leaves are vertices without children hanging from a folder. Other
+    // vertices are the folders simulated on their own.
+    DiGraphBuilder builder;
+    f.folder_of.resize(N);
+    for (size_t n = 0u; n < N; ++n)
+    {
+        if ((m_digraph.degree(DiGraph::Index(n)) != 0u) ||
+            (m_digraph.parent(DiGraph::Index(n)) == DiGraph::npos))
+        {
+            f.folder_of[n] = uint32_t(f.folders.size());
+            f.folders.push_back(uint32_t(n));
+            builder.add_node(id(n));
+        }
+    }
+    const size_t count = f.folders.size();
+    std::vector<uint32_t> leaves(count + 1u, 0u);
+    for (size_t n = 0u; n < N; ++n)
+    {
+        const DiGraph::Index parent = m_digraph.parent(DiGraph::Index(n));
+        if ((m_digraph.degree(DiGraph::Index(n)) == 0u) && (parent != DiGraph::npos))
+        {
+            f.folder_of[n] = f.folder_of[parent];
+            ++leaves[f.folder_of[n]];
+        }
+    }
+
+    // Edges between folders, and leaves of each folder. A leaf is counted
+    // once, in the fan of its parent: so is it scattered, whatever other
+    // edges (duplicated or from other folders) lead to it.
+    prefix_sum(leaves, f.offsets);
+    f.leaves.resize(f.offsets[count]);
+    std::vector<uint32_t> cursors(f.offsets.begin(), f.offsets.end() - 1);
+    std::vector<uint8_t> placed(N, 0u);
+    for (size_t n = 0u; n < N; ++n)
+    {
+        for (auto const& c: m_digraph.neighbors(DiGraph::Index(n)))
         {
-           v.neighbors[i].position = &m_vertices[lookup[neighbors[i]]].position;
-           v.neighbors[i].id = m_vertices[lookup[neighbors[i]]].id;
+            if (m_digraph.degree(c) != 0u)
+            {
+                builder.add_edge(id(n), id(c));
+            }
+            else if ((m_digraph.parent(c) == DiGraph::Index(n)) && (placed[c] == 0u))
+            {
+                placed[c] = 1u;
+                f.leaves[cursors[f.folder_of[c]]++] = c;
+            }
         }
     }
 
-    // We need undirected graph so add edges "destination node" -> "source node"
-    for (auto& vertex: m_vertices)
+    // Each leaf covers the area (volume) K^D it would have in the simulation
+    const float ball = (D == 2u) ? 3.14159265f : 4.18879020f;
+    f.spacing = K / root(ball);
+
+    f.digraph = builder.build();
+    f.layout = std::make_unique<ForceDirectedLayout>(m_dimension, f.digraph);
+    ForceDirectedLayout& layout = *f.layout;
+    forward();
+    layout.m_masses.resize(count);
+    layout.m_radii.resize(count);
+    for (size_t k = 0u; k < count; ++k)
+    {
+        const uint32_t size = f.offsets[k + 1u] - f.offsets[k];
+        layout.m_masses[k] = 1.0f + float(size);
+        layout.m_radii[k] = (size == 0u) ? 0.0f : f.spacing * root(float(size));
+    }
+    layout.reset();
+
+    spread();
+    m_converged = layout.m_converged;
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+typename ForceDirectedLayout<D>::Vector
+ForceDirectedLayout<D>::fan(size_t const j, float const spacing)
+{
+    // 2D: golden angle. 3D: R2 low discrepancy sequence (plastic number)
+    // mapped to uniform directions.
+    const float rank = float(j + 1u);
+    Vector position;
+    if (D == 2u)
+    {
+        const float angle = 2.39996323f * float(j);
+        const float radius = spacing * sqrtf(rank);
+        coordinate(position, 0u) = radius * cosf(angle);
+        coordinate(position, 1u) = radius * sinf(angle);
+    }
+    else
+    {
+        const float u = 0.5f + 0.75487767f * float(j);
+        const float v = 0.5f + 0.56984029f * float(j);
+        const float angle = 6.28318531f * (u - floorf(u));
+        const float z = 1.0f - 2.0f * (v - floorf(v));
+        const float radius = spacing * cbrtf(rank);
+        const float planar = radius * sqrtf(std::max(0.0f, 1.0f - z * z));
+        coordinate(position, 0u) = planar * cosf(angle);
+        coordinate(position, 1u) = planar * sinf(angle);
+        coordinate(position, D - 1u) = radius * z;
+    }
+    return position;
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+void ForceDirectedLayout<D>::spread()
+{
+    Fans const& f = *m_fans;
+    ForceDirectedLayout const& layout = *f.layout;
+    const size_t count = f.folders.size();
+
+    #pragma omp parallel for default(shared) schedule(dynamic, 64)
+    for (size_t k = 0u; k < count; ++k)
     {
-        for (auto& neighbor: vertex.neighbors)
+        const Vector center = layout.m_vertices[k].position;
+        m_vertices[f.folders[k]].position = center;
+        for (uint32_t j = f.offsets[k]; j < f.offsets[k + 1u]; ++j)
         {
-           // Insert if not already present
-           Vertex& v = m_vertices[lookup[neighbor.id]];
-           size_t i = 0u;
-           while ((i < v.neighbors.size()) && (v.neighbors[i].id != vertex.id))
-               ++i;
-           if (i == v.neighbors.size())
-           {
-               v.neighbors.push_back({&vertex.position, vertex.id});
-           }
+            Vector position = center + fan(j - f.offsets[k], f.spacing);
+            for (size_t i = 0u; i < D; ++i)
+            {
+                float& x = coordinate(position, i);
+                x = std::min(coordinate(m_dimension, i) - border(i), std::max(border(i), x));
+            }
+            m_vertices[f.leaves[j]].position = position;
         }
     }
 }
 
 //------------------------------------------------------------------------------
-void ForceDirectedGraph::update()
+template<size_t D>
+void ForceDirectedLayout<D>::gather()
+{
+    Fans const& f = *m_fans;
+    ForceDirectedLayout& layout = *f.layout;
+    for (size_t k = 0u; k < f.folders.size(); ++k)
+    {
+        layout.m_vertices[k].position = m_vertices[f.folders[k]].position;
+    }
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+void ForceDirectedLayout<D>::wake()
+{
+    m_active.resize(N);
+    for (size_t n = 0u; n < N; ++n)
+    {
+        m_active[n] = uint32_t(n);
+    }
+    m_calm.assign(N, 0u);
+    m_moves.assign(N, 0.0f);
+    m_progress = 0u;
+    m_energy = m_previous_energy = std::numeric_limits<float>::max();
+    m_largest_move = std::numeric_limits<float>::max();
+    m_converged = (N == 0u);
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+void ForceDirectedLayout<D>::prefix_sum(std::vector<uint32_t> const& counts,
+                                        std::vector<uint32_t>& offsets)
+{
+    offsets.resize(counts.size());
+    uint32_t offset = 0u;
+    for (size_t i = 0u; i < counts.size(); ++i)
+    {
+        offsets[i] = offset;
+        offset += counts[i];
+    }
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+void ForceDirectedLayout<D>::update()
 {
-    if (m_temperature < 0.1f)
+    if (converged())
         return ;
 
     step();
 }
 
 //------------------------------------------------------------------------------
-void ForceDirectedGraph::step()
+template<size_t D>
+typename ForceDirectedLayout<D>::Placements ForceDirectedLayout<D>::placements() const
 {
-    #pragma omp parallel for default(shared) schedule(dynamic)
-    for (auto& v: m_vertices)
+    Placements placements(m_vertices.size());
+    for (size_t n = 0u; n < m_vertices.size(); ++n)
+    {
+        placements[n] = { id(n), m_vertices[n].position,
+                          uint32_t(neighbors(n).size()) };
+    }
+
+    // Vertices follow the insertion order of the graph nodes
+    std::sort(placements.begin(), placements.end(),
+              [](Placement const& a, Placement const& b)
+              {
+                  return a.id < b.id;
+              });
+    return placements;
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+void ForceDirectedLayout<D>::restore(Placements const& placements)
+{
+    reset();
+
+    for (size_t n = 0u; n < N; ++n)
+    {
+        Vertex& v = m_vertices[n];
+        auto const it = find(placements, id(n));
+        if (it != placements.end())
+        {
+            v.position = it->position;
+        }
+    }
+
+    // Nothing to simulate
+    m_active.clear();
+    m_calm.assign(N, uint8_t(FREEZE_STEPS));
+    m_converged = true;
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+typename ForceDirectedLayout<D>::Placements::const_iterator
+ForceDirectedLayout<D>::find(Placements const& placements, DiGraph::Node const id)
+{
+    auto const it = std::lower_bound(placements.begin(), placements.end(), id,
+                                     [](Placement const& p, DiGraph::Node const node)
+                                     {
+                                         return p.id < node;
+                                     });
+    if ((it != placements.end()) && (it->id == id))
+        return it;
+    return placements.end();
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+void ForceDirectedLayout<D>::incremental(size_t const iterations, size_t const hops)
+{
+    incremental(placements(), iterations, hops);
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+void ForceDirectedLayout<D>::incremental(Placements const& previous,
+                                         size_t const iterations, size_t const hops)
+{
+    reset();
+
+    // Restore positions of nodes still present. Nodes which are new or whose
+    // neighborhood has changed are marked as touched.
+    std::vector<uint8_t> placed(N, 0u);
+    std::vector<uint32_t> touched;
+    for (size_t n = 0u; n < N; ++n)
+    {
+        Vertex& v = m_vertices[n];
+        auto const it = find(previous, id(n));
+        if (it != previous.end())
+        {
+            v.position = it->position;
+            placed[n] = 1u;
+            if (it->degree != neighbors(n).size())
+            {
+                touched.push_back(uint32_t(n));
+            }
+        }
+        else
+        {
+            touched.push_back(uint32_t(n));
+        }
+    }
+
+    // Place new nodes near their already placed neighbor (i.e. their parent
+    // folder): breadth first from placed nodes so chains of new nodes (a new
+    // folder with new bookmarks) are placed at a pseudo-random offset in
+    // [-K/2, K/2].
+    std::vector<uint32_t> queue;
+    for (size_t n = 0u; n < N; ++n)
     {
-        // Repulsive forces: nodes -- nodes
-        for (auto& u: m_vertices)
+        if (placed[n] != 0u)
+            queue.push_back(uint32_t(n));
+    }
+    for (size_t q = 0u; q < queue.size(); ++q)
+    {
+        const uint32_t n = queue[q];
+        for (auto const& u: neighbors(n))
         {
-            if (u.id == v.id)
+            if (placed[u] != 0u)
                 continue ;
 
-            const sf::Vector2f direction(v.position - u.position);
-            const float dist = distance(direction);
-            const float rf = repulsive_force(dist);
-            v.displacement += direction / dist * rf;
+            Vertex& v = m_vertices[u];
+            const Vector offset = random(id(u)) - Space<D>::splat(0.5f);
+            v.position = m_vertices[n].position + offset * K;
+            placed[u] = 1u;
+            queue.push_back(u);
+        }
+    }
+
+    // Only folders are simulated: relax the folders near the changes and
+    // place leaves again on their fan.
+    if (m_fans)
+    {
+        gather();
+        std::vector<uint32_t> folders;
+        for (auto const& n: touched)
+        {
+            folders.push_back(m_fans->folder_of[n]);
+        }
+        std::sort(folders.begin(), folders.end());
+        folders.erase(std::unique(folders.begin(), folders.end()), folders.end());
+
+        ForceDirectedLayout& layout = *m_fans->layout;
+        forward();
+        layout.activate(folders, hops);
+        layout.m_temperature = layout.K;
+        layout.relax(iterations);
+        spread();
+        m_converged = layout.m_converged;
+        return ;
+    }
+
+    activate(touched, hops);
+
+    // Settle the neighborhood with small steps
+    m_temperature = K;
+    relax(iterations);
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+void ForceDirectedLayout<D>::activate(std::vector<uint32_t> touched, size_t const hops)
+{
+    // Only the neighborhood of touched nodes is active: other vertices are
+    // frozen and will not move unless woken up.
+    std::vector<uint32_t> depth(N, std::numeric_limits<uint32_t>::max());
+    for (auto const& n: touched)
+    {
+        depth[n] = 0u;
+    }
+    for (size_t q = 0u; q < touched.size(); ++q)
+    {
+        const uint32_t n = touched[q];
+        if (depth[n] >= hops)
+            continue ;
+
+        for (auto const& u: neighbors(n))
+        {
+            if (depth[u] > depth[n] + 1u)
+            {
+                depth[u] = depth[n] + 1u;
+                touched.push_back(u);
+            }
+        }
+    }
+
+    m_active.clear();
+    for (size_t n = 0u; n < N; ++n)
+    {
+        if (depth[n] <= hops)
+        {
+            m_active.push_back(uint32_t(n));
+        }
+        else
+        {
+            m_calm[n] = FREEZE_STEPS;
+        }
+    }
+    m_converged = m_active.empty();
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+void ForceDirectedLayout<D>::settings(ForceDirectedLayout const& other)
+{
+    m_repulsion = other.m_repulsion.load();
+    m_cooling = other.m_cooling.load();
+    m_freezing = other.m_freezing.load();
+    m_tolerance = other.m_tolerance.load();
+    m_theta = other.m_theta.load();
+    m_cutoff = other.m_cutoff.load();
+    m_initialization = other.m_initialization.load();
+    m_seed = other.m_seed.load();
+    m_engine = other.m_engine.load();
+    m_model = other.m_model.load();
+    m_pivot_count = other.m_pivot_count.load();
+    m_leaves = other.m_leaves.load();
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+void ForceDirectedLayout<D>::forward()
+{
+    // The folders never have fans of their own
+    ForceDirectedLayout& layout = *m_fans->layout;
+    layout.settings(*this);
+    layout.m_leaves = Leaves::Simulated;
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+typename ForceDirectedLayout<D>::Vector ForceDirectedLayout<D>::random(DiGraph::Node const id) const
+{
+    uint64_t z = mix(uint64_t(id) + m_seed.load(std::memory_order_relaxed) * 0x9e3779b97f4a7c15ull);
+
+    // 24 bits per coordinate: exactly representable floats in [0 1[. A hash
+    // gives two coordinates, the third one comes from hashing it again.
+    Vector position;
+    for (size_t i = 0u; i < D; ++i)
+    {
+        if ((i > 0u) && ((i & 1u) == 0u))
+        {
+            z = mix(z);
         }
+        coordinate(position, i) = float((z >> (32u * (i & 1u))) & 0xffffffu) / 16777216.0f;
+    }
+    return position;
+}
 
-        // Attractive forces: edges
-        for (auto& u: v.neighbors)
+//------------------------------------------------------------------------------
+template<size_t D>
+void ForceDirectedLayout<D>::tree(std::vector<uint32_t>& parents,
+                                  std::vector<uint32_t>& order,
+                                  std::vector<uint32_t>& depths) const
+{
+    // Breadth first traversal from the roots. Vertices only reachable through
+    // a cycle are visited last, from the first of them.
+    parents.assign(N, std::numeric_limits<uint32_t>::max());
+    depths.assign(N, 0u);
+    order.clear();
+    order.reserve(N);
+    std::vector<uint8_t> visited(N, 0u);
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        for (size_t root = 0u; root < N; ++root)
         {
-            if (u.id == v.id)
+            // Roots of the forest: vertices without parent
+            if ((visited[root] != 0u) ||
+                ((pass == 0) && (m_digraph.parent(DiGraph::Index(root)) != DiGraph::npos)))
                 continue ;
 
-            const sf::Vector2f direction(v.position - (*u.position));
-            const float dist = distance(direction);
-            const float af = attractive_force(dist);
-            v.displacement -= direction / dist * af;
+            visited[root] = 1u;
+            order.push_back(uint32_t(root));
+            for (size_t q = order.size() - 1u; q < order.size(); ++q)
+            {
+                const uint32_t n = order[q];
+                for (auto const& c: m_digraph.neighbors(n))
+                {
+                    if (visited[c] != 0u)
+                        continue ;
+
+                    visited[c] = 1u;
+                    parents[c] = n;
+                    depths[c] = depths[n] + 1u;
+                    order.push_back(uint32_t(c));
+                }
+            }
         }
     }
+}
 
-    // Update position and constrain position to the window bounds
-    #pragma omp parallel for default(shared) schedule(dynamic)
-    for (auto& v: m_vertices)
+//------------------------------------------------------------------------------
+template<size_t D>
+void ForceDirectedLayout<D>::radial()
+{
+    std::vector<uint32_t> parents, order, depths;
+    tree(parents, order, depths);
+
+    // Number of leaves of each subtree, children before parents
+    std::vector<float> leaves(N, 0.0f);
+    uint32_t max_depth = 0u;
+    for (size_t q = N; q--; )
     {
-        const float dist = distance(v.displacement);
-        v.position += (dist > m_temperature)
-                      ? v.displacement * m_temperature / dist
-                      : v.displacement;
-        v.position.x = std::min(m_width - LAYOUT_BORDER_X,
-                                std::max(LAYOUT_BORDER_X, v.position.x));
-        v.position.y = std::min(m_height - LAYOUT_BORDER_Y,
-                                std::max(LAYOUT_BORDER_Y, v.position.y));
-        v.displacement = { 0.0f, 0.0f };
+        const uint32_t n = order[q];
+        leaves[n] = std::max(1.0f, leaves[n]);
+        max_depth = std::max(max_depth, depths[n]);
+        if (parents[n] != std::numeric_limits<uint32_t>::max())
+        {
+            leaves[parents[n]] += leaves[n];
+        }
+    }
+
+    // Angular sector of each vertex, split among its children in traversal
+    // order. Roots share the whole circle. A single root stays at the center,
+    // otherwise roots are placed on the first circle.
+    size_t roots = 0u;
+    float total = 0.0f;
+    for (auto const& n: order)
+    {
+        if (parents[n] == std::numeric_limits<uint32_t>::max())
+        {
+            ++roots;
+            total += leaves[n];
+        }
+    }
+    const uint32_t shift = (roots > 1u) ? 1u : 0u;
+    const float ring = 0.5f / float(std::max(1u, max_depth + shift));
+    const float two_pi = 6.28318530718f;
+
+    std::vector<float> starts(N, 0.0f);
+    std::vector<float> sectors(N, 0.0f);
+    std::vector<float> cursors(N, 0.0f);
+    float cursor = 0.0f;
+    for (auto const& n: order)
+    {
+        const uint32_t p = parents[n];
+        if (p == std::numeric_limits<uint32_t>::max())
+        {
+            starts[n] = cursor;
+            sectors[n] = two_pi * leaves[n] / total;
+            cursor += sectors[n];
+        }
+        else
+        {
+            starts[n] = cursors[p];
+            sectors[n] = sectors[p] * leaves[n] / leaves[p];
+            cursors[p] += sectors[n];
+        }
+        cursors[n] = starts[n];
+
+        const float angle = starts[n] + 0.5f * sectors[n];
+        const float radius = ring * float(depths[n] + shift);
+        Vector& position = m_vertices[n].position;
+        if (D > 2u)
+        {
+            // Thickness of a ring along other axes: the layout unfolds in 3D
+            position = random(id(n));
+            for (size_t i = 2u; i < D; ++i)
+            {
+                coordinate(position, i) = 0.5f + (coordinate(position, i) - 0.5f) * ring;
+            }
+        }
+        position.x = 0.5f + radius * cosf(angle);
+        position.y = 0.5f + radius * sinf(angle);
     }
+}
 
-    cooling();
+//------------------------------------------------------------------------------
+template<size_t D>
+void ForceDirectedLayout<D>::bfs(size_t const source, std::vector<uint32_t>& distances) const
+{
+    distances.assign(N, std::numeric_limits<uint32_t>::max());
+    std::vector<uint32_t> queue;
+    queue.reserve(N);
+    queue.push_back(uint32_t(source));
+    distances[source] = 0u;
+    for (size_t q = 0u; q < queue.size(); ++q)
+    {
+        const uint32_t n = queue[q];
+        for (auto const& u: neighbors(n))
+        {
+            if (distances[u] == std::numeric_limits<uint32_t>::max())
+            {
+                distances[u] = distances[n] + 1u;
+                queue.push_back(u);
+            }
+        }
+    }
 }
+
+//------------------------------------------------------------------------------
+template<size_t D>
+bool ForceDirectedLayout<D>::pivot_mds()
+{
+    const size_t k = std::min(size_t(m_pivot_count), N);
+    if (k <= D)
+        return false;
+
+    // Pivots by max-min: each pivot is the vertex the farthest from the
+    // pivots already chosen, so that pivots spread over the whole graph. The
+    // first one depends on the seed. Unreachable vertices are considered
+    // farther than all reachable ones, so each connected component gets
+    // pivots.
+    m_pivots.clear();
+    m_pivot_distances.resize(N * k);
+    std::vector<uint32_t> nearest(N, std::numeric_limits<uint32_t>::max());
+    std::vector<uint32_t> region(N, 0u);
+    std::vector<uint32_t> distances;
+    size_t next = size_t(mix(m_seed.load(std::memory_order_relaxed)) % N);
+    for (size_t p = 0u; p < k; ++p)
+    {
+        m_pivots.push_back(uint32_t(next));
+        bfs(next, distances);
+
+        uint32_t farthest = 0u;
+        for (auto const& d: distances)
+        {
+            if (d != std::numeric_limits<uint32_t>::max())
+                farthest = std::max(farthest, d);
+        }
+
+        next = 0u;
+        for (size_t n = 0u; n < N; ++n)
+        {
+            const uint32_t d = (distances[n] == std::numeric_limits<uint32_t>::max())
+                               ? farthest + 1u : distances[n];
+            m_pivot_distances[n * k + p] = d;
+            if (d < nearest[n])
+            {
+                nearest[n] = d;
+                region[n] = uint32_t(p);
+            }
+            if (nearest[n] > nearest[next])
+                next = n;
+        }
+    }
+
+    // Sparse stress model: the term between a vertex and a pivot stands for
+    // the vertices of the region of the pivot (the vertices closer to it than
+    // to other pivots) which are at most half-way: its weight is their number
+    // divided by the squared graph distance.
+    std::vector<std::vector<uint32_t>> within(k);
+    for (size_t n = 0u; n < N; ++n)
+    {
+        std::vector<uint32_t>& counts = within[region[n]];
+        if (counts.size() <= nearest[n])
+            counts.resize(nearest[n] + 1u, 0u);
+        ++counts[nearest[n]];
+    }
+    for (auto& counts: within)
+    {
+        for (size_t d = 1u; d < counts.size(); ++d)
+            counts[d] += counts[d - 1u];
+    }
+    m_pivot_weights.resize(N * k);
+    #pragma omp parallel for default(shared) schedule(static)
+    for (size_t n = 0u; n < N; ++n)
+    {
+        for (size_t p = 0u; p < k; ++p)
+        {
+            const uint32_t d = m_pivot_distances[n * k + p];
+            std::vector<uint32_t> const& counts = within[p];
+            m_pivot_weights[n * k + p] = ((d == 0u) || counts.empty()) ? 0.0f
+                : float(counts[std::min(size_t(d / 2u), counts.size() - 1u)]) / float(d * d);
+        }
+    }
+
+    // Pivot MDS: double centering of the squared distances to pivots ...
+    std::vector<double> rows(N, 0.0), columns(k, 0.0);
+    double mean = 0.0;
+    for (size_t n = 0u; n < N; ++n)
+    {
+        for (size_t p = 0u; p < k; ++p)
+        {
+            const double d = double(m_pivot_distances[n * k + p]);
+            rows[n] += d * d;
+            columns[p] += d * d;
+        }
+        mean += rows[n];
+        rows[n] /= double(k);
+    }
+    for (auto& c: columns)
+        c /= double(N);
+    mean /= double(N * k);
+
+    std::vector<double> centered(N * k);
+    #pragma omp parallel for default(shared) schedule(static)
+    for (size_t n = 0u; n < N; ++n)
+    {
+        for (size_t p = 0u; p < k; ++p)
+        {
+            const double d = double(m_pivot_distances[n * k + p]);
+            centered[n * k + p] = -0.5 * (d * d - rows[n] - columns[p] + mean);
+        }
+    }
+
+    // ... whose D main right singular vectors, found by power iterations on
+    // the small k x k matrix C^T C, give the axes of the layout.
+    std::vector<double> product(k * k, 0.0);
+    #pragma omp parallel for default(shared) schedule(dynamic, 1)
+    for (size_t p = 0u; p < k; ++p)
+    {
+        for (size_t q = p; q < k; ++q)
+        {
+            double sum = 0.0;
+            for (size_t n = 0u; n < N; ++n)
+                sum += centered[n * k + p] * centered[n * k + q];
+            product[p * k + q] = product[q * k + p] = sum;
+        }
+    }
+
+    std::vector<std::vector<double>> axes(D, std::vector<double>(k));
+    std::vector<double> next_axis(k);
+    for (size_t a = 0u; a < D; ++a)
+    {
+        std::vector<double>& axis = axes[a];
+        uint64_t z = mix(m_seed.load(std::memory_order_relaxed) + a + 1u);
+        for (auto& x: axis)
+        {
+            z = mix(z);
+            x = double(z & 0xffffffu) / 16777216.0 - 0.5;
+        }
+        for (size_t iteration = 0u; iteration < 200u; ++iteration)
+        {
+            for (size_t p = 0u; p < k; ++p)
+            {
+                double sum = 0.0;
+                for (size_t q = 0u; q < k; ++q)
+                    sum += product[p * k + q] * axis[q];
+                next_axis[p] = sum;
+            }
+            // Orthogonal to the previous axes
+            for (size_t b = 0u; b < a; ++b)
+            {
+                double d = 0.0;
+                for (size_t p = 0u; p < k; ++p)
+                    d += next_axis[p] * axes[b][p];
+                for (size_t p = 0u; p < k; ++p)
+                    next_axis[p] -= d * axes[b][p];
+            }
+            double norm = 0.0;
+            for (auto const& x: next_axis)
+                norm += x * x;
+            norm = std::sqrt(norm);
+            if (norm < 1e-12)
+                return false;
+
+            double change = 0.0;
+            for (size_t p = 0u; p < k; ++p)
+            {
+                next_axis[p] /= norm;
+                change += std::abs(next_axis[p] - axis[p]);
+            }
+            axis.swap(next_axis);
+            if (change < 1e-9)
+                break ;
+        }
+    }
+
+    std::vector<Vector> positions(N);
+    #pragma omp parallel for default(shared) schedule(static)
+    for (size_t n = 0u; n < N; ++n)
+    {
+        for (size_t a = 0u; a < D; ++a)
+        {
+            double sum = 0.0;
+            for (size_t p = 0u; p < k; ++p)
+                sum += centered[n * k + p] * axes[a][p];
+            coordinate(positions[n], a) = float(sum);
+        }
+    }
+
+    // Scale minimizing the stress of the vertex-pivot terms, so that
+    // positions are expressed in number of edges.
+    double numerator = 0.0, denominator = 0.0;
+    for (size_t n = 0u; n < N; ++n)
+    {
+        for (size_t p = 0u; p < k; ++p)
+        {
+            const double d = double(m_pivot_distances[n * k + p]);
+            if (d <= 0.0)
+                continue ;
+            const Vector u = positions[n] - positions[m_pivots[p]];
+            const double e = std::sqrt(double(dot(u, u)));
+            numerator += e / d;
+            denominator += e * e / (d * d);
+        }
+    }
+    if (denominator <= 0.0)
+        return false;
+    const float scale = float(numerator / denominator);
+
+    // Length of an edge: K, unless the layout does not fit in the window
+    Vector min = Space<D>::splat(std::numeric_limits<float>::max());
+    Vector max = -min;
+    for (auto const& position: positions)
+    {
+        min = lower(min, position);
+        max = upper(max, position);
+    }
+    m_edge_length = K;
+    for (size_t i = 0u; i < D; ++i)
+    {
+        const float extent = (coordinate(max, i) - coordinate(min, i)) * scale;
+        const float room = coordinate(m_dimension, i) - 2.0f * border(i);
+        if (extent * m_edge_length > room)
+            m_edge_length = std::max(room, 0.0f) / extent;
+    }
+    m_edge_length = std::max(m_edge_length, 0.001f);
+
+    // Vertices at the same distances from all pivots (e.g. bookmarks of the
+    // same folder) get the same position: spread them at a pseudo-random
+    // offset in [-L/2, L/2] so that their terms can separate them.
+    const Vector middle = (min + max) / 2.0f;
+    #pragma omp parallel for default(shared) schedule(static)
+    for (size_t n = 0u; n < N; ++n)
+    {
+        Vertex& v = m_vertices[n];
+        v.position = m_dimension / 2.0f + (positions[n] - middle) * (scale * m_edge_length)
+                   + (random(id(n)) - Space<D>::splat(0.5f)) * m_edge_length;
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+float ForceDirectedLayout<D>::majorize()
+{
+    // Localized stress majorization (Jacobi iteration: new positions only
+    // depend on the positions of the previous step). Each term asks the
+    // vertex to be at the graph distance (times the edge length) of another
+    // vertex along their current direction.
+    const size_t k = m_pivots.size();
+    const float length = m_edge_length;
+    const size_t count = m_active.size();
+    float stress = 0.0f;
+    #pragma omp parallel for default(shared) schedule(dynamic, 64) reduction(+:stress)
+    for (size_t a = 0u; a < count; ++a)
+    {
+        const size_t n = m_active[a];
+        Vertex& v = m_vertices[n];
+        Vector sum = Space<D>::splat(0.0f);
+        float weights = 0.0f;
+        auto const term = [&](Vector const& other, float const target, float const weight)
+        {
+            const Vector direction(v.position - other);
+            const float dist = distance(direction);
+            sum += (other + direction * (target / dist)) * weight;
+            weights += weight;
+            stress += weight * (dist - target) * (dist - target);
+        };
+
+        // Neighbors: graph distance 1 and weight 1 / 1^2. Nothing else
+        // separates vertices sharing a neighbor (pivots see them at the same
+        // distance), so each one also keeps the graph distance 2 with the
+        // vertices before and after it in the row of the neighbor. Like pivots,
+        // these two terms stand for all the vertices of the row: each one
+        // weighs half of the terms 1 / 2^2 of the full stress.
+        for (auto const& u: neighbors(n))
+        {
+            term(m_vertices[u].position, length + radius(n) + radius(u), 1.0f);
+
+            Neighbors const siblings = neighbors(u);
+            if (siblings.size() < 2u)
+                continue ;
+
+            const size_t i = size_t(std::lower_bound(siblings.begin(), siblings.end(),
+                                                     uint32_t(n)) - siblings.begin());
+            const size_t row = siblings.size();
+            const float weight = 0.125f * float(row - 1u);
+            term(m_vertices[siblings.first[(i + 1u) % row]].position, 2.0f * length, weight);
+            term(m_vertices[siblings.first[(i + row - 1u) % row]].position, 2.0f * length, weight);
+        }
+        for (size_t p = 0u; p < k; ++p)
+        {
+            const float weight = m_pivot_weights[n * k + p];
+            if (weight > 0.0f)
+            {
+                term(m_vertices[m_pivots[p]].position,
+                     length * float(m_pivot_distances[n * k + p]), weight);
+            }
+        }
+
+        if (weights > 0.0f)
+        {
+            v.displacement = sum / weights - v.position;
+        }
+    }
+
+    return stress;
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+void ForceDirectedLayout<D>::relax(size_t const iterations)
+{
+    for (size_t i = 0u; (i < iterations) && !converged(); ++i)
+    {
+        step();
+    }
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+void ForceDirectedLayout<D>::coarsen(DiGraph const& fine, DiGraph& coarse,
+                                     Coarsening& coarsening)
+{
+    const size_t count = fine.size();
+
+    // Merge leaves into their parent folder: fine node standing for each
+    // fine node in the coarse graph.
+    std::vector<DiGraph::Index> representatives(count);
+    size_t merged = 0u;
+    for (DiGraph::Index n = 0u; n < count; ++n)
+    {
+        if ((fine.degree(n) == 0u) && (fine.parent(n) != DiGraph::npos))
+        {
+            representatives[n] = fine.parent(n);
+            ++merged;
+        }
+        else
+        {
+            representatives[n] = n;
+        }
+    }
+
+    // Deep chains of folders do not shrink: merge pairs of neighbors instead
+    if (merged * 10u < count)
+    {
+        std::vector<uint8_t> matched(count, 0u);
+        for (DiGraph::Index n = 0u; n < count; ++n)
+        {
+            representatives[n] = n;
+        }
+        for (DiGraph::Index n = 0u; n < count; ++n)
+        {
+            if (matched[n] != 0u)
+                continue ;
+
+            for (auto const& neighbor: fine.neighbors(n))
+            {
+                if ((neighbor != n) && (matched[neighbor] == 0u))
+                {
+                    representatives[neighbor] = n;
+                    matched[neighbor] = 1u;
+                    break ;
+                }
+            }
+            matched[n] = 1u;
+        }
+    }
+
+    // Coarse nodes keep the Firefox identifier of their representative
+    DiGraphBuilder builder;
+    coarsening.resize(count);
+    for (DiGraph::Index n = 0u; n < count; ++n)
+    {
+        coarsening[n] = builder.add_node(fine.id(representatives[n]));
+    }
+
+    // Coarse edges without duplicates
+    std::set<std::pair<DiGraph::Index, DiGraph::Index>> edges;
+    for (DiGraph::Index n = 0u; n < count; ++n)
+    {
+        for (auto const& to: fine.neighbors(n))
+        {
+            const DiGraph::Index from = coarsening[n];
+            const DiGraph::Index dest = coarsening[to];
+            if ((from != dest) && edges.insert({ from, dest }).second)
+            {
+                builder.add_edge(builder.id(from), builder.id(dest));
+            }
+        }
+    }
+    coarse = builder.build();
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+void ForceDirectedLayout<D>::prolong(ForceDirectedLayout const& coarse,
+                                     Coarsening const& coarsening)
+{
+    #pragma omp parallel for default(shared) schedule(static)
+    for (size_t n = 0u; n < N; ++n)
+    {
+        Vertex& v = m_vertices[n];
+        const DiGraph::Index c = coarsening[n];
+        v.position = coarse.m_vertices[c].position;
+
+        // Nodes merged into another one are spread around it at a
+        // pseudo-random offset in [-K/2, K/2].
+        if (coarse.id(c) != id(n))
+        {
+            v.position += (random(id(n)) - Space<D>::splat(0.5f)) * K;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+void ForceDirectedLayout<D>::multilevel(size_t const refinements)
+{
+    if (m_leaves == Leaves::Fans)
+    {
+        reset();
+        if (m_fans)
+        {
+            m_fans->layout->multilevel(refinements);
+            spread();
+            m_converged = m_fans->layout->m_converged;
+        }
+        return ;
+    }
+
+    if (m_engine == Engine::Stress)
+    {
+        reset();
+        return ;
+    }
+
+    // Graphs of each level: the finest one is m_digraph. Use deque to keep
+    // references valid.
+    std::deque<DiGraph> graphs;
+    std::vector<Coarsening> coarsenings;
+    DiGraph const* fine = &m_digraph;
+    while (fine->size() > 32u)
+    {
+        graphs.emplace_back();
+        coarsenings.emplace_back();
+        coarsen(*fine, graphs.back(), coarsenings.back());
+
+        // Stop when the graph no longer shrinks
+        if (graphs.back().size() * 20u > fine->size() * 19u)
+        {
+            graphs.pop_back();
+            coarsenings.pop_back();
+            break ;
+        }
+        fine = &graphs.back();
+    }
+
+    // Lay out the coarsest graph from random positions
+    std::unique_ptr<ForceDirectedLayout> coarse;
+    if (!graphs.empty())
+    {
+        coarse = std::make_unique<ForceDirectedLayout>(m_dimension, graphs.back());
+        coarse->settings(*this);
+        coarse->reset();
+        coarse->relax(500u);
+    }
+
+    // Refine each level from the coarser one
+    size_t level = graphs.size();
+    while (level--)
+    {
+        std::unique_ptr<ForceDirectedLayout> finer;
+        ForceDirectedLayout* layout = this;
+        if (level > 0u)
+        {
+            finer = std::make_unique<ForceDirectedLayout>(m_dimension, graphs[level - 1u]);
+            finer->settings(*this);
+            layout = finer.get();
+        }
+
+        layout->reset();
+        layout->prolong(*coarse, coarsenings[level]);
+        layout->m_temperature = 2.0f * layout->K;
+        layout->relax(refinements);
+        if (finer)
+        {
+            coarse = std::move(finer);
+        }
+    }
+
+    // No coarser level: classic layout from random positions
+    if (graphs.empty())
+    {
+        reset();
+    }
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+void ForceDirectedLayout<D>::hierarchical(size_t const threshold, size_t const refinements)
+{
+    static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+    reset();
+    if (N == 0u)
+        return ;
+
+    // Only folders are simulated: divide and conquer their own layout
+    if (m_fans)
+    {
+        m_fans->layout->hierarchical(threshold, refinements);
+        spread();
+        m_converged = m_fans->layout->m_converged;
+        return ;
+    }
+
+    std::vector<uint32_t> parents, order, depths;
+    tree(parents, order, depths);
+
+    // Size of each subtree, children before parents
+    std::vector<uint32_t> sizes(N, 1u);
+    for (size_t q = N; q-- > 1u; )
+    {
+        const uint32_t n = order[q];
+        if (parents[n] != NONE)
+        {
+            sizes[parents[n]] += sizes[n];
+        }
+    }
+
+    // Split the forest into clusters: each large enough subtree is a cluster,
+    // minus the clusters of its own large subtrees. Cluster 0 holds the roots.
+    std::vector<Cluster> clusters(1u);
+    std::vector<uint32_t> cluster_of(N);
+    for (auto const& n: order)
+    {
+        const uint32_t p = parents[n];
+        if ((p != NONE) && (sizes[n] >= threshold) && (sizes[n] < N))
+        {
+            cluster_of[n] = uint32_t(clusters.size());
+            clusters.emplace_back();
+            clusters.back().root = n;
+            clusters.back().parent = cluster_of[p];
+            clusters[cluster_of[p]].children.push_back(cluster_of[n]);
+        }
+        else
+        {
+            cluster_of[n] = (p == NONE) ? 0u : cluster_of[p];
+        }
+        clusters[cluster_of[n]].members.push_back(n);
+    }
+
+    // Clusters are laid out bottom-up: by height, a cluster being laid out
+    // after its sub-clusters. Clusters of the same height are independent.
+    std::vector<uint32_t> heights(clusters.size(), 0u);
+    for (size_t c = clusters.size(); c-- > 1u; )
+    {
+        const uint32_t p = clusters[c].parent;
+        heights[p] = std::max(heights[p], heights[c] + 1u);
+    }
+    std::vector<std::vector<uint32_t>> levels(heights[0] + 1u);
+    for (size_t c = 0u; c < clusters.size(); ++c)
+    {
+        levels[heights[c]].push_back(uint32_t(c));
+    }
+
+    // Position of each vertex in the frame of its cluster. Nested parallel
+    // regions run on a single thread: small clusters are spread over the
+    // threads, each one laid out serially, while large clusters are laid out
+    // one after the other, each one with all threads for its own loops.
+    std::vector<Vector> local(N);
+    std::vector<uint32_t> small, large;
+    for (auto const& level: levels)
+    {
+        small.clear();
+        large.clear();
+        for (auto const& c: level)
+        {
+            const size_t size = clusters[c].members.size() + clusters[c].children.size();
+            ((size < HIERARCHICAL_CUTOFF) ? small : large).push_back(c);
+        }
+
+        #pragma omp parallel for default(shared) schedule(dynamic, 1) if(small.size() > 1u)
+        for (size_t i = 0u; i < small.size(); ++i)
+        {
+            layout(clusters, small[i], cluster_of, local, refinements);
+        }
+        for (auto const& c: large)
+        {
+            layout(clusters, c, cluster_of, local, refinements);
+        }
+    }
+
+    // Compose translations from the top cluster down to each vertex
+    std::vector<Vector> origins(clusters.size());
+    origins[0] = Space<D>::splat(0.0f);
+    for (size_t c = 1u; c < clusters.size(); ++c)
+    {
+        // Parent clusters are created before their children
+        origins[c] = origins[clusters[c].parent] + clusters[c].offset;
+    }
+
+    Vector min = Space<D>::splat(std::numeric_limits<float>::max());
+    Vector max = -min;
+    for (size_t n = 0u; n < N; ++n)
+    {
+        local[n] += origins[cluster_of[n]];
+        min = lower(min, local[n]);
+        max = upper(max, local[n]);
+    }
+    // Fit the whole drawing in the layout dimension, keeping its aspect ratio
+    float scale = std::numeric_limits<float>::max();
+    for (size_t i = 0u; i < D; ++i)
+    {
+        scale = std::min(scale, coordinate(m_dimension, i) /
+                         std::max(coordinate(max, i) - coordinate(min, i), 1.0f));
+    }
+    const Vector margin = m_dimension - (max - min) * scale;
+    for (size_t n = 0u; n < N; ++n)
+    {
+        m_vertices[n].position = (local[n] - min) * scale + margin / 2.0f;
+    }
+
+    // Smooth the seams between clusters: only vertices near the edges
+    // linking a cluster to its enclosing cluster move.
+    std::vector<uint32_t> seams;
+    for (size_t c = 1u; c < clusters.size(); ++c)
+    {
+        seams.push_back(clusters[c].root);
+    }
+    activate(seams, 2u);
+    m_temperature = K;
+    relax(refinements);
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+size_t ForceDirectedLayout<D>::overlapping(float const diameter)
+{
+    Vector min, max;
+    bounds(min, max);
+    m_grid.build(N, min, max, diameter, [this](size_t const i)
+    {
+        return m_vertices[i].position;
+    });
+
+    size_t count = 0u;
+    #pragma omp parallel for default(shared) schedule(dynamic, 64) reduction(+: count)
+    for (size_t i = 0u; i < N; ++i)
+    {
+        Vector const& p = m_vertices[i].position;
+        bool overlaps = false;
+        m_grid.neighbors(p, [&](size_t const j)
+        {
+            const Vector delta = p - m_vertices[j].position;
+            overlaps = overlaps || ((j != i) && (dot(delta, delta) < diameter * diameter));
+        });
+        count += overlaps ? 1u : 0u;
+    }
+    return count;
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+void ForceDirectedLayout<D>::restrain(std::vector<Vector>& next, float const range,
+                                      bool const loose_leaves)
+{
+    // Edges only cross in the plane
+    if ((D != 2u) || (N == 0u))
+        return ;
+
+    // Edges, binned into the cells they pass through and the cells around
+    // them (counting sort): cells are not smaller than the range, so that
+    // the edges closer than the range to a vertex are found in its cell.
+    std::vector<uint32_t> edges;
+    for (size_t i = 0u; i < N; ++i)
+    {
+        for (uint32_t t = m_offsets[i]; t < m_offsets[i + 1u]; ++t)
+        {
+            if (m_adjacency[t] > i)
+            {
+                edges.push_back(uint32_t(i));
+                edges.push_back(m_adjacency[t]);
+            }
+        }
+    }
+    const size_t E = edges.size() / 2u;
+    Vector min, max;
+    bounds(min, max);
+    float size = range;
+    for (size_t k = 0u; k < D; ++k)
+    {
+        size = std::max(size, (coordinate(max, k) - coordinate(min, k)) / float(SEPARATION_CELLS));
+    }
+    int32_t cells[D];
+    size_t count = 1u;
+    for (size_t k = 0u; k < D; ++k)
+    {
+        cells[k] = 1 + int32_t((coordinate(max, k) - coordinate(min, k)) / size);
+        count *= size_t(cells[k]);
+    }
+    auto axis = [&](float const x, size_t const k)
+    {
+        return std::min(cells[k] - 1, std::max(0, int32_t((x - coordinate(min, k)) / size)));
+    };
+    std::vector<uint32_t> starts(count + 1u, 0u), binned;
+    std::vector<uint32_t> last(count);
+    for (size_t pass = 0u; pass < 2u; ++pass)
+    {
+        std::fill(last.begin(), last.end(), uint32_t(E));
+        for (size_t e = 0u; e < E; ++e)
+        {
+            Vector const& p = m_vertices[edges[2u * e]].position;
+            Vector const& q = m_vertices[edges[2u * e + 1u]].position;
+            int32_t c[2], end[2], step[2];
+            float crossing[2], delta[2];
+            for (size_t k = 0u; k < 2u; ++k)
+            {
+                const float u = (coordinate(p, k) - coordinate(min, k)) / size;
+                const float v = (coordinate(q, k) - coordinate(min, k)) / size;
+                c[k] = axis(coordinate(p, k), k);
+                end[k] = axis(coordinate(q, k), k);
+                step[k] = (v > u) ? 1 : -1;
+                delta[k] = (std::abs(v - u) > 0.0f) ? 1.0f / std::abs(v - u)
+                    : std::numeric_limits<float>::max();
+                crossing[k] = (v > u) ? (float(c[k] + 1) - u) * delta[k] : (u - float(c[k])) * delta[k];
+            }
+
+            // Walk the cells of the segment (Amanatides and Woo) and bin the
+            // edge once in each cell around them.
+            while (true)
+            {
+                for (int32_t y = std::max(0, c[1] - 1); y <= std::min(cells[1] - 1, c[1] + 1); ++y)
+                {
+                    for (int32_t x = std::max(0, c[0] - 1); x <= std::min(cells[0] - 1, c[0] + 1); ++x)
+                    {
+                        const size_t cell = size_t(y) * size_t(cells[0]) + size_t(x);
+                        if (last[cell] == e)
+                            continue ;
+                        last[cell] = uint32_t(e);
+                        if (pass == 0u)
+                            ++starts[cell + 1u];
+                        else
+                            binned[starts[cell]++] = uint32_t(e);
+                    }
+                }
+                if ((c[0] == end[0]) && (c[1] == end[1]))
+                    break ;
+                const size_t k = (c[0] == end[0]) ? 1u : ((c[1] == end[1]) ? 0u
+                    : ((crossing[0] < crossing[1]) ? 0u : 1u));
+                c[k] += step[k];
+                crossing[k] += delta[k];
+            }
+        }
+        if (pass == 0u)
+        {
+            for (size_t c = 0u; c < count; ++c)
+            {
+                starts[c + 1u] += starts[c];
+            }
+            binned.resize(starts[count]);
+        }
+        else
+        {
+            for (size_t c = count; c > 0u; --c)
+            {
+                starts[c] = starts[c - 1u];
+            }
+            starts[0] = 0u;
+        }
+    }
+
+    // A vertex and the ends of an edge closer than the range each move less
+    // than a third of their distance (minus a clearance against rounding
+    // errors): the edge cannot sweep over the vertex, so that no edge
+    // crossing appears or vanishes. Farther pairs cannot meet since no move
+    // exceeds a third of the range. The edges of the parent of a leaf are
+    // skipped: they never cross the edge of the leaf. Loose leaves are also
+    // free to pass over the edges of other leaves.
+    const float clearance = SEPARATION_CLEARANCE * range;
+    std::vector<float> limits(N, range / 3.0f);
+    std::vector<float> reach(E, range / 3.0f);
+    #pragma omp parallel default(shared)
+    {
+        std::vector<float> local(E, range / 3.0f);
+
+        #pragma omp for schedule(dynamic, 64)
+        for (size_t i = 0u; i < N; ++i)
+        {
+            Vector const& p = m_vertices[i].position;
+            const bool leaf = (m_offsets[i + 1u] - m_offsets[i] == 1u);
+            const uint32_t parent = leaf ? m_adjacency[m_offsets[i]] : uint32_t(i);
+            const size_t c = size_t(axis(coordinate(p, 1u), 1u)) * size_t(cells[0])
+                + size_t(axis(coordinate(p, 0u), 0u));
+            for (uint32_t t = starts[c]; t < starts[c + 1u]; ++t)
+            {
+                const uint32_t e = binned[t];
+                const uint32_t a = edges[2u * e];
+                const uint32_t b = edges[2u * e + 1u];
+                if ((a == i) || (b == i) || (a == parent) || (b == parent))
+                    continue ;
+                if (loose_leaves && leaf && ((m_offsets[a + 1u] - m_offsets[a] == 1u)
+                                             || (m_offsets[b + 1u] - m_offsets[b] == 1u)))
+                    continue ;
+
+                // Distance from the vertex to the segment
+                Vector const& u = m_vertices[a].position;
+                const Vector ab = m_vertices[b].position - u;
+                const Vector ap = p - u;
+                const float squared = dot(ab, ab);
+                const float t0 = (squared > 0.0f)
+                    ? std::min(1.0f, std::max(0.0f, dot(ap, ab) / squared)) : 0.0f;
+                const Vector delta = ap - ab * t0;
+                const float third = std::max(0.0f, sqrtf(dot(delta, delta)) - clearance) / 3.0f;
+                limits[i] = std::min(limits[i], third);
+                local[e] = std::min(local[e], third);
+            }
+        }
+
+        #pragma omp critical
+        for (size_t e = 0u; e < E; ++e)
+        {
+            reach[e] = std::min(reach[e], local[e]);
+        }
+    }
+    for (size_t e = 0u; e < E; ++e)
+    {
+        for (size_t end = 0u; end < 2u; ++end)
+        {
+            float& limit = limits[edges[2u * e + end]];
+            limit = std::min(limit, reach[e]);
+        }
+    }
+
+    #pragma omp parallel for default(shared) schedule(static)
+    for (size_t i = 0u; i < N; ++i)
+    {
+        Vector const& p = m_vertices[i].position;
+        const Vector move = next[i] - p;
+        const float length = sqrtf(dot(move, move));
+        if (length > limits[i])
+            next[i] = p + move * (limits[i] / length);
+    }
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+void ForceDirectedLayout<D>::untangle(size_t const rounds)
+{
+    // Edges only cross in the plane
+    if (D != 2u)
+        return ;
+
+    // Leaves and their parent, sorted by parent
+    std::vector<std::pair<uint32_t, uint32_t>> leaves;
+    for (size_t i = 0u; i < N; ++i)
+    {
+        if (m_offsets[i + 1u] - m_offsets[i] == 1u)
+            leaves.push_back({ m_adjacency[m_offsets[i]], uint32_t(i) });
+    }
+    std::sort(leaves.begin(), leaves.end());
+    const size_t L = leaves.size();
+    if (L < 2u)
+        return ;
+
+    // Twice the signed area of the triangle abc
+    auto orientation = [](Vector const& a, Vector const& b, Vector const& c)
+    {
+        return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    };
+    auto crossing = [&](size_t const e, size_t const f)
+    {
+        Vector const& a = m_vertices[leaves[e].first].position;
+        Vector const& b = m_vertices[leaves[e].second].position;
+        Vector const& c = m_vertices[leaves[f].first].position;
+        Vector const& d = m_vertices[leaves[f].second].position;
+        const float d1 = orientation(a, b, c);
+        const float d2 = orientation(a, b, d);
+        const float d3 = orientation(c, d, a);
+        const float d4 = orientation(c, d, b);
+        return (((d1 > 0.0f) && (d2 < 0.0f)) || ((d1 < 0.0f) && (d2 > 0.0f)))
+            && (((d3 > 0.0f) && (d4 < 0.0f)) || ((d3 < 0.0f) && (d4 > 0.0f)));
+    };
+
+    std::vector<int32_t> ranges(4u * L);
+    std::vector<uint32_t> starts, binned;
+    std::vector<std::pair<uint32_t, uint32_t>> pairs;
+    // Edges whose leaf moved in the last round: only they can cross anew
+    std::vector<uint8_t> moved(L, 1u);
+    for (size_t round = 0u; round < rounds; ++round)
+    {
+        Vector min, max;
+        bounds(min, max);
+        double length = 0.0;
+        for (auto const& leaf: leaves)
+        {
+            const Vector u = m_vertices[leaf.second].position - m_vertices[leaf.first].position;
+            length += double(sqrtf(dot(u, u)));
+        }
+        // Cells about the size of an edge, but not holding more than a few
+        // leaves on average when the layout is crowded, binning edges by
+        // their bounding box (counting sort). Edges of a cell stay sorted by
+        // parent.
+        float area = 1.0f;
+        for (size_t k = 0u; k < D; ++k)
+        {
+            area *= std::max(coordinate(max, k) - coordinate(min, k), 1e-3f);
+        }
+        float size = std::max(std::min(float(length / double(L)),
+                                       4.0f * sqrtf(area / float(L))), 1e-3f);
+        for (size_t k = 0u; k < D; ++k)
+        {
+            size = std::max(size, (coordinate(max, k) - coordinate(min, k)) / float(SEPARATION_CELLS));
+        }
+        int32_t cells[D];
+        size_t count = 1u;
+        for (size_t k = 0u; k < D; ++k)
+        {
+            cells[k] = 1 + int32_t((coordinate(max, k) - coordinate(min, k)) / size);
+            count *= size_t(cells[k]);
+        }
+        starts.assign(count + 1u, 0u);
+        for (size_t pass = 0u; pass < 2u; ++pass)
+        {
+            for (size_t e = 0u; e < L; ++e)
+            {
+                int32_t* r = &ranges[4u * e];
+                if (pass == 0u)
+                {
+                    Vector const& p = m_vertices[leaves[e].first].position;
+                    Vector const& q = m_vertices[leaves[e].second].position;
+                    for (size_t k = 0u; k < D; ++k)
+                    {
+                        const float a = coordinate(p, k) - coordinate(min, k);
+                        const float b = coordinate(q, k) - coordinate(min, k);
+                        r[k] = std::min(cells[k] - 1, int32_t(std::min(a, b) / size));
+                        r[k + 2u] = std::min(cells[k] - 1, int32_t(std::max(a, b) / size));
+                    }
+                }
+                for (int32_t y = r[1]; y <= r[3]; ++y)
+                {
+                    for (int32_t x = r[0]; x <= r[2]; ++x)
+                    {
+                        const size_t c = size_t(y) * size_t(cells[0]) + size_t(x);
+                        if (pass == 0u)
+                            ++starts[c + 1u];
+                        else
+                            binned[starts[c]++] = uint32_t(e);
+                    }
+                }
+            }
+            if (pass == 0u)
+            {
+                for (size_t c = 0u; c < count; ++c)
+                {
+                    starts[c + 1u] += starts[c];
+                }
+                binned.resize(starts[count]);
+            }
+            else
+            {
+                for (size_t c = count; c > 0u; --c)
+                {
+                    starts[c] = starts[c - 1u];
+                }
+                starts[0] = 0u;
+            }
+        }
+
+        // Crossing pairs of edges of different parents, tested in the lowest
+        // cell they share. In a cell, the edges of a parent are contiguous:
+        // they are skipped at once, so that the fans of folders with many
+        // leaves do not cost a number of pairs quadratic in their size.
+        pairs.clear();
+        #pragma omp parallel default(shared)
+        {
+            std::vector<std::pair<uint32_t, uint32_t>> local;
+            std::vector<uint32_t> next;
+
+            #pragma omp for schedule(dynamic, 64)
+            for (size_t c = 0u; c < count; ++c)
+            {
+                const uint32_t first = starts[c];
+                const uint32_t last = starts[c + 1u];
+                if (last - first < 2u)
+                    continue ;
+                const int32_t x = int32_t(c % size_t(cells[0]));
+                const int32_t y = int32_t(c / size_t(cells[0]));
+
+                // First edge of the next parent
+                next.resize(last - first);
+                next[last - first - 1u] = last;
+                for (uint32_t i = last - 1u; i-- > first; )
+                {
+                    next[i - first] = (leaves[binned[i]].first == leaves[binned[i + 1u]].first)
+                        ? next[i + 1u - first] : i + 1u;
+                }
+
+                for (uint32_t i = first; i < last; ++i)
+                {
+                    const uint32_t e = binned[i];
+                    for (uint32_t j = next[i - first]; j < last; ++j)
+                    {
+                        const uint32_t f = binned[j];
+                        int32_t const* a = &ranges[4u * e];
+                        int32_t const* b = &ranges[4u * f];
+                        if ((moved[e] || moved[f])
+                            && (std::max(a[0], b[0]) == x) && (std::max(a[1], b[1]) == y)
+                            && crossing(e, f))
+                        {
+                            local.push_back({ std::min(e, f), std::max(e, f) });
+                        }
+                    }
+                }
+            }
+
+            #pragma omp critical
+            pairs.insert(pairs.end(), local.begin(), local.end());
+        }
+        if (pairs.empty())
+            break ;
+
+        // Swapping the places of the leaves of crossing edges removes their
+        // crossing and shortens them (triangle inequality), so that rounds
+        // end. The set of places is kept: no overlap appears.
+        std::sort(pairs.begin(), pairs.end());
+        std::fill(moved.begin(), moved.end(), uint8_t(0u));
+        size_t swaps = 0u;
+        for (auto const& pair: pairs)
+        {
+            if (crossing(pair.first, pair.second))
+            {
+                moved[pair.first] = moved[pair.second] = 1u;
+                std::swap(m_vertices[leaves[pair.first].second].position,
+                          m_vertices[leaves[pair.second].second].position);
+                ++swaps;
+            }
+        }
+        if (swaps == 0u)
+            break ;
+    }
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+void ForceDirectedLayout<D>::fit(bool const stretch)
+{
+    Vector min, max;
+    bounds(min, max);
+
+    // Per axis: scale around the lowest corner when the layout is wider than
+    // the room (or to fill it), then translate it back inside the bounds.
+    Vector scale, shift;
+    for (size_t k = 0u; k < D; ++k)
+    {
+        const float low = border(k);
+        const float room = std::max(0.0f, coordinate(m_dimension, k) - 2.0f * low);
+        const float extent = coordinate(max, k) - coordinate(min, k);
+        const float s = ((extent > room) || (stretch && (extent > 0.0f))) ? room / extent : 1.0f;
+        const float first = coordinate(min, k);
+        const float last = first + extent * s;
+        coordinate(scale, k) = s;
+        coordinate(shift, k) = (first < low) ? low - first
+            : ((last > low + room) ? low + room - last : 0.0f);
+    }
+
+    #pragma omp parallel for default(shared) schedule(static)
+    for (size_t i = 0u; i < N; ++i)
+    {
+        Vector& p = m_vertices[i].position;
+        for (size_t k = 0u; k < D; ++k)
+        {
+            float& x = coordinate(p, k);
+            x = coordinate(min, k) + (x - coordinate(min, k)) * coordinate(scale, k)
+                + coordinate(shift, k);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+void ForceDirectedLayout<D>::compact(size_t const axis, float const diameter, bool const all)
+{
+    // Scan order along the axis, ties broken by index so that the backward
+    // scan visits exactly the reversed sequence.
+    std::vector<uint32_t> order(N);
+    std::iota(order.begin(), order.end(), 0u);
+    std::sort(order.begin(), order.end(), [this, axis](uint32_t const a, uint32_t const b)
+    {
+        const float xa = coordinate(m_vertices[a].position, axis);
+        const float xb = coordinate(m_vertices[b].position, axis);
+        return (xa < xb) || (!(xb < xa) && (a < b));
+    });
+
+    // Bands of one diameter (at least) along the other axes: only vertices
+    // of the 3^(D-1) bands around a vertex may overlap it.
+    Vector min, max;
+    bounds(min, max);
+    float size = diameter;
+    for (size_t k = 0u; k < D; ++k)
+    {
+        if (k != axis)
+            size = std::max(size, (coordinate(max, k) - coordinate(min, k)) / float(SEPARATION_CELLS));
+    }
+    int32_t cells[D];
+    size_t count = 1u;
+    for (size_t k = 0u; k < D; ++k)
+    {
+        cells[k] = (k == axis) ? 1 : 1 + int32_t((coordinate(max, k) - coordinate(min, k)) / size);
+        count *= size_t(cells[k]);
+    }
+    auto band = [&](Vector const& p, int32_t (&c)[D])
+    {
+        size_t index = 0u;
+        for (size_t k = D; k-- > 0u; )
+        {
+            c[k] = (k == axis) ? 0 : std::min(cells[k] - 1,
+                int32_t((coordinate(p, k) - coordinate(min, k)) / size));
+            index = index * size_t(cells[k]) + size_t(c[k]);
+        }
+        return index;
+    };
+
+    // A pair is constrained along this axis when the vertices are closer than
+    // a diameter along the other axes and, except for the last axis, when this
+    // axis is the one they are the most apart along: other pairs are left to
+    // the next axes.
+    auto gap = [&](size_t const i, size_t const j, float& g)
+    {
+        Vector const& a = m_vertices[i].position;
+        Vector const& b = m_vertices[j].position;
+        const float along = std::abs(coordinate(a, axis) - coordinate(b, axis));
+        float squared = 0.0f;
+        for (size_t k = 0u; k < D; ++k)
+        {
+            if (k == axis)
+                continue ;
+            const float across = std::abs(coordinate(a, k) - coordinate(b, k));
+            if (!all && (across > along))
+                return false;
+            squared += across * across;
+        }
+        if (squared >= diameter * diameter)
+            return false;
+        g = sqrtf(diameter * diameter - squared);
+        return true;
+    };
+
+    // Greedy scan: each vertex moves forward to the first place not closer
+    // than its gap to the vertices already placed. Vertices placed more than
+    // a diameter behind the scan line cannot constrain the next ones and are
+    // dropped from their band. The backward scan is the mirror image.
+    std::vector<float> placed[2] = { std::vector<float>(N), std::vector<float>(N) };
+    #pragma omp parallel for default(shared) schedule(static, 1)
+    for (size_t direction = 0u; direction < 2u; ++direction)
+    {
+        const float sign = (direction == 0u) ? 1.0f : -1.0f;
+        std::vector<float>& x = placed[direction];
+        std::vector<std::vector<uint32_t>> bands(count);
+        for (size_t n = 0u; n < N; ++n)
+        {
+            const size_t i = order[(direction == 0u) ? n : N - 1u - n];
+            const float key = sign * coordinate(m_vertices[i].position, axis);
+            float lowest = key;
+
+            int32_t c[D], o[D];
+            band(m_vertices[i].position, c);
+            size_t neighbors = 1u;
+            for (size_t k = 0u; k < D; ++k)
+            {
+                neighbors *= (k == axis) ? 1u : 3u;
+            }
+            for (size_t m = 0u; m < neighbors; ++m)
+            {
+                size_t index = 0u, digits = m;
+                bool inside = true;
+                for (size_t k = D; k-- > 0u; )
+                {
+                    o[k] = c[k];
+                    if (k != axis)
+                    {
+                        o[k] += int32_t(digits % 3u) - 1;
+                        digits /= 3u;
+                        inside = inside && (o[k] >= 0) && (o[k] < cells[k]);
+                    }
+                    index = index * size_t(cells[k]) + size_t(o[k]);
+                }
+                if (!inside)
+                    continue ;
+
+                std::vector<uint32_t>& members = bands[index];
+                for (size_t b = 0u; b < members.size(); )
+                {
+                    const uint32_t j = members[b];
+                    if (x[j] + diameter <= key)
+                    {
+                        members[b] = members.back();
+                        members.pop_back();
+                        continue ;
+                    }
+                    float g;
+                    if (gap(i, j, g))
+                        lowest = std::max(lowest, x[j] + g);
+                    ++b;
+                }
+            }
+            x[i] = lowest;
+            bands[band(m_vertices[i].position, c)].push_back(uint32_t(i));
+        }
+    }
+
+    // Both scans satisfy the same linear constraints (one per pair, in scan
+    // order) so their mean satisfies them too, and it does not drift.
+    #pragma omp parallel for default(shared) schedule(static)
+    for (size_t i = 0u; i < N; ++i)
+    {
+        coordinate(m_vertices[i].position, axis) = 0.5f * (placed[0][i] - placed[1][i]);
+    }
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+void ForceDirectedLayout<D>::diffuse(float const diameter, bool const restrained)
+{
+    // Cells of a few diameters covering the room inside the layout bounds
+    Vector origin;
+    float size = SEPARATION_FLOW * diameter;
+    for (size_t k = 0u; k < D; ++k)
+    {
+        coordinate(origin, k) = border(k);
+        const float room = std::max(0.0f, coordinate(m_dimension, k) - 2.0f * border(k));
+        size = std::max(size, room / float(SEPARATION_CELLS));
+    }
+    int32_t cells[D];
+    size_t count = 1u;
+    for (size_t k = 0u; k < D; ++k)
+    {
+        const float room = std::max(0.0f, coordinate(m_dimension, k) - 2.0f * border(k));
+        cells[k] = std::max(1, int32_t(std::ceil(room / size)));
+        count *= size_t(cells[k]);
+    }
+    size_t stride[D];
+    stride[0] = 1u;
+    for (size_t k = 1u; k < D; ++k)
+    {
+        stride[k] = stride[k - 1u] * size_t(cells[k - 1u]);
+    }
+    auto cell = [&](Vector const& p)
+    {
+        size_t index = 0u;
+        for (size_t k = 0u; k < D; ++k)
+        {
+            const int32_t c = int32_t(std::floor((coordinate(p, k) - coordinate(origin, k)) / size));
+            index += stride[k] * size_t(std::min(cells[k] - 1, std::max(0, c)));
+        }
+        return index;
+    };
+
+    // Number of vertices a cell holds loosely packed
+    const float capacity = std::pow(SEPARATION_PACKING * size / diameter, float(D));
+    std::vector<float> density(count), blurred(count);
+    std::vector<Vector> velocity(count), next(N);
+    float peak = std::numeric_limits<float>::max();
+    size_t stalled = 0u;
+    for (size_t step = 0u; step < SEPARATION_FLOW_STEPS; ++step)
+    {
+        std::fill(density.begin(), density.end(), 0.0f);
+        #pragma omp parallel for default(shared) schedule(static)
+        for (size_t i = 0u; i < N; ++i)
+        {
+            const size_t c = cell(m_vertices[i].position);
+            #pragma omp atomic
+            density[c] += 1.0f;
+        }
+
+        // Only crowded cells push: others count as full. Crowds of a few
+        // times the capacity are left to the proximity stress, which spreads
+        // them locally.
+        float highest = 0.0f;
+        #pragma omp parallel for default(shared) schedule(static) reduction(max: highest)
+        for (size_t c = 0u; c < count; ++c)
+        {
+            density[c] /= capacity;
+            highest = std::max(highest, density[c]);
+            density[c] = std::max(1.0f, density[c]);
+        }
+        if (highest <= SEPARATION_FLOW_TARGET)
+            break ;
+
+        // The flow cannot resolve crowds smaller than a cell: stop once the
+        // highest density no longer decreases.
+        stalled = (highest < 0.99f * peak) ? 0u : stalled + 1u;
+        peak = std::min(peak, highest);
+        if (stalled == SEPARATION_FLOW_PATIENCE)
+            break ;
+
+        // Smooth the density by a [1 2 1] filter along each axis, the
+        // borders being mirrors (nothing flows out of the room).
+        for (size_t k = 0u; k < D; ++k)
+        {
+            #pragma omp parallel for default(shared) schedule(static)
+            for (size_t c = 0u; c < count; ++c)
+            {
+                const int32_t x = int32_t((c / stride[k]) % size_t(cells[k]));
+                const size_t below = (x > 0) ? c - stride[k] : c;
+                const size_t above = (x + 1 < cells[k]) ? c + stride[k] : c;
+                blurred[c] = 0.25f * (density[below] + 2.0f * density[c] + density[above]);
+            }
+            density.swap(blurred);
+        }
+
+        // Vertices flow down the density gradient: v = -grad(rho) / rho,
+        // scaled to a stable diffusion step.
+        #pragma omp parallel for default(shared) schedule(static)
+        for (size_t c = 0u; c < count; ++c)
+        {
+            for (size_t k = 0u; k < D; ++k)
+            {
+                const int32_t x = int32_t((c / stride[k]) % size_t(cells[k]));
+                const size_t below = (x > 0) ? c - stride[k] : c;
+                const size_t above = (x + 1 < cells[k]) ? c + stride[k] : c;
+                coordinate(velocity[c], k) = -SEPARATION_FLOW_RATE * size
+                    * (density[above] - density[below]) / (2.0f * density[c]);
+            }
+        }
+
+        // Multilinear interpolation of the velocity between cell centers so
+        // that close vertices move alike and keep their relative positions.
+        #pragma omp parallel for default(shared) schedule(static)
+        for (size_t i = 0u; i < N; ++i)
+        {
+            Vector const& p = m_vertices[i].position;
+            size_t low[D], high[D];
+            float fraction[D];
+            for (size_t k = 0u; k < D; ++k)
+            {
+                const float u = (coordinate(p, k) - coordinate(origin, k)) / size - 0.5f;
+                const int32_t c = std::min(cells[k] - 1, std::max(0, int32_t(std::floor(u))));
+                low[k] = size_t(c);
+                high[k] = size_t(std::min(cells[k] - 1, c + 1));
+                fraction[k] = std::min(1.0f, std::max(0.0f, u - float(c)));
+            }
+            Vector v = Space<D>::splat(0.0f);
+            for (size_t corner = 0u; corner < (size_t(1u) << D); ++corner)
+            {
+                size_t index = 0u;
+                float weight = 1.0f;
+                for (size_t k = 0u; k < D; ++k)
+                {
+                    const bool up = ((corner >> k) & 1u) != 0u;
+                    index += stride[k] * (up ? high[k] : low[k]);
+                    weight *= up ? fraction[k] : 1.0f - fraction[k];
+                }
+                v += velocity[index] * weight;
+            }
+            next[i] = p + v;
+            for (size_t k = 0u; k < D; ++k)
+            {
+                float& x = coordinate(next[i], k);
+                x = std::min(coordinate(m_dimension, k) - border(k), std::max(border(k), x));
+            }
+        }
+
+        // Where the density changes sharply, the flow folds the layout onto
+        // itself: moves are shortened so that edge crossings are kept.
+        if (restrained)
+            restrain(next, SEPARATION_PROXIMITY * diameter, false);
+
+        #pragma omp parallel for default(shared) schedule(static)
+        for (size_t i = 0u; i < N; ++i)
+        {
+            m_vertices[i].position = next[i];
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+void ForceDirectedLayout<D>::proximity(float const diameter, size_t const iterations,
+                                       size_t const residual, bool const restrained)
+{
+    struct Term
+    {
+        Vector shift;
+        float weight;
+        uint32_t j;
+    };
+    std::vector<uint32_t> offsets(N + 1u, 0u);
+    std::vector<Term> terms;
+    std::vector<Vector> next(N), previous(N);
+    const size_t threads = size_t(omp_get_max_threads());
+    std::vector<std::vector<Term>> gathered(threads);
+    std::vector<size_t> starts(threads), firsts(threads), lasts(threads);
+    const float range = SEPARATION_PROXIMITY * diameter;
+    const float aimed = SEPARATION_SLACK * diameter;
+    for (size_t iteration = 0u; iteration < iterations; ++iteration)
+    {
+        Vector min, max;
+        bounds(min, max);
+        m_grid.build(N, min, max, range, [this](size_t const i)
+        {
+            return m_vertices[i].position;
+        });
+
+        // Terms of each vertex, gathered by each thread for a contiguous
+        // range of vertices then concatenated in the order of vertices.
+        size_t overlaps = 0u;
+        for (size_t thread = 0u; thread < threads; ++thread)
+        {
+            gathered[thread].clear();
+            firsts[thread] = lasts[thread] = 0u;
+        }
+        #pragma omp parallel num_threads(int(threads)) default(shared) reduction(+: overlaps)
+        {
+            const size_t thread = size_t(omp_get_thread_num());
+            const size_t count = size_t(omp_get_num_threads());
+            const size_t begin = N * thread / count;
+            const size_t end = N * (thread + 1u) / count;
+            std::vector<Term>& local = gathered[thread];
+            firsts[thread] = begin;
+            lasts[thread] = end;
+            for (size_t i = begin; i < end; ++i)
+            {
+                Vector const& p = m_vertices[i].position;
+                bool overlap = false;
+                m_grid.neighbors(p, [&](size_t const j)
+                {
+                    Vector delta = p - m_vertices[j].position;
+                    const float squared = dot(delta, delta);
+                    if ((j == i) || (squared >= range * range))
+                        return ;
+
+                    overlap = overlap || (squared < diameter * diameter);
+                    float dist = sqrtf(squared);
+                    if (dist < 1e-3f)
+                    {
+                        // Stacked vertices: opposite pseudo-random directions
+                        const uint64_t hash = mix(uint64_t(std::min(i, j)) * N + std::max(i, j));
+                        for (size_t k = 0u; k < D; ++k)
+                        {
+                            coordinate(delta, k) = float((hash >> (16u * k)) & 0xffffu) / 32768.0f - 1.0f;
+                        }
+                        delta *= (i < j) ? 1.0f : -1.0f;
+                        dist = std::max(1e-3f, sqrtf(dot(delta, delta)));
+                    }
+                    const float target = (dist >= aimed) ? dist : std::min(aimed,
+                        SEPARATION_GROWTH * std::max(dist, 0.1f * diameter));
+                    local.push_back(Term{ delta * (target / dist), 1.0f / (target * target), uint32_t(j) });
+                });
+                offsets[i + 1u] = uint32_t(local.size());
+                overlaps += overlap ? 1u : 0u;
+            }
+        }
+        if (overlaps <= residual)
+            break ;
+
+        // Local offsets become global ones
+        size_t total = 0u;
+        for (size_t thread = 0u; thread < threads; ++thread)
+        {
+            starts[thread] = total;
+            total += gathered[thread].size();
+        }
+        terms.resize(total);
+        #pragma omp parallel for default(shared) schedule(static, 1)
+        for (size_t thread = 0u; thread < threads; ++thread)
+        {
+            std::copy(gathered[thread].begin(), gathered[thread].end(),
+                      terms.begin() + ptrdiff_t(starts[thread]));
+            for (size_t i = firsts[thread]; i < lasts[thread]; ++i)
+            {
+                offsets[i + 1u] += uint32_t(starts[thread]);
+            }
+        }
+
+        // Jacobi sweeps of stress majorization: each vertex moves to the
+        // weighted mean of the places its terms aim at.
+        if (restrained)
+        {
+            #pragma omp parallel for default(shared) schedule(static)
+            for (size_t i = 0u; i < N; ++i)
+            {
+                previous[i] = m_vertices[i].position;
+            }
+        }
+        for (size_t sweep = 0u; sweep < SEPARATION_SWEEPS; ++sweep)
+        {
+            #pragma omp parallel for default(shared) schedule(dynamic, 64)
+            for (size_t i = 0u; i < N; ++i)
+            {
+                if (offsets[i] == offsets[i + 1u])
+                {
+                    next[i] = m_vertices[i].position;
+                    continue ;
+                }
+                Vector sum = Space<D>::splat(0.0f);
+                float weights = 0.0f;
+                for (uint32_t t = offsets[i]; t < offsets[i + 1u]; ++t)
+                {
+                    Term const& term = terms[t];
+                    sum += (m_vertices[term.j].position + term.shift) * term.weight;
+                    weights += term.weight;
+                }
+                next[i] = sum / weights;
+
+                // Leaves mostly slide along their edge: the fans of
+                // neighboring folders do not interleave.
+                if (m_offsets[i + 1u] - m_offsets[i] == 1u)
+                {
+                    Vector const& p = m_vertices[i].position;
+                    Vector edge = p - m_vertices[m_adjacency[m_offsets[i]]].position;
+                    const float length = sqrtf(dot(edge, edge));
+                    if (length > 1e-3f)
+                    {
+                        edge /= length;
+                        const Vector move = next[i] - p;
+                        const Vector along = edge * dot(move, edge);
+                        next[i] = p + along + (move - along) * SEPARATION_SLIDE;
+                    }
+                }
+            }
+
+            #pragma omp parallel for default(shared) schedule(static)
+            for (size_t i = 0u; i < N; ++i)
+            {
+                m_vertices[i].position = next[i];
+            }
+        }
+
+        // The whole move of the sweeps is shortened at once. Crossings
+        // between edges of leaves are left to untangle().
+        if (restrained)
+        {
+            #pragma omp parallel for default(shared) schedule(static)
+            for (size_t i = 0u; i < N; ++i)
+            {
+                next[i] = m_vertices[i].position;
+                m_vertices[i].position = previous[i];
+            }
+            restrain(next, range, true);
+            #pragma omp parallel for default(shared) schedule(static)
+            for (size_t i = 0u; i < N; ++i)
+            {
+                m_vertices[i].position = next[i];
+            }
+        }
+        fit(false);
+    }
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+size_t ForceDirectedLayout<D>::separate(float const radius, size_t const iterations)
+{
+    if (m_vertices.empty())
+        return 0u;
+
+    // Diameter kept between vertices, shrunk when the layout is too small
+    // to hold them all loosely packed.
+    float room = 1.0f;
+    for (size_t k = 0u; k < D; ++k)
+    {
+        room *= std::max(0.0f, coordinate(m_dimension, k) - 2.0f * border(k));
+    }
+    const float diameter = std::min(2.0f * radius,
+        SEPARATION_PACKING * std::pow(room / float(N), 1.0f / float(D)));
+    if (diameter <= 0.0f)
+        return overlapping(2.0f * radius);
+
+    // Edge crossings are kept while vertices have room: a crowded layout is
+    // packed whatever its crossings.
+    const bool restrained = (diameter >= 2.0f * radius);
+
+    // Use the whole room (an affine map keeps edge crossings) then let
+    // crowded regions flow into sparse ones.
+    fit(true);
+    diffuse(diameter, restrained);
+
+    // The proximity stress removes most overlaps, the compaction the last
+    // ones. When it no longer fits, the stress makes room again.
+    for (size_t round = 0u; round < SEPARATION_ROUNDS; ++round)
+    {
+        const size_t residual = (round == 0u) ? size_t(SEPARATION_RESIDUAL * float(N)) : 0u;
+        proximity(diameter, iterations, residual, restrained);
+        if (overlapping(diameter) == 0u)
+            break ;
+        for (size_t k = 0u; k < D; ++k)
+        {
+            compact(k, SEPARATION_SLACK * diameter, k + 1u == D);
+        }
+        fit(false);
+        if (overlapping(diameter) == 0u)
+            break ;
+    }
+
+    // Last crossings between edges of leaves
+    untangle(SEPARATION_UNTANGLE);
+
+    for (auto& v: m_vertices)
+    {
+        v.displacement = Space<D>::splat(0.0f);
+    }
+    return overlapping(2.0f * radius);
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+void ForceDirectedLayout<D>::layout(std::vector<Cluster>& clusters, size_t const current,
+                                    std::vector<uint32_t> const& cluster_of,
+                                    std::vector<Vector>& local,
+                                    size_t const refinements) const
+{
+    Cluster& cluster = clusters[current];
+
+    // Graph of the cluster: its members plus one node standing for each
+    // sub-cluster. Members are inserted first so that the k-th member is the
+    // k-th vertex of the sub-layout.
+    DiGraphBuilder builder;
+    for (auto const& n: cluster.members)
+    {
+        builder.add_node(id(n));
+    }
+    for (auto const& n: cluster.members)
+    {
+        for (auto const& node: m_digraph.neighbors(n))
+        {
+            const uint32_t c = cluster_of[node];
+            if ((c == current) || (clusters[c].parent == current))
+            {
+                builder.add_edge(id(n), id(node));
+            }
+        }
+    }
+    DiGraph const digraph = builder.build();
+
+    // Area giving the same optimal distance K than the whole layout
+    const float side = K * root(float(digraph.size()));
+    ForceDirectedLayout sub(Space<D>::splat(side), digraph);
+    sub.settings(*this);
+    sub.multilevel(refinements);
+    sub.relax(500u);
+
+    // Positions relative to the cluster root (or to the origin of the layout
+    // for the top cluster).
+    const Vector origin = (current == 0u)
+        ? Space<D>::splat(0.0f)
+        : sub.m_vertices[digraph.index(id(cluster.root))].position;
+    Vector min = Space<D>::splat(std::numeric_limits<float>::max());
+    Vector max = -min;
+    for (size_t k = 0u; k < cluster.members.size(); ++k)
+    {
+        const uint32_t n = cluster.members[k];
+        local[n] = sub.m_vertices[k].position - origin;
+        min = lower(min, local[n]);
+        max = upper(max, local[n]);
+    }
+
+    // Bounding circle of the members
+    cluster.center = (min + max) / 2.0f;
+    cluster.radius = 0.0f;
+    for (auto const& n: cluster.members)
+    {
+        const Vector u = local[n] - cluster.center;
+        cluster.radius = std::max(cluster.radius, sqrtf(dot(u, u)));
+    }
+    cluster.radius += 0.5f * K;
+    const float core = cluster.radius;
+
+    // Pack sub-clusters as rigid disks around the members, in the direction
+    // of the node standing for them, pushed outward until they overlap
+    // neither the members nor the disks already packed.
+    std::vector<std::pair<float, uint32_t>> children;
+    std::vector<Vector> directions(clusters.size());
+    for (auto const& c: cluster.children)
+    {
+        Cluster const& child = clusters[c];
+        Vector u = sub.m_vertices[digraph.index(id(child.root))].position
+                 - origin - cluster.center;
+        float norm = sqrtf(dot(u, u));
+        if (norm < 0.001f)
+        {
+            u = random(id(child.root)) - Space<D>::splat(0.5f);
+            norm = std::max(0.001f, sqrtf(dot(u, u)));
+        }
+        directions[c] = u / norm;
+        children.push_back({ atan2f(u.y, u.x), c });
+    }
+    std::sort(children.begin(), children.end());
+
+    std::vector<uint32_t> packed;
+    for (auto const& it: children)
+    {
+        Cluster& child = clusters[it.second];
+        float distance = core + child.radius;
+        Vector position;
+        for (bool overlap = true; overlap; )
+        {
+            position = cluster.center + directions[it.second] * distance;
+            overlap = false;
+            for (auto const& p: packed)
+            {
+                const Vector u = clusters[p].offset + clusters[p].center - position;
+                const float gap = sqrtf(dot(u, u)) - clusters[p].radius - child.radius;
+                if (gap < 0.0f)
+                {
+                    distance += std::max(-gap, 0.25f * K);
+                    overlap = true;
+                    break ;
+                }
+            }
+        }
+
+        // The frame of the sub-cluster is translated so that its bounding
+        // circle is at the packed position.
+        child.offset = position - child.center;
+        packed.push_back(it.second);
+        cluster.radius = std::max(cluster.radius, distance + child.radius);
+    }
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+void ForceDirectedLayout<D>::step()
+{
+    // Only folders are simulated: leaves follow them
+    if (m_fans)
+    {
+        ForceDirectedLayout& layout = *m_fans->layout;
+        forward();
+        layout.step();
+        spread();
+        m_energy = layout.m_energy;
+        m_converged = layout.m_converged;
+        return ;
+    }
+
+    if (m_active.empty())
+        return ;
+
+    // Stress majorization does not need cooling: it converges when vertices
+    // no longer move or when the stress no longer decreases (Jacobi steps on
+    // the sparse model end up oscillating around the minimum instead of
+    // reaching it).
+    if (m_majorization)
+    {
+        const float previous = m_energy;
+        const float stress = majorize();
+        displace();
+        freeze();
+        m_previous_energy = previous;
+        m_energy = stress;
+        m_converged = m_active.empty() || (m_largest_move < m_tolerance * K) ||
+                      (m_previous_energy - m_energy < STRESS_TOLERANCE * m_energy);
+        return ;
+    }
+
+    // Instantiate the kernels of the force laws once per step: they are
+    // inlined in the inner loops.
+    const ForceModel laws = m_model;
+    if (laws != m_stepped_model)
+    {
+        m_stepped_model = laws;
+        m_speed = 1.0f;
+        std::fill(m_previous_forces.begin(), m_previous_forces.end(), Space<D>::splat(0.0f));
+    }
+
+    switch (laws)
+    {
+    case ForceModel::ForceAtlas2:
+        forces(ForceAtlas2(K, m_mass));
+        break;
+    case ForceModel::LinLog:
+        forces(LinLog(K, m_mass));
+        break;
+    case ForceModel::FruchtermanReingold:
+    default:
+        forces(FruchtermanReingold(K, m_mass));
+        break;
+    }
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+template<class Model>
+void ForceDirectedLayout<D>::forces(Model const& model)
+{
+    switch (m_repulsion)
+    {
+    case Repulsion::BarnesHut:
+        repulsion_barnes_hut(model);
+        break;
+    case Repulsion::SIMD:
+        repulsion_simd(model);
+        break;
+    case Repulsion::CellList:
+        repulsion_cell_list(model);
+        break;
+    case Repulsion::Exact:
+    default:
+        repulsion_exact(model);
+        break;
+    }
+
+    attraction(model);
+    if (Model::ADAPTIVE_SPEED)
+    {
+        swing();
+    }
+    displace();
+    freeze();
+    cool();
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+template<class Model>
+void ForceDirectedLayout<D>::repulsion_exact(Model const& model)
+{
+    // Pairs of active vertices are computed once for both of them
+    if (!m_active.empty())
+    {
+        repulsion_pairs(model);
+    }
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+template<class Model>
+void ForceDirectedLayout<D>::repulsion_pairs(Model const& model)
+{
+    // Pairs of tiles (I, J) with I <= J cover each pair of active vertices
+    // once. They are numbered row by row along the triangle and dealt in
+    // round robin, so each thread gets the same share of short and long
+    // rows. The static schedules make the summation order only depend on the
+    // number of threads.
+    const size_t count = m_active.size();
+    const size_t tiles = (count + TILE - 1u) / TILE;
+    const size_t pairs = tiles * (tiles + 1u) / 2u;
+    m_accumulators.resize(size_t(omp_get_max_threads()) * count);
+
+    #pragma omp parallel default(shared)
+    {
+        const size_t threads = size_t(omp_get_num_threads());
+        Vector* forces = &m_accumulators[size_t(omp_get_thread_num()) * count];
+        std::fill(forces, forces + count, Space<D>::splat(0.0f));
+
+        #pragma omp for schedule(static, 1)
+        for (size_t t = 0u; t < pairs; ++t)
+        {
+            // t-th pair: row J holds pairs J (J + 1) / 2 to J (J + 1) / 2 + J
+            size_t J = size_t((std::sqrt(8.0 * double(t) + 1.0) - 1.0) / 2.0);
+            while (J * (J + 1u) / 2u > t)
+                --J;
+            while ((J + 1u) * (J + 2u) / 2u <= t)
+                ++J;
+            const size_t I = t - J * (J + 1u) / 2u;
+
+            const size_t i_end = std::min(count, (I + 1u) * TILE);
+            const size_t j_end = std::min(count, (J + 1u) * TILE);
+            for (size_t i = I * TILE; i < i_end; ++i)
+            {
+                const uint32_t a = m_active[i];
+                const Vector position = m_vertices[a].position;
+                const float weight = charge<Model>(a);
+                Vector force = Space<D>::splat(0.0f);
+                for (size_t j = (I == J) ? i + 1u : J * TILE; j < j_end; ++j)
+                {
+                    const uint32_t b = m_active[j];
+                    const Vector direction(position - m_vertices[b].position);
+                    const float dist = distance(direction);
+                    const Vector f = direction / dist * model.repulsion(dist);
+                    force += f * charge<Model>(b);
+                    forces[j] -= f * weight;
+                }
+                forces[i] += force;
+            }
+        }
+
+        // Reduce the accumulators of all threads (implicit barrier above).
+        // Frozen vertices do not move: their forces on active vertices are
+        // computed on one side only. The active set is sorted, frozen
+        // vertices are the gaps between active ones.
+        #pragma omp for schedule(static)
+        for (size_t k = 0u; k < count; ++k)
+        {
+            Vector sum = Space<D>::splat(0.0f);
+            for (size_t thread = 0u; thread < threads; ++thread)
+            {
+                sum += m_accumulators[thread * count + k];
+            }
+
+            const uint32_t a = m_active[k];
+            if (count < N)
+            {
+                const Vector position = m_vertices[a].position;
+                size_t next = 0u;
+                for (uint32_t j = 0u; j < uint32_t(N); ++j)
+                {
+                    if ((next < count) && (m_active[next] == j))
+                    {
+                        ++next;
+                        continue ;
+                    }
+
+                    const Vector direction(position - m_vertices[j].position);
+                    const float dist = distance(direction);
+                    sum += direction / dist * (model.repulsion(dist) * charge<Model>(j));
+                }
+            }
+            m_vertices[a].displacement += sum * receptivity<Model>(a);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+void ForceDirectedLayout<D>::bounds(Vector& min, Vector& max) const
+{
+    min = max = m_vertices[0].position;
+    for (auto const& v: m_vertices)
+    {
+        min = lower(min, v.position);
+        max = upper(max, v.position);
+    }
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+template<class Model>
+void ForceDirectedLayout<D>::repulsion_barnes_hut(Model const& model)
+{
+    if (m_vertices.empty())
+        return ;
+
+    // Rebuild the quadtree (octree in 3D) on the current positions
+    Vector min, max;
+    bounds(min, max);
+    m_quadtree.reset(min, max);
+    for (size_t n = 0u; n < N; ++n)
+    {
+        m_quadtree.insert(m_vertices[n].position, charge<Model>(n));
+    }
+    m_quadtree.finalize();
+
+    // Repulsive forces: nodes -- clusters of nodes. The vertex itself is
+    // stored in a leaf at a null distance and therefore adds no force.
+    auto const force = [this, &model](Vector const& direction, float const mass)
+    {
+        const float dist = distance(direction);
+        return direction / dist * (mass * model.repulsion(dist));
+    };
+
+    const float theta = m_theta;
+    const size_t count = m_active.size();
+    #pragma omp parallel for default(shared) schedule(dynamic, 64)
+    for (size_t k = 0u; k < count; ++k)
+    {
+        const size_t n = m_active[k];
+        Vertex& v = m_vertices[n];
+        v.displacement += m_quadtree.accumulate(v.position, theta, force) * receptivity<Model>(n);
+    }
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+template<class Model>
+void ForceDirectedLayout<D>::repulsion_simd(Model const& model)
+{
+    m_soa.resize(N, D);
+    SoALayout::Floats* positions[3] = { &m_soa.x, &m_soa.y, &m_soa.z };
+    SoALayout::Floats* displacements[3] = { &m_soa.dx, &m_soa.dy, &m_soa.dz };
+
+    #pragma omp parallel for default(shared) schedule(static)
+    for (size_t n = 0u; n < N; ++n)
+    {
+        for (size_t i = 0u; i < D; ++i)
+        {
+            (*positions[i])[n] = coordinate(m_vertices[n].position, i);
+            (*displacements[i])[n] = 0.0f;
+        }
+        m_soa.mass[n] = charge<Model>(n);
+    }
+
+    // direction / dist * model.repulsion(dist) == direction * c / dist^2
+    m_soa.repulsion(model.repulsion(1.0f), m_active);
+
+    const size_t count = m_active.size();
+    #pragma omp parallel for default(shared) schedule(static)
+    for (size_t k = 0u; k < count; ++k)
+    {
+        const size_t n = m_active[k];
+        const float factor = receptivity<Model>(n);
+        for (size_t i = 0u; i < D; ++i)
+        {
+            coordinate(m_vertices[n].displacement, i) += (*displacements[i])[n] * factor;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+template<class Model>
+void ForceDirectedLayout<D>::repulsion_cell_list(Model const& model)
+{
+    if (m_vertices.empty())
+        return ;
+
+    // Bin vertices into cells of the size of the cutoff distance
+    const float cutoff = m_cutoff * K;
+    Vector min, max;
+    bounds(min, max);
+    m_grid.build(N, min, max, cutoff, [this](size_t const i)
+    {
+        return m_vertices[i].position;
+    });
+
+    // Repulsive forces: nodes -- nodes in the neighboring cells
+    const float cutoff2 = cutoff * cutoff;
+    const size_t count = m_active.size();
+    #pragma omp parallel for default(shared) schedule(dynamic, 64)
+    for (size_t k = 0u; k < count; ++k)
+    {
+        const size_t n = m_active[k];
+        Vertex& v = m_vertices[n];
+        Vector displacement = Space<D>::splat(0.0f);
+        m_grid.neighbors(v.position, [&](size_t const i)
+        {
+            const Vector direction(v.position - m_vertices[i].position);
+            const float d2 = dot(direction, direction);
+            if ((i == n) || (d2 > cutoff2))
+                return ;
+
+            const float dist = distance(direction);
+            displacement += direction / dist * (model.repulsion(dist) * charge<Model>(i));
+        });
+        v.displacement += displacement * receptivity<Model>(n);
+    }
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+template<class Model>
+void ForceDirectedLayout<D>::attraction(Model const& model)
+{
+    // Attractive forces: edges
+    const size_t count = m_active.size();
+    #pragma omp parallel for default(shared) schedule(dynamic, 64)
+    for (size_t k = 0u; k < count; ++k)
+    {
+        const size_t n = m_active[k];
+        Vertex& v = m_vertices[n];
+        for (auto const& u: neighbors(n))
+        {
+            // Edges pull on the gap between fans of leaves
+            const Vector direction(v.position - m_vertices[u].position);
+            const float dist = distance(direction);
+            const float gap = m_radii.empty() ? dist
+                            : std::max(0.001f, dist - m_radii[n] - m_radii[u]);
+            const float af = model.attraction(gap);
+            v.displacement -= direction / dist * af;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+void ForceDirectedLayout<D>::displace()
+{
+    // Update position and constrain position to the window bounds
+    const size_t count = m_active.size();
+    const float temperature = m_temperature;
+    float energy = 0.0f;
+    float largest = 0.0f;
+
+    #pragma omp parallel for default(shared) schedule(static) reduction(+:energy) reduction(max:largest)
+    for (size_t k = 0u; k < count; ++k)
+    {
+        const size_t n = m_active[k];
+        Vertex& v = m_vertices[n];
+        const Vector previous(v.position);
+        const float dist = distance(v.displacement);
+        v.position += (dist > temperature)
+                      ? v.displacement * temperature / dist
+                      : v.displacement;
+        for (size_t i = 0u; i < D; ++i)
+        {
+            float& x = coordinate(v.position, i);
+            x = std::min(coordinate(m_dimension, i) - border(i), std::max(border(i), x));
+        }
+        v.displacement = Space<D>::splat(0.0f);
+
+        // Effective move (after clamping to the window)
+        const Vector move(v.position - previous);
+        m_moves[n] = sqrtf(dot(move, move));
+        energy += dist * dist;
+        largest = std::max(largest, m_moves[n]);
+    }
+
+    m_energy = energy;
+    m_largest_move = largest;
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+void ForceDirectedLayout<D>::swing()
+{
+    const size_t count = m_active.size();
+    float swinging = 0.0f;
+    float traction = 0.0f;
+
+    #pragma omp parallel for default(shared) schedule(static) reduction(+:swinging, traction)
+    for (size_t k = 0u; k < count; ++k)
+    {
+        const size_t n = m_active[k];
+        Vector const& force = m_vertices[n].displacement;
+        const Vector change(force - m_previous_forces[n]);
+        const Vector sum(force + m_previous_forces[n]);
+        swinging += m_charges[n] * sqrtf(dot(change, change));
+        traction += m_charges[n] * 0.5f * sqrtf(dot(sum, sum));
+    }
+
+    // Global speed: as fast as the traction allows without oscillating
+    if (swinging > 0.0f)
+    {
+        m_speed = std::min(SWING_TOLERANCE * traction / swinging,
+                           (1.0f + SPEED_RISE) * m_speed);
+    }
+
+    // Local speed: vertices oscillating slow down
+    const float speed = m_speed;
+    #pragma omp parallel for default(shared) schedule(static)
+    for (size_t k = 0u; k < count; ++k)
+    {
+        const size_t n = m_active[k];
+        Vertex& v = m_vertices[n];
+        const Vector change(v.displacement - m_previous_forces[n]);
+        const float swing = m_charges[n] * sqrtf(dot(change, change));
+        m_previous_forces[n] = v.displacement;
+        v.displacement *= speed / (1.0f + sqrtf(speed * swing));
+    }
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+void ForceDirectedLayout<D>::freeze()
+{
+    if (!m_freezing)
+        return ;
+
+    // Vertices moving less than the tolerance during several steps are
+    // removed from the active set.
+    const float calm = m_tolerance * K;
+    const float agitated = WAKE_FACTOR * calm;
+    std::vector<uint32_t> movers;
+    for (auto const& n: m_active)
+    {
+        if (m_moves[n] >= calm)
+        {
+            m_calm[n] = 0u;
+        }
+        else if (m_calm[n] < FREEZE_STEPS)
+        {
+            ++m_calm[n];
+        }
+
+        if (m_moves[n] >= agitated)
+        {
+            movers.push_back(n);
+        }
+    }
+
+    // Wake frozen vertices attached to, or close to, a vertex moving a lot
+    if ((m_active.size() < N) && !movers.empty())
+    {
+        Vector min, max;
+        bounds(min, max);
+        m_wake_grid.build(N, min, max, K, [this](size_t const i)
+        {
+            return m_vertices[i].position;
+        });
+
+        const float radius2 = K * K;
+        for (auto const& n: movers)
+        {
+            for (auto const& u: neighbors(n))
+            {
+                m_calm[u] = 0u;
+            }
+
+            Vector const& p = m_vertices[n].position;
+            m_wake_grid.neighbors(p, [&](size_t const i)
+            {
+                const Vector d(p - m_vertices[i].position);
+                if (dot(d, d) <= radius2)
+                {
+                    m_calm[i] = 0u;
+                }
+            });
+        }
+    }
+
+    // Rebuild the active set
+    m_active.clear();
+    for (size_t n = 0u; n < N; ++n)
+    {
+        if (m_calm[n] < FREEZE_STEPS)
+        {
+            m_active.push_back(uint32_t(n));
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+void ForceDirectedLayout<D>::cool()
+{
+    if (m_cooling == Cooling::Fixed)
+    {
+        m_temperature *= 0.98f;
+    }
+    else
+    {
+        // Adaptive step length of Yifan Hu: enlarge the step after 5
+        // consecutive steps reducing the energy, else shrink it.
+        if (m_energy < m_previous_energy)
+        {
+            if (++m_progress >= 5u)
+            {
+                m_progress = 0u;
+                m_temperature = std::min(m_temperature / 0.9f, extent());
+            }
+        }
+        else
+        {
+            m_progress = 0u;
+            m_temperature *= 0.9f;
+        }
+        m_previous_energy = m_energy;
+    }
+
+    m_converged = (m_temperature < 0.1f) || m_active.empty() ||
+                  (m_largest_move < m_tolerance * K);
+}
+
+template class ForceDirectedLayout<2u>;
+template class ForceDirectedLayout<3u>;
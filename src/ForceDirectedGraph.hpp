@@ -26,13 +26,22 @@
 #ifndef FORCEDIRECTEDGRAPH_HPP
 #  define FORCEDIRECTEDGRAPH_HPP
 
+#  include "ForceModels.hpp"
 #  include "Graph.hpp"
+#  include "QuadTree.hpp"
+#  include "Settings.hpp"
+#  include "SoALayout.hpp"
+#  include "UniformGrid.hpp"
+#  include "Vector.hpp"
 #  include <SFML/System/Vector2.hpp>
 #  include <SFML/Graphics/Color.hpp>
-#  include <map>
+#  include <atomic>
+#  include <memory>
+#  include <algorithm>
 #  include <vector>
 #  include <cstdlib>
 #  include <cmath>
+#  include <cstdint>
 
 // *****************************************************************************
 //! \brief Force-directed graph drawing algorithms are a class of algorithms for
@@ -51,54 +60,187 @@
 //! vertices k is defined as C * sqrt( area / num_vertices ) where C is a
 //! parameter we can adjust.
 //!
+//! The repulsive forces between all pairs of vertices are the bottleneck of the
+//! algorithm. Several modes are available: the exact O(N^2) computation, kept
+//! as reference, the same exact sum computed by SIMD kernels on a
+//! structure-of-arrays copy of the positions, the Barnes-Hut approximation
+//! in O(N log N) and the grid variant of Fruchterman and Reingold ignoring
+//! pairs of vertices further than a cutoff distance in O(N).
+//!
+//! Starting from random positions, hundreds of steps are needed before the
+//! layout converges. Vertices start by default from a radial tree drawing of
+//! the folder hierarchy instead (see Initialization), and pseudo-random
+//! positions derive from a seed so that runs are reproducible. The multilevel
+//! scheme (see multilevel()) instead coarsens the graph several times, lays
+//! out the coarsest graph, and then refines each finer level from the
+//! positions of the coarser one with only a few steps.
+//!
+//! Deep and flat trees, as exported by Firefox, make forces converge slowly.
+//! The stress engine (see Engine) instead seeds positions with pivot MDS
+//! computed from graph distances and refines them by sparse stress
+//! majorization: vertices move toward positions where their euclidean
+//! distances to their neighbors and to a few pivots match the graph distances.
+//! An iteration costs O(N (degree + pivots)) and few are needed.
+//!
+//! The layout is a template on the dimension D of the space (2 or 3): vertices,
+//! forces, clamping to the layout bounds and the spatial structures are
+//! written once with Space<D>::Vector. ForceDirectedGraph is the 2D layout
+//! drawn in the window and ForceDirectedGraph3D the 3D one.
+//!
 //! For more information see this video https://youtu.be/WWm-g2nLHds
 //! This code source is largely inspired by:
 //! https://github.com/qdHe/Parallelized-Force-directed-Graph-Drawing
 // *****************************************************************************
-class ForceDirectedGraph
+template<size_t D>
+class ForceDirectedLayout
 {
 public:
 
+    //! \brief Position in the space of dimension D.
+    using Vector = typename Space<D>::Vector;
+
     // *************************************************************************
-    //! \brief Vertex is a 2D representation of a graph node.
+    //! \brief Vertex is a representation of a graph node in the space of
+    //! dimension D. The n-th vertex stands for the node of index n in the
+    //! DiGraph (see id() for its Firefox identifier).
     // *************************************************************************
     struct Vertex
     {
-        // *********************************************************************
-        //! \brief Contrary to a graph structure we just care about position of
-        //! neighbors.
-        // *********************************************************************
-        struct Neighbor
-        {
-            Neighbor() = default;
-            Neighbor(sf::Vector2f* p, size_t i) : position(p), id(i) {}
-
-            //! \brief World coordinate position. Use a pointer to track updates
-            sf::Vector2f* position = nullptr;
-            //! \brief Reference to the graph node.
-            size_t id;
-        };
-
-        //! \brief World coordinate position. Position are randomized between 0
-        //! and 1. The scaling to the windows dimension is made later since we
-        //! prefer this astructure does know to the windows class.
-        sf::Vector2f position =
-        {
-            float(rand()) / float(RAND_MAX),
-            float(rand()) / float(RAND_MAX)
-        };
+        //! \brief World coordinate position. Initialized by reset() (see
+        //! Initialization).
+        Vector position = Space<D>::splat(0.0f);
 
         //! \brief Displacement due to attractive and reuplsive forces.
-        sf::Vector2f displacement = { 0.0f, 0.0f };
-        //! \brief List of neighboring nodes.
-        std::vector<ForceDirectedGraph::Vertex::Neighbor> neighbors;
+        Vector displacement = Space<D>::splat(0.0f);
         //! \brief Color
         sf::Color color;
+    };
+
+    using Vertices = std::vector<Vertex>;
+
+    // *************************************************************************
+    //! \brief Indices in vertices() of the neighbors of a vertex. This is a
+    //! view on the compressed sparse row adjacency (no copy).
+    // *************************************************************************
+    struct Neighbors
+    {
+        uint32_t const* first;
+        uint32_t const* last;
+
+        inline uint32_t const* begin() const { return first; }
+        inline uint32_t const* end() const { return last; }
+        inline size_t size() const { return size_t(last - first); }
+    };
+
+    // *************************************************************************
+    //! \brief Position of a graph node in a layout, independent of the
+    //! vertex indices (for example, a layout saved in a file).
+    // *************************************************************************
+    struct Placement
+    {
         //! \brief Reference to the graph node.
-        size_t id;
+        DiGraph::Node id;
+        //! \brief World coordinate position.
+        Vector position;
+        //! \brief Number of neighbors of the node in the layout.
+        uint32_t degree;
+    };
+
+    //! \brief Placements sorted by node identifiers.
+    using Placements = std::vector<Placement>;
+
+    // *************************************************************************
+    //! \brief Algorithm computing the repulsive forces.
+    // *************************************************************************
+    enum class Repulsion
+    {
+        //! \brief Exact O(N^2) sum over all pairs of vertices.
+        Exact,
+        //! \brief Barnes-Hut O(N log N) approximation using a quadtree (an
+        //! octree in 3D).
+        BarnesHut,
+        //! \brief Exact O(N^2) sum vectorized with AVX2 or SSE2.
+        SIMD,
+        //! \brief O(N) sum over vertices closer than a cutoff distance using
+        //! a uniform grid.
+        CellList
+    };
+
+    // *************************************************************************
+    //! \brief How the temperature (maximum step length of vertices) evolves.
+    // *************************************************************************
+    enum class Cooling
+    {
+        //! \brief Temperature decays by a fixed factor at each step.
+        Fixed,
+        //! \brief Adaptive step length of Yifan Hu driven by the energy of
+        //! the system: the step grows while the energy keeps decreasing and
+        //! shrinks otherwise.
+        Adaptive
+    };
+
+    // *************************************************************************
+    //! \brief How reset() places vertices.
+    // *************************************************************************
+    enum class Initialization
+    {
+        //! \brief Pseudo-random positions given by a hash of the seed and of
+        //! the graph node: reproducible whatever the number of threads and
+        //! the order nodes were inserted.
+        Random,
+        //! \brief Radial tree drawing of the folder hierarchy: roots at the
+        //! center, each depth on a circle, and each node owning an angular
+        //! sector proportional to its number of leaves. Much closer to the
+        //! final layout than random positions.
+        Radial
     };
 
-    using Vertices = std::vector<ForceDirectedGraph::Vertex>;
+    // *************************************************************************
+    //! \brief Model minimized by update().
+    // *************************************************************************
+    enum class Engine
+    {
+        //! \brief Spring and repulsion forces of Fruchterman and Reingold.
+        Forces,
+        //! \brief Sparse stress majorization (Ortmann, Klimenta and Brandes)
+        //! seeded by pivot MDS (Brandes and Pich): reset() computes graph
+        //! distances from a few pivots by breadth first searches and places
+        //! vertices by classical scaling of them. Each step moves vertices
+        //! to the weighted mean of the positions matching their graph
+        //! distance to neighbors and pivots.
+        Stress
+    };
+
+    // *************************************************************************
+    //! \brief How leaves (bookmarks and empty folders) are laid out.
+    // *************************************************************************
+    enum class Leaves
+    {
+        //! \brief Leaves are vertices of the simulation like folders.
+        Simulated,
+        //! \brief Only folders are simulated, each one weighing as much as
+        //! its leaves and taking the room of the disk (ball in 3D) they cover.
+        //! After each step, leaves are placed on a sunflower spiral around
+        //! their folder. Bookmark exports hold 5 to 20 times more leaves than
+        //! folders.
+        Fans
+    };
+
+    // *************************************************************************
+    //! \brief Force laws of the Forces engine (see ForceModels.hpp).
+    // *************************************************************************
+    enum class ForceModel
+    {
+        //! \brief Attraction d^2 / K, repulsion K^2 / d.
+        FruchtermanReingold,
+        //! \brief Linear attraction, repulsion weighted by the degrees plus
+        //! one of both vertices (hubs repel each other about deg^2 times
+        //! harder than leaves) and adaptive speed of each vertex against
+        //! oscillations.
+        ForceAtlas2,
+        //! \brief Constant attraction, repulsion 1 / d: clusters stand out.
+        LinLog
+    };
 
 public:
 
@@ -106,7 +248,7 @@ public:
     //! \brief Default constructor. Set the dimension of the layout and set
     //! the reference to the graph we have to display.
     //----------------------------------------------------------------------
-    ForceDirectedGraph(sf::Vector2f const dimension, DiGraph& digraph);
+    ForceDirectedLayout(Vector const dimension, DiGraph const& digraph);
 
     //----------------------------------------------------------------------
     //! \brief Restore initial states.
@@ -119,6 +261,330 @@ public:
     //----------------------------------------------------------------------
     void update();
 
+    //----------------------------------------------------------------------
+    //! \brief To be called instead of reset() after nodes have been added to
+    //! or removed from the graph: warm start from the current layout. Nodes
+    //! still present keep their position, new nodes are placed near their
+    //! parent folder, and only nodes close (in the graph) to the changes are
+    //! relaxed: other vertices are frozen and stay still unless a moving
+    //! vertex comes near them.
+    //! \param[in] iterations maximum number of steps made before returning.
+    //! Next calls to update() continue to settle the layout if needed.
+    //! \param[in] hops nodes at this number of edges or less from a new node
+    //! or from a node whose neighborhood changed are relaxed.
+    //----------------------------------------------------------------------
+    void incremental(size_t const iterations = 50u, size_t const hops = 2u);
+
+    //----------------------------------------------------------------------
+    //! \brief Same than incremental() but warm start from the given layout
+    //! instead of the current one (for example, a layout loaded from a file
+    //! for a slightly different graph).
+    //----------------------------------------------------------------------
+    void incremental(Placements const& previous, size_t const iterations = 50u,
+                     size_t const hops = 2u);
+
+    //----------------------------------------------------------------------
+    //! \brief Reset and place nodes as given, without simulating: the layout
+    //! is considered as converged. Nodes missing from the placements keep a
+    //! random position.
+    //----------------------------------------------------------------------
+    void restore(Placements const& placements);
+
+    //----------------------------------------------------------------------
+    //! \brief Return the current layout, sorted by node identifiers.
+    //----------------------------------------------------------------------
+    Placements placements() const;
+
+    //----------------------------------------------------------------------
+    //! \brief Restore initial states and compute the layout with the
+    //! multilevel scheme: build a hierarchy of coarser graphs by merging
+    //! bookmarks into their folder (or by matching neighboring nodes when the
+    //! graph does not shrink enough), lay out the coarsest graph, then for each
+    //! finer level place nodes at the position of their coarse node and refine
+    //! them with a few steps.
+    //! With the stress engine, the pivot MDS made by reset() already is a
+    //! global layout: only reset() is called.
+    //! \param[in] refinements number of steps made on each finer level.
+    //----------------------------------------------------------------------
+    void multilevel(size_t const refinements = 30u);
+
+    //----------------------------------------------------------------------
+    //! \brief Restore initial states and compute the layout by divide and
+    //! conquer on the folder hierarchy: each subtree having at least the
+    //! given number of nodes is laid out on its own, with its own large
+    //! subtrees standing for a single node. Independent small subtrees are
+    //! laid out concurrently, large ones one at a time with parallel loops.
+    //! Finished subtrees are then packed as rigid disks around the nodes of
+    //! their parent subtree, bottom-up. The cost is the sum of the squared
+    //! sizes of the subtrees instead of the squared size of the whole graph.
+    //! A few steps finally smooth the seams: only vertices near the edges
+    //! between subtrees are active (other ones wake up if needed).
+    //! \param[in] threshold minimal number of nodes of a subtree laid out on
+    //! its own.
+    //! \param[in] refinements number of steps made on the whole graph.
+    //----------------------------------------------------------------------
+    void hierarchical(size_t const threshold = 64u, size_t const refinements = 30u);
+
+    //----------------------------------------------------------------------
+    //! \brief Post-pass removing overlaps between the disks (balls in 3D)
+    //! drawn for vertices, to be called once the layout has converged: more
+    //! steps of forces would be far more expensive for the same result.
+    //! The layout is first stretched to its bounds (an affine map keeps edge
+    //! crossings) and crowded regions flow into sparse ones, following the
+    //! gradient of the density of vertices on a coarse grid. Then a proximity
+    //! stress in the spirit of PRISM: pairs of vertices closer than
+    //! SEPARATION_PROXIMITY diameters (found through a uniform grid) aim to
+    //! keep their distance, overlapping ones a slightly grown one, and leaves
+    //! mostly slide along their edge. A few parallel Jacobi sweeps move whole
+    //! neighborhoods together, and the layout is fitted back into its bounds
+    //! at each iteration. Unless the layout is crowded, moves of both steps
+    //! are shortened as in ImPrEd so that no vertex passes over an edge,
+    //! except leaves over the edges of other leaves during the stress. Overlaps left are removed by a
+    //! scan-line compaction per axis: vertices are scanned in the order of
+    //! their coordinate and pushed forward by the minimal gap to the vertices
+    //! already placed; a backward scan runs in parallel and both are averaged.
+    //! Pairs keep their order along the axis. Last, leaves of different
+    //! folders whose edges cross swap their places (2-opt), which keeps the
+    //! places free of overlaps. When the layout is too small to hold the
+    //! vertices loosely packed, the diameter kept between them is shrunk
+    //! instead.
+    //! \param[in] radius radius of the drawn vertices.
+    //! \param[in] iterations maximum number of stress iterations.
+    //! \return the number of vertices still overlapping another one (with
+    //! the given radius): none unless the layout is too small.
+    //----------------------------------------------------------------------
+    size_t separate(float const radius = NODE_RADIUS, size_t const iterations = 50u);
+
+    //----------------------------------------------------------------------
+    //! \brief Return true when the layout has converged: update() does
+    //! nothing. This happens when the temperature is too cold, when all
+    //! vertices are frozen or when no vertex has moved more than the
+    //! tolerance during the last step.
+    //----------------------------------------------------------------------
+    inline bool converged() const
+    {
+        return m_converged;
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Return the energy of the system during the last step: the sum
+    //! of squared norms of the forces applied on active vertices (the stress
+    //! of their terms with the stress engine).
+    //----------------------------------------------------------------------
+    inline float energy() const
+    {
+        return m_energy;
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Return the number of vertices which are not frozen.
+    //----------------------------------------------------------------------
+    inline size_t active() const
+    {
+        return m_fans ? m_fans->layout->active() : m_active.size();
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Select how the temperature evolves. Can be changed at any time.
+    //----------------------------------------------------------------------
+    inline void cooling(Cooling const mode)
+    {
+        m_cooling = mode;
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Return how the temperature evolves.
+    //----------------------------------------------------------------------
+    inline Cooling cooling() const
+    {
+        return m_cooling;
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Enable or disable the freezing of calm vertices. Disabling it
+    //! takes effect at the next reset().
+    //----------------------------------------------------------------------
+    inline void freezing(bool const enable)
+    {
+        m_freezing = enable;
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Set the tolerance (factor of K): a vertex moving less than it
+    //! during several steps is frozen and the layout has converged when no
+    //! vertex moves more than it.
+    //----------------------------------------------------------------------
+    inline void tolerance(float const factor)
+    {
+        m_tolerance = std::max(0.0f, factor);
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Select how vertices are placed. Takes effect at the next
+    //! reset().
+    //----------------------------------------------------------------------
+    inline void initialization(Initialization const mode)
+    {
+        m_initialization = mode;
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Return how vertices are placed.
+    //----------------------------------------------------------------------
+    inline Initialization initialization() const
+    {
+        return m_initialization;
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Set the seed of pseudo-random positions (initial positions and
+    //! offsets of nodes placed near another one). Takes effect at the next
+    //! reset().
+    //----------------------------------------------------------------------
+    inline void seed(uint64_t const value)
+    {
+        m_seed = value;
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Return the seed of pseudo-random positions.
+    //----------------------------------------------------------------------
+    inline uint64_t seed() const
+    {
+        return m_seed;
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Select the model minimized by update(). Takes effect at the
+    //! next reset().
+    //----------------------------------------------------------------------
+    inline void engine(Engine const mode)
+    {
+        m_engine = mode;
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Return the model minimized by update().
+    //----------------------------------------------------------------------
+    inline Engine engine() const
+    {
+        return m_engine;
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Select how leaves are laid out. Takes effect at the next
+    //! reset().
+    //----------------------------------------------------------------------
+    inline void leaves(Leaves const mode)
+    {
+        m_leaves = mode;
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Return how leaves are laid out.
+    //----------------------------------------------------------------------
+    inline Leaves leaves() const
+    {
+        return m_leaves;
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Select the force laws of the Forces engine. Can be changed at
+    //! any time, taking effect on the next step.
+    //----------------------------------------------------------------------
+    inline void model(ForceModel const laws)
+    {
+        m_model = laws;
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Return the force laws of the Forces engine.
+    //----------------------------------------------------------------------
+    inline ForceModel model() const
+    {
+        return m_model;
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Set the number of pivots of the stress engine. More pivots
+    //! give a better approximation of the full stress but cost more per
+    //! step. Takes effect at the next reset().
+    //----------------------------------------------------------------------
+    inline void pivots(size_t const count)
+    {
+        m_pivot_count = std::max(size_t(D + 1u), count);
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Return the number of pivots of the stress engine.
+    //----------------------------------------------------------------------
+    inline size_t pivots() const
+    {
+        return m_pivot_count;
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Select the algorithm computing repulsive forces. Can be changed
+    //! at any time, even from another thread than the one computing the
+    //! layout, taking effect on the next step.
+    //----------------------------------------------------------------------
+    inline void repulsion(Repulsion const mode)
+    {
+        m_repulsion = mode;
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Return the algorithm computing repulsive forces.
+    //----------------------------------------------------------------------
+    inline Repulsion repulsion() const
+    {
+        return m_repulsion;
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Set the opening angle of the Barnes-Hut approximation. Lower
+    //! values are more accurate but slower: 0 is equivalent to the exact mode.
+    //----------------------------------------------------------------------
+    inline void theta(float const angle)
+    {
+        m_theta = std::max(0.0f, angle);
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Return the opening angle of the Barnes-Hut approximation.
+    //----------------------------------------------------------------------
+    inline float theta() const
+    {
+        return m_theta;
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Set the cutoff distance of the cell list mode, expressed as a
+    //! factor of the optimal distance K between vertices.
+    //----------------------------------------------------------------------
+    inline void cutoff(float const factor)
+    {
+        m_cutoff = std::max(0.1f, factor);
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Return the cutoff distance of the cell list mode, expressed as a
+    //! factor of the optimal distance K between vertices.
+    //----------------------------------------------------------------------
+    inline float cutoff() const
+    {
+        return m_cutoff;
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Getter of the SIMD engine (for example to force the instruction
+    //! set).
+    //----------------------------------------------------------------------
+    inline SoALayout& soa()
+    {
+        return m_soa;
+    }
+
     //----------------------------------------------------------------------
     //! \brief Const getter of vertices.
     //----------------------------------------------------------------------
@@ -127,17 +593,38 @@ public:
         return m_vertices;
     }
 
+    //----------------------------------------------------------------------
+    //! \brief Return the indices in vertices() of the neighbors of the given
+    //! vertex. Edges are undirected: each edge is seen from both vertices.
+    //! \param[in] vertex index in vertices().
+    //----------------------------------------------------------------------
+    inline Neighbors neighbors(size_t const vertex) const
+    {
+        uint32_t const* adjacency = m_adjacency.data();
+        return { adjacency + m_offsets[vertex], adjacency + m_offsets[vertex + 1u] };
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Return the Firefox identifier of the graph node of the given
+    //! vertex.
+    //! \param[in] vertex index in vertices().
+    //----------------------------------------------------------------------
+    inline DiGraph::Node id(size_t const vertex) const
+    {
+        return m_digraph.id(DiGraph::Index(vertex));
+    }
+
     //----------------------------------------------------------------------
     //! \brief Print on the console the graph.
     //----------------------------------------------------------------------
-    friend std::ostream& operator<<(std::ostream& os, ForceDirectedGraph const& g)
+    friend std::ostream& operator<<(std::ostream& os, ForceDirectedLayout const& g)
     {
-        for (auto const& vertex: g.m_vertices)
+        for (size_t n = 0u; n < g.m_vertices.size(); ++n)
         {
-            os << vertex.id << ":";
-            for (auto const& neighbor: vertex.neighbors)
+            os << g.id(n) << ":";
+            for (auto const& neighbor: g.neighbors(n))
             {
-                os << " " << neighbor.id;
+                os << " " << g.id(neighbor);
             }
             os << std::endl;
         }
@@ -146,63 +633,581 @@ public:
 
 private:
 
+    //! \brief Index in the coarser graph of the node standing for each node
+    //! of a graph.
+    using Coarsening = std::vector<DiGraph::Index>;
+
+    // *************************************************************************
+    //! \brief Subtree laid out on its own by hierarchical().
+    // *************************************************************************
+    struct Cluster
+    {
+        //! \brief Index of the vertex at the top of the subtree.
+        uint32_t root = 0u;
+        //! \brief Index of the enclosing cluster.
+        uint32_t parent = 0u;
+        //! \brief Indices of the vertices of the cluster (not of its
+        //! sub-clusters).
+        std::vector<uint32_t> members;
+        //! \brief Indices of the sub-clusters.
+        std::vector<uint32_t> children;
+        //! \brief Center of the bounding circle (sphere in 3D) of the whole
+        //! subtree, in the frame of the cluster.
+        Vector center;
+        //! \brief Radius of the bounding circle of the whole subtree.
+        float radius = 0.0f;
+        //! \brief Position of the frame of the cluster in the frame of the
+        //! enclosing cluster.
+        Vector offset;
+    };
+
+    // *************************************************************************
+    //! \brief Folder-only layout simulated in the Leaves::Fans mode.
+    // *************************************************************************
+    struct Fans
+    {
+        //! \brief Graph of the folders (nodes keep their Firefox identifier).
+        DiGraph digraph;
+        //! \brief Layout of the folders: its k-th vertex is the vertex
+        //! folders[k] of the whole layout.
+        std::unique_ptr<ForceDirectedLayout> layout;
+        //! \brief Vertex of each folder.
+        std::vector<uint32_t> folders;
+        //! \brief Folder (index in layout) of each vertex: itself for folders,
+        //! its parent for leaves.
+        std::vector<uint32_t> folder_of;
+        //! \brief Compressed sparse rows: leaves of the k-th folder are
+        //! leaves[offsets[k]] to leaves[offsets[k + 1] - 1].
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> leaves;
+        //! \brief Distance between the spires of the spirals.
+        float spacing = 0.0f;
+    };
+
+    //----------------------------------------------------------------------
+    //! \brief Binary search of the placement of the given node.
+    //! \return placements.end() if not found.
+    //----------------------------------------------------------------------
+    static typename Placements::const_iterator find(Placements const& placements,
+                                                    DiGraph::Node const id);
+
+    //----------------------------------------------------------------------
+    //! \brief Build a coarser graph by merging each leaf into its parent
+    //! (i.e. bookmarks into their folder). When this does not reduce enough the
+    //! number of nodes, fall back on merging pairs of neighboring nodes.
+    //! \param[in] fine the graph to coarsen.
+    //! \param[out] coarse the coarser graph.
+    //! \param[out] coarsening the coarse node of each fine node.
+    //----------------------------------------------------------------------
+    static void coarsen(DiGraph const& fine, DiGraph& coarse, Coarsening& coarsening);
+
+    //----------------------------------------------------------------------
+    //! \brief Pseudo-random position in [0 1]^D of the given graph node,
+    //! depending only on the seed and on the node.
+    //----------------------------------------------------------------------
+    Vector random(DiGraph::Node const id) const;
+
+    //----------------------------------------------------------------------
+    //! \brief SplitMix64 finalizer.
+    //----------------------------------------------------------------------
+    static inline uint64_t mix(uint64_t z)
+    {
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Position of the j-th leaf of a fan relative to its folder.
+    //! Vogel's sunflower spiral in 2D (radius growing as sqrt(j), golden
+    //! angle between consecutive leaves), its analog in 3D (radius growing as
+    //! cbrt(j), low discrepancy directions): each leaf covers the same area
+    //! (volume) whatever the number of leaves.
+    //----------------------------------------------------------------------
+    static Vector fan(size_t const j, float const spacing);
+
+    //----------------------------------------------------------------------
+    //! \brief Build the folder-only layout of the Leaves::Fans mode: masses
+    //! and radii of the folders come from their leaves.
+    //----------------------------------------------------------------------
+    void fans();
+
+    //----------------------------------------------------------------------
+    //! \brief Copy positions of the folder-only layout to the folders and
+    //! place leaves on their fan.
+    //----------------------------------------------------------------------
+    void spread();
+
+    //----------------------------------------------------------------------
+    //! \brief Copy positions of the folders to the folder-only layout.
+    //----------------------------------------------------------------------
+    void gather();
+
+    //----------------------------------------------------------------------
+    //! \brief Mass of the given vertex: the number of vertices it stands for.
+    //----------------------------------------------------------------------
+    inline float mass(size_t const vertex) const
+    {
+        return m_masses.empty() ? 1.0f : m_masses[vertex];
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Repulsive charge of the given vertex: its mass, times its
+    //! degree plus one for degree weighted models.
+    //----------------------------------------------------------------------
+    template<class Model>
+    inline float charge(size_t const vertex) const
+    {
+        return Model::DEGREE_WEIGHTED ? m_charges[vertex] : mass(vertex);
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Factor of the repulsion received by the given vertex: its own
+    //! charge for degree weighted models, else 1.
+    //----------------------------------------------------------------------
+    template<class Model>
+    inline float receptivity(size_t const vertex) const
+    {
+        return Model::DEGREE_WEIGHTED ? m_charges[vertex] : 1.0f;
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Radius of the fan of leaves around the given vertex.
+    //----------------------------------------------------------------------
+    inline float radius(size_t const vertex) const
+    {
+        return m_radii.empty() ? 0.0f : m_radii[vertex];
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Breadth first spanning forest of the directed graph, from the
+    //! nodes without parent.
+    //! \param[out] parents index of the parent of each vertex (max value for
+    //! roots).
+    //! \param[out] order vertices in traversal order: parents before their
+    //! children.
+    //! \param[out] depths number of edges between each vertex and its root.
+    //----------------------------------------------------------------------
+    void tree(std::vector<uint32_t>& parents, std::vector<uint32_t>& order,
+              std::vector<uint32_t>& depths) const;
+
+    //----------------------------------------------------------------------
+    //! \brief Place vertices in [0 1]^D as a radial tree drawing of the
+    //! graph. In 3D the drawing is a disk slightly thickened along z.
+    //----------------------------------------------------------------------
+    void radial();
+
+    //----------------------------------------------------------------------
+    //! \brief Distances in number of edges from the given vertex to all
+    //! vertices (max value for unreachable ones).
+    //----------------------------------------------------------------------
+    void bfs(size_t const source, std::vector<uint32_t>& distances) const;
+
+    //----------------------------------------------------------------------
+    //! \brief Choose pivots, compute graph distances to them and the weights
+    //! of the sparse stress model, then place vertices by pivot MDS.
+    //! \pre The adjacency shall be built.
+    //! \return false if the graph is too small for the stress engine.
+    //----------------------------------------------------------------------
+    bool pivot_mds();
+
+    //----------------------------------------------------------------------
+    //! \brief One iteration of sparse stress majorization: set the
+    //! displacement of active vertices toward their new position.
+    //! \return the stress of the terms of active vertices before moving.
+    //----------------------------------------------------------------------
+    float majorize();
+
+    //----------------------------------------------------------------------
+    //! \brief Restrict the active set to the vertices at the given number of
+    //! edges or less from the touched vertices: other vertices are frozen.
+    //----------------------------------------------------------------------
+    void activate(std::vector<uint32_t> touched, size_t const hops);
+
+    //----------------------------------------------------------------------
+    //! \brief Lay out a cluster for hierarchical() once its sub-clusters
+    //! have been laid out: compute positions of its members in its own frame
+    //! (the root of the cluster at the origin), pack its sub-clusters and
+    //! compute its bounding circle.
+    //----------------------------------------------------------------------
+    void layout(std::vector<Cluster>& clusters, size_t const current,
+                std::vector<uint32_t> const& cluster_of,
+                std::vector<Vector>& local, size_t const refinements) const;
+
+    //----------------------------------------------------------------------
+    //! \brief Initialize positions from the layout of the coarser graph:
+    //! each vertex is placed near its coarse vertex.
+    //----------------------------------------------------------------------
+    void prolong(ForceDirectedLayout const& coarse, Coarsening const& coarsening);
+
+    //----------------------------------------------------------------------
+    //! \brief Copy all settings from another layout.
+    //----------------------------------------------------------------------
+    void settings(ForceDirectedLayout const& other);
+
+    //----------------------------------------------------------------------
+    //! \brief Copy the settings to the layout of the folders when leaves
+    //! are laid out on fans, so that setters called on this layout (even
+    //! from another thread) reach the simulated folders on their next step.
+    //----------------------------------------------------------------------
+    void forward();
+
+    //----------------------------------------------------------------------
+    //! \brief Do at most the given number of steps while temperature is hot.
+    //----------------------------------------------------------------------
+    void relax(size_t const iterations);
+
+    //----------------------------------------------------------------------
+    //! \brief Exclusive prefix sum: offsets[i] = counts[0] + ... + counts[i-1].
+    //----------------------------------------------------------------------
+    static void prefix_sum(std::vector<uint32_t> const& counts,
+                           std::vector<uint32_t>& offsets);
+
     //----------------------------------------------------------------------
     //! \brief Do a single step for computing forces.
     //----------------------------------------------------------------------
     void step();
 
+    //----------------------------------------------------------------------
+    //! \brief Step of the Forces engine with the given force laws:
+    //! repulsion, attraction, displacement, freezing and cooling.
+    //----------------------------------------------------------------------
+    template<class Model>
+    void forces(Model const& model);
+
+    //----------------------------------------------------------------------
+    //! \brief Repulsive forces: exact sum over all pairs of vertices.
+    //----------------------------------------------------------------------
+    template<class Model>
+    void repulsion_exact(Model const& model);
+
+    //----------------------------------------------------------------------
+    //! \brief Exact repulsion of repulsion_exact(): each pair of active
+    //! vertices is computed once, the force being applied on both vertices
+    //! with opposite signs (i.e. half the computations), and each active
+    //! vertex sums the forces of the frozen vertices on its own. Each thread
+    //! accumulates its forces in its own array of one vector per active
+    //! vertex (see m_accumulators).
+    //----------------------------------------------------------------------
+    template<class Model>
+    void repulsion_pairs(Model const& model);
+
+    //----------------------------------------------------------------------
+    //! \brief Repulsive forces: Barnes-Hut approximation.
+    //----------------------------------------------------------------------
+    template<class Model>
+    void repulsion_barnes_hut(Model const& model);
+
+    //----------------------------------------------------------------------
+    //! \brief Repulsive forces: exact sum made by SIMD kernels.
+    //----------------------------------------------------------------------
+    template<class Model>
+    void repulsion_simd(Model const& model);
+
+    //----------------------------------------------------------------------
+    //! \brief Repulsive forces: vertices closer than the cutoff distance
+    //! found through a uniform grid of cells of the same dimension.
+    //----------------------------------------------------------------------
+    template<class Model>
+    void repulsion_cell_list(Model const& model);
+
+    //----------------------------------------------------------------------
+    //! \brief Return the number of vertices closer than the given diameter
+    //! to another one.
+    //----------------------------------------------------------------------
+    size_t overlapping(float const diameter);
+
+    //----------------------------------------------------------------------
+    //! \brief Shorten the moves of vertices from their position to the
+    //! given next ones so that no vertex passes over an edge (in 2D): edge
+    //! crossings are kept. Only pairs closer than the given range limit
+    //! each other.
+    //! \param[in] loose_leaves if true, leaves may still pass over the
+    //! edges of other leaves.
+    //----------------------------------------------------------------------
+    void restrain(std::vector<Vector>& next, float const range, bool const loose_leaves);
+
+    //----------------------------------------------------------------------
+    //! \brief Swap the places of leaves of different parents whose edges
+    //! cross (in 2D), for at most the given number of rounds.
+    //----------------------------------------------------------------------
+    void untangle(size_t const rounds);
+
+    //----------------------------------------------------------------------
+    //! \brief Scale (per axis) and translate vertices so that they fit
+    //! inside the layout bounds.
+    //! \param[in] stretch if true, the layout is also scaled up to fill them.
+    //----------------------------------------------------------------------
+    void fit(bool const stretch);
+
+    //----------------------------------------------------------------------
+    //! \brief Density-equalizing flow of separate(): vertices of crowded
+    //! cells flow down the gradient of the (smoothed) density of vertices.
+    //! \param[in] restrained if true, moves are shortened by restrain().
+    //----------------------------------------------------------------------
+    void diffuse(float const diameter, bool const restrained);
+
+    //----------------------------------------------------------------------
+    //! \brief Proximity stress of separate(), stopped once no more than the
+    //! given number of vertices overlap.
+    //! \param[in] restrained if true, moves are shortened by restrain(),
+    //! leaves being loose.
+    //----------------------------------------------------------------------
+    void proximity(float const diameter, size_t const iterations, size_t const residual,
+                   bool const restrained);
+
+    //----------------------------------------------------------------------
+    //! \brief Scan-line compaction of separate() along the given axis.
+    //! \param[in] all if false, only pairs the most apart along this axis
+    //! are pushed apart.
+    //----------------------------------------------------------------------
+    void compact(size_t const axis, float const diameter, bool const all);
+
+    //----------------------------------------------------------------------
+    //! \brief Compute the bounding box of vertices.
+    //! \pre m_vertices shall not be empty.
+    //----------------------------------------------------------------------
+    void bounds(Vector& min, Vector& max) const;
+
+    //----------------------------------------------------------------------
+    //! \brief Attractive forces along edges.
+    //----------------------------------------------------------------------
+    template<class Model>
+    void attraction(Model const& model);
+
+    //----------------------------------------------------------------------
+    //! \brief Move vertices along their displacement limited by the
+    //! temperature and constrained to the window bounds.
+    //----------------------------------------------------------------------
+    void displace();
+
+    //----------------------------------------------------------------------
+    //! \brief Adaptive speed of ForceAtlas2: scale the displacement of each
+    //! vertex by s / (1 + sqrt(s swing)), where its swing is its charge times
+    //! the change of its displacement since the last step, and the global
+    //! speed s follows the ratio of the total traction to the total swing,
+    //! rising by 50% at most per step.
+    //----------------------------------------------------------------------
+    void swing();
+
     //----------------------------------------------------------------------
     //! \brief Euclidian norm.
     //! \param[in] p world coordinate position.
     //----------------------------------------------------------------------
-    inline float distance(sf::Vector2f const& p) const
+    inline float distance(Vector const& p) const
     {
-        return std::max(0.001f, sqrtf(p.x * p.x + p.y * p.y));
+        return std::max(0.001f, sqrtf(dot(p, p)));
     }
 
     //----------------------------------------------------------------------
-    //! \brief Compute repulsive force.
-    //! \param[in] distance.
+    //! \brief D-th root: K and the side of sub-layouts derive from a volume.
     //----------------------------------------------------------------------
-    inline float repulsive_force(float const distance) const
+    static inline float root(float const volume)
     {
-        return K * K / distance / float(N) / 2.0f;
+        return (D == 2u) ? sqrtf(volume) : cbrtf(volume);
     }
 
     //----------------------------------------------------------------------
-    //! \brief Compute attractive force.
-    //! \param[in] distance.
+    //! \brief Sum of the dimensions of the layout: initial and maximal
+    //! temperature.
     //----------------------------------------------------------------------
-    inline float attractive_force(float const distance) const
+    inline float extent() const
     {
-        return distance * distance / K / float(N);
+        float sum = 0.0f;
+        for (size_t i = 0u; i < D; ++i)
+        {
+            sum += coordinate(m_dimension, i);
+        }
+        return sum;
     }
 
     //----------------------------------------------------------------------
-    //! \brief Reduce effect of forces.
+    //! \brief Reduce effect of forces: update the temperature (i.e. the
+    //! maximum step length) and the convergence state.
     //----------------------------------------------------------------------
-    inline float cooling()
-    {
-        m_temperature *= 0.98f;
-        return m_temperature;
-    }
+    void cool();
+
+    //----------------------------------------------------------------------
+    //! \brief Update the number of calm steps of active vertices, wake frozen
+    //! vertices close to vertices moving a lot and rebuild the active set.
+    //----------------------------------------------------------------------
+    void freeze();
+
+    //----------------------------------------------------------------------
+    //! \brief Make all vertices active and restart convergence detection.
+    //----------------------------------------------------------------------
+    void wake();
 
 private:
 
     //! \brief The directional graph to display.
-    DiGraph& m_digraph;
+    DiGraph const& m_digraph;
     //! \brief Collection of nodes to display.
     Vertices m_vertices;
-    //! \brief Dimension of the screen.
-    float m_width;
-    //! \brief Dimension of the screen.
-    float m_height;
+    //! \brief Compressed sparse row adjacency: neighbors of the n-th vertex
+    //! are m_adjacency[m_offsets[n]] to m_adjacency[m_offsets[n + 1] - 1].
+    std::vector<uint32_t> m_offsets;
+    //! \brief Compressed sparse row adjacency: indices of neighbors.
+    std::vector<uint32_t> m_adjacency;
+    //! \brief Dimension of the layout (of the screen in 2D).
+    Vector m_dimension;
     //! \brief Reduce effect of forces.
     float m_temperature;
-    //! \brief Force coeficient: sqrt(area / num_vertices)
+    //! \brief Force coeficient: (volume / num_vertices)^(1/D)
     float K;
     //! \brief Number of vertices.
     size_t N;
+    //! \brief Total mass of the vertices (N when they all weigh 1).
+    float m_mass = 0.0f;
+    //! \brief Mass of each vertex. Empty when all vertices weigh 1.
+    std::vector<float> m_masses;
+    //! \brief Radius of the fan of leaves around each vertex. Empty when
+    //! there is no fan.
+    std::vector<float> m_radii;
+    //! \brief Charge of each vertex for degree weighted models: its mass
+    //! times its degree plus one.
+    std::vector<float> m_charges;
+    //! \brief Force laws of the Forces engine.
+    std::atomic<ForceModel> m_model{ForceModel::FruchtermanReingold};
+    //! \brief Force laws of the last step (the adaptive speed restarts when
+    //! they change).
+    ForceModel m_stepped_model = ForceModel::FruchtermanReingold;
+    //! \brief Displacement of each vertex before swing() at the last step.
+    std::vector<Vector> m_previous_forces;
+    //! \brief Global speed of ForceAtlas2.
+    float m_speed = 1.0f;
+    //! \brief How leaves are laid out.
+    std::atomic<Leaves> m_leaves{Leaves::Simulated};
+    //! \brief Folder-only layout when leaves are laid out as fans.
+    std::unique_ptr<Fans> m_fans;
+    //! \brief Algorithm computing repulsive forces.
+    std::atomic<Repulsion> m_repulsion{Repulsion::BarnesHut};
+    //! \brief Opening angle of the Barnes-Hut approximation.
+    std::atomic<float> m_theta{0.8f};
+    //! \brief Spatial structure for the Barnes-Hut approximation.
+    Orthtree<D> m_quadtree;
+    //! \brief Structure-of-arrays copy of positions for the SIMD kernels.
+    SoALayout m_soa;
+    //! \brief Displacements accumulated by each thread in repulsion_pairs()
+    //! (one vector per active vertex and per thread: 8 threads and one
+    //! million vertices take 64 MB in 2D).
+    std::vector<Vector> m_accumulators;
+    //! \brief Cutoff distance of the cell list mode (factor of K).
+    std::atomic<float> m_cutoff{2.0f};
+    //! \brief Spatial structure for the cell list mode.
+    UniformGrid<D> m_grid;
+    //! \brief How the temperature evolves.
+    std::atomic<Cooling> m_cooling{Cooling::Adaptive};
+    //! \brief Enable freezing calm vertices.
+    std::atomic<bool> m_freezing{true};
+    //! \brief Movement tolerance (factor of K) for freezing and convergence.
+    std::atomic<float> m_tolerance{0.01f};
+    //! \brief How reset() places vertices.
+    std::atomic<Initialization> m_initialization{Initialization::Radial};
+    //! \brief Model minimized by update().
+    std::atomic<Engine> m_engine{Engine::Forces};
+    //! \brief Number of pivots of the stress engine.
+    std::atomic<size_t> m_pivot_count{50u};
+    //! \brief Set by reset() when steps are made by stress majorization.
+    bool m_majorization = false;
+    //! \brief Indices of the pivot vertices.
+    std::vector<uint32_t> m_pivots;
+    //! \brief Graph distance between each vertex and each pivot (row n holds
+    //! the distances of the n-th vertex).
+    std::vector<uint32_t> m_pivot_distances;
+    //! \brief Weight of the stress term between each vertex and each pivot
+    //! (same layout than m_pivot_distances).
+    std::vector<float> m_pivot_weights;
+    //! \brief Euclidean length of an edge in the stress model.
+    float m_edge_length = 0.0f;
+    //! \brief Seed of pseudo-random positions.
+    std::atomic<uint64_t> m_seed{0u};
+    //! \brief Indices of vertices which are not frozen.
+    std::vector<uint32_t> m_active;
+    //! \brief Number of consecutive steps each vertex moved less than the
+    //! tolerance. Vertices reaching FREEZE_STEPS are frozen.
+    std::vector<uint8_t> m_calm;
+    //! \brief Distance each vertex moved during the last step.
+    std::vector<float> m_moves;
+    //! \brief Spatial structure to find frozen vertices to wake.
+    UniformGrid<D> m_wake_grid;
+    //! \brief Energy of the last step.
+    float m_energy = 0.0f;
+    //! \brief Energy of the step before.
+    float m_previous_energy = 0.0f;
+    //! \brief Largest move of the last step.
+    float m_largest_move = 0.0f;
+    //! \brief Number of consecutive steps reducing the energy.
+    size_t m_progress = 0u;
+    //! \brief Has the layout converged ?
+    bool m_converged = true;
+    //! \brief Number of calm steps before freezing a vertex.
+    static constexpr uint8_t FREEZE_STEPS = 5u;
+    //! \brief Vertices moving more than WAKE_FACTOR times the tolerance wake
+    //! their neighbors.
+    static constexpr float WAKE_FACTOR = 10.0f;
+    //! \brief The stress engine has converged when the stress decreases by
+    //! less than this fraction in a step.
+    static constexpr float STRESS_TOLERANCE = 1e-4f;
+    //! \brief Clusters of hierarchical() with at least this number of
+    //! vertices are laid out one at a time with parallel loops, smaller ones
+    //! concurrently with serial loops.
+    static constexpr size_t HIERARCHICAL_CUTOFF = 2048u;
+    //! \brief Number of vertices of the tiles of repulsion_pairs(): the
+    //! positions and accumulators of two tiles stay in the L1 cache.
+    static constexpr size_t TILE = 256u;
+    //! \brief Jitter tolerance of ForceAtlas2: ratio of the total swing to
+    //! the total traction aimed by the global speed.
+    static constexpr float SWING_TOLERANCE = 1.0f;
+    //! \brief Maximum rise of the global speed of ForceAtlas2 per step.
+    static constexpr float SPEED_RISE = 0.5f;
+    //! \brief Distance, in diameters, under which separate() keeps the
+    //! distance between two vertices.
+    static constexpr float SEPARATION_PROXIMITY = 1.5f;
+    //! \brief Maximum growth of the distance between two overlapping
+    //! vertices per iteration of separate().
+    static constexpr float SEPARATION_GROWTH = 2.0f;
+    //! \brief Number of Jacobi sweeps per iteration of separate().
+    static constexpr size_t SEPARATION_SWEEPS = 4u;
+    //! \brief Distance aimed by separate() between overlapping vertices, in
+    //! diameters: the margin absorbs fitting the layout into its bounds.
+    static constexpr float SEPARATION_SLACK = 1.05f;
+    //! \brief Maximum diameter kept by separate(), relative to the side of
+    //! the room per vertex.
+    static constexpr float SEPARATION_PACKING = 0.6f;
+    //! \brief Side of the cells of the flow of separate(), in diameters.
+    static constexpr float SEPARATION_FLOW = 2.0f;
+    //! \brief Maximum number of steps of the flow of separate().
+    static constexpr size_t SEPARATION_FLOW_STEPS = 200u;
+    //! \brief Number of steps without progress after which the flow of
+    //! separate() stops.
+    static constexpr size_t SEPARATION_FLOW_PATIENCE = 32u;
+    //! \brief Diffusion rate of the flow of separate() (stable under 0.25).
+    static constexpr float SEPARATION_FLOW_RATE = 0.2f;
+    //! \brief Density (relative to the loosely packed one) under which the
+    //! flow of separate() stops.
+    static constexpr float SEPARATION_FLOW_TARGET = 8.0f;
+    //! \brief Fraction of their move across their edge kept by leaves in
+    //! separate().
+    static constexpr float SEPARATION_SLIDE = 0.2f;
+    //! \brief Share of overlapping vertices under which separate() hands
+    //! over from the proximity stress to the compaction.
+    static constexpr float SEPARATION_RESIDUAL = 0.02f;
+    //! \brief Maximum number of compaction rounds of separate().
+    static constexpr size_t SEPARATION_ROUNDS = 3u;
+    //! \brief Maximum number of rounds of leaf swaps of separate().
+    static constexpr size_t SEPARATION_UNTANGLE = 16u;
+    //! \brief Distance, relative to their range, kept by separate() between
+    //! vertices and edges whose moves are restrained.
+    static constexpr float SEPARATION_CLEARANCE = 0.01f;
+    //! \brief Maximum number of bands along an axis of the compaction of
+    //! separate().
+    static constexpr int32_t SEPARATION_CELLS = (D == 2u) ? 4096 : 256;
 };
 
+//! \brief Layout drawn in the window.
+using ForceDirectedGraph = ForceDirectedLayout<2u>;
+//! \brief Layout in space.
+using ForceDirectedGraph3D = ForceDirectedLayout<3u>;
+
 #endif
@@ -0,0 +1,147 @@
+/* *****************************************************************************
+** MIT License
+**
+** Copyright (c) 2022 Quentin Quadrat
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+********************************************************************************
+*/
+
+#ifndef FORCEMODELS_HPP
+#  define FORCEMODELS_HPP
+
+// *****************************************************************************
+//! \brief Force models of ForceDirectedLayout, given as template policies so
+//! that the force laws are inlined into the repulsion and attraction kernels.
+//! The layout picks the instantiation matching its runtime setting once per
+//! step (see ForceDirectedLayout::ForceModel).
+//!
+//! A model is built from the optimal distance K between vertices and the total
+//! mass of the vertices, and provides:
+//! - repulsion(d): magnitude of the repulsive force between two vertices of
+//!   unit charge at distance d. All models repulse as c / d, which the SIMD
+//!   kernel relies on (it only takes c = repulsion(1)).
+//! - attraction(d): magnitude of the attractive force along an edge of
+//!   length d.
+//! - DEGREE_WEIGHTED: when true, the charge of a vertex is its mass times its
+//!   degree plus one, and the repulsion between two vertices is multiplied by
+//!   both charges (the one of the source and the one of the receiver).
+//!   Otherwise a vertex is only repulsed by the mass of others.
+//! - ADAPTIVE_SPEED: when true, the displacement of each vertex is damped by
+//!   its swinging (change of force between two steps) and scaled by a global
+//!   speed adapted to the overall swinging and traction.
+//!
+//! Constants are chosen so that all models attract and repulse as much as
+//! Fruchterman-Reingold for an edge of length K between vertices of unit
+//! charge: the same window, temperature and tolerance fit all of them. The
+//! charges of ForceAtlas2 are at least 2 for connected vertices, so its
+//! repulsion is at least 4 times the one of Fruchterman-Reingold.
+// *****************************************************************************
+
+// *****************************************************************************
+//! \brief Fruchterman and Reingold: attraction d^2 / K, repulsion K^2 / d.
+// *****************************************************************************
+struct FruchtermanReingold
+{
+    static constexpr bool DEGREE_WEIGHTED = false;
+    static constexpr bool ADAPTIVE_SPEED = false;
+
+    FruchtermanReingold(float const k, float const mass)
+        : K(k), m_mass(mass)
+    {}
+
+    inline float repulsion(float const distance) const
+    {
+        return K * K / distance / m_mass / 2.0f;
+    }
+
+    inline float attraction(float const distance) const
+    {
+        return distance * distance / K / m_mass;
+    }
+
+    float K;
+    float m_mass;
+};
+
+// *****************************************************************************
+//! \brief ForceAtlas2 of Jacomy et al.: linear attraction d, repulsion
+//! m(i) (deg(i) + 1) m(j) (deg(j) + 1) / d with m the masses (1 unless the
+//! vertices are folders carrying fans of leaves), and adaptive swinging
+//! speed per vertex. Two hubs of degree n repel each other (n + 1)^2 / 4
+//! times harder than two leaves at the same distance, and a hub is pushed
+//! by a leaf (n + 1) / 2 times harder: the repulsion grows with the product
+//! of the degrees while the attraction of a hub only grows with its number
+//! of edges, so hubs end up far apart with their neighbors around them.
+//! There is no gravity: bookmark graphs are trees (connected) and the
+//! window bounds the layout.
+// *****************************************************************************
+struct ForceAtlas2
+{
+    static constexpr bool DEGREE_WEIGHTED = true;
+    static constexpr bool ADAPTIVE_SPEED = true;
+
+    ForceAtlas2(float const k, float const mass)
+        : m_repulsion(k * k / mass / 2.0f), m_attraction(1.0f / mass)
+    {}
+
+    inline float repulsion(float const distance) const
+    {
+        return m_repulsion / distance;
+    }
+
+    inline float attraction(float const distance) const
+    {
+        return distance * m_attraction;
+    }
+
+    float m_repulsion;
+    float m_attraction;
+};
+
+// *****************************************************************************
+//! \brief LinLog of Noack: the energy sums edge lengths minus the logarithms
+//! of the distances between all pairs, hence a constant attraction and a
+//! repulsion 1 / d. Clusters of densely connected vertices stand out more
+//! than with Fruchterman-Reingold.
+// *****************************************************************************
+struct LinLog
+{
+    static constexpr bool DEGREE_WEIGHTED = false;
+    static constexpr bool ADAPTIVE_SPEED = false;
+
+    LinLog(float const k, float const mass)
+        : m_repulsion(k * k / mass / 2.0f), m_attraction(k / mass)
+    {}
+
+    inline float repulsion(float const distance) const
+    {
+        return m_repulsion / distance;
+    }
+
+    inline float attraction(float const /*distance*/) const
+    {
+        return m_attraction;
+    }
+
+    float m_repulsion;
+    float m_attraction;
+};
+
+#endif
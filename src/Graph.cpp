@@ -0,0 +1,235 @@
+/* *****************************************************************************
+** MIT License
+**
+** Copyright (c) 2022 Quentin Quadrat
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+********************************************************************************
+*/
+
+#include "Graph.hpp"
+#include <algorithm>
+#include <omp.h>
+
+//------------------------------------------------------------------------------
+void DiGraphBuilder::reset()
+{
+    m_ids.clear();
+    m_indices.clear();
+    m_parents.clear();
+    m_sources.clear();
+    m_destinations.clear();
+}
+
+//------------------------------------------------------------------------------
+void DiGraphBuilder::reserve(size_t const nodes, size_t const edges)
+{
+    m_ids.reserve(nodes);
+    m_indices.reserve(nodes);
+    m_parents.reserve(nodes);
+    m_sources.reserve(edges);
+    m_destinations.reserve(edges);
+}
+
+//------------------------------------------------------------------------------
+void DiGraphBuilder::scatter(size_t const shift, std::vector<Index>& sources,
+                             std::vector<Index>& destinations)
+{
+    static constexpr size_t BUCKETS = size_t(1) << RADIX_BITS;
+    static constexpr Index MASK = Index(BUCKETS - 1u);
+
+    const size_t count = m_sources.size();
+    m_histograms.assign(size_t(omp_get_max_threads()) * BUCKETS, 0u);
+
+    #pragma omp parallel default(shared)
+    {
+        const size_t threads = size_t(omp_get_num_threads());
+        const size_t thread = size_t(omp_get_thread_num());
+        const size_t begin = count * thread / threads;
+        const size_t end = count * (thread + 1u) / threads;
+        uint32_t* histogram = &m_histograms[thread * BUCKETS];
+
+        // Pass 1: count edges of the chunk per digit
+        for (size_t i = begin; i < end; ++i)
+        {
+            ++histogram[(m_sources[i] >> shift) & MASK];
+        }
+
+        #pragma omp barrier
+
+        // Prefix sum: digit by digit then thread by thread, so that chunks
+        // keep their order inside each digit (the sort is stable).
+        #pragma omp single
+        {
+            uint32_t offset = 0u;
+            for (size_t b = 0u; b < BUCKETS; ++b)
+            {
+                for (size_t t = 0u; t < threads; ++t)
+                {
+                    const uint32_t n = m_histograms[t * BUCKETS + b];
+                    m_histograms[t * BUCKETS + b] = offset;
+                    offset += n;
+                }
+            }
+        }
+
+        // Pass 2: scatter edges of the chunk on their digit
+        for (size_t i = begin; i < end; ++i)
+        {
+            const uint32_t slot = histogram[(m_sources[i] >> shift) & MASK]++;
+            sources[slot] = m_sources[i];
+            destinations[slot] = m_destinations[i];
+        }
+    }
+
+    m_sources.swap(sources);
+    m_destinations.swap(destinations);
+}
+
+//------------------------------------------------------------------------------
+DiGraph DiGraphBuilder::build()
+{
+    const size_t count = m_ids.size();
+    const size_t edges = m_sources.size();
+
+    // Least significant digit first radix sort of the edges by source node.
+    // Nothing to do when they were added folder by folder.
+    if (!std::is_sorted(m_sources.begin(), m_sources.end()))
+    {
+        std::vector<Index> sources(edges);
+        std::vector<Index> destinations(edges);
+        for (size_t shift = 0u; (size_t(1) << shift) < count; shift += RADIX_BITS)
+        {
+            scatter(shift, sources, destinations);
+        }
+    }
+
+    // Row of each node: the first edge of a source node closes the rows of
+    // the nodes without edges before it.
+    auto arrays = std::make_shared<DiGraph::Arrays>();
+    std::vector<uint32_t>& offsets = arrays->offsets;
+    offsets.resize(count + 1u);
+    #pragma omp parallel for default(shared) schedule(static)
+    for (size_t i = 0u; i < edges; ++i)
+    {
+        const size_t first = (i == 0u) ? 0u : size_t(m_sources[i - 1u]) + 1u;
+        for (size_t n = first; n <= m_sources[i]; ++n)
+        {
+            offsets[n] = uint32_t(i);
+        }
+    }
+    const size_t last = (edges == 0u) ? 0u : size_t(m_sources[edges - 1u]) + 1u;
+    for (size_t n = last; n <= count; ++n)
+    {
+        offsets[n] = uint32_t(edges);
+    }
+
+    arrays->ids.swap(m_ids);
+    arrays->indices.swap(m_indices);
+    arrays->parents.swap(m_parents);
+    arrays->destinations.swap(m_destinations);
+    reset();
+
+    DiGraph graph;
+    graph.own(arrays);
+    return graph;
+}
+
+//------------------------------------------------------------------------------
+void DiGraph::own(std::shared_ptr<Arrays> const& arrays)
+{
+    m_size = arrays->ids.size();
+    m_ids = arrays->ids.data();
+    m_indices = &arrays->indices;
+    m_order = nullptr;
+    m_offsets = arrays->offsets.data();
+    m_destinations = arrays->destinations.data();
+    m_parents = arrays->parents.data();
+    m_storage = arrays;
+}
+
+//------------------------------------------------------------------------------
+DiGraph::Index DiGraph::search(Node const node) const
+{
+    Index const* const end = m_order + m_size;
+    Index const* it = std::lower_bound(m_order, end, node,
+                                       [this](Index const index, Node const id)
+                                       {
+                                           return m_ids[index] < id;
+                                       });
+    return ((it != end) && (m_ids[*it] == node)) ? *it : Index(npos);
+}
+
+//------------------------------------------------------------------------------
+uint64_t DiGraphLog::commit()
+{
+    if (m_changes.empty() || (m_changes.back().epoch == m_epoch))
+        return m_epoch;
+
+    ++m_epoch;
+
+    // Drop the oldest epochs, down to half the capacity so that this happens
+    // once in a while.
+    if (m_changes.size() > m_capacity)
+    {
+        auto last = m_changes.end() - std::ptrdiff_t(std::max(m_capacity / 2u, size_t(1)));
+        if (last->epoch == m_epoch)
+        {
+            // The last commit alone does not fit: keep it whole
+            last = std::lower_bound(m_changes.begin(), m_changes.end(), m_epoch,
+                                    [](Change const& change, uint64_t const epoch)
+                                    {
+                                        return change.epoch < epoch;
+                                    });
+        }
+        else if ((last != m_changes.begin()) && ((last - 1)->epoch == last->epoch))
+        {
+            // Do not split an epoch
+            const uint64_t epoch = last->epoch;
+            while ((last != m_changes.end()) && (last->epoch == epoch))
+            {
+                ++last;
+            }
+        }
+        if (last != m_changes.begin())
+        {
+            m_dropped = (last - 1)->epoch;
+            m_changes.erase(m_changes.begin(), last);
+        }
+    }
+
+    return m_epoch;
+}
+
+//------------------------------------------------------------------------------
+DiGraphLog::Changes DiGraphLog::changes(uint64_t const since) const
+{
+    auto const first = std::upper_bound(m_changes.begin(), m_changes.end(), since,
+                                        [](uint64_t const epoch, Change const& change)
+                                        {
+                                            return epoch < change.epoch;
+                                        });
+    auto const last = std::upper_bound(first, m_changes.end(), m_epoch,
+                                       [](uint64_t const epoch, Change const& change)
+                                       {
+                                           return epoch < change.epoch;
+                                       });
+    return Changes(m_changes.data() + (first - m_changes.begin()),
+                   m_changes.data() + (last - m_changes.begin()));
+}
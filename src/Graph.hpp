@@ -26,46 +26,245 @@
 #ifndef GRAPH_HPP
 #  define GRAPH_HPP
 
-#  include <map>
-#  include <set>
+#  include <unordered_map>
 #  include <vector>
+#  include <limits>
 #  include <iostream>
+#  include <memory>
+#  include <cstdint>
+
+class DiGraphBuilder;
+class IslandSnapshot;
 
 // *****************************************************************************
-//! \brief Directed graph structure. This structure is not the faster but allows
-//! to write compact code.
+//! \brief Immutable directed graph stored as compressed sparse rows. Nodes are
+//! numbered densely from 0 to size() - 1 in the order they were inserted in
+//! the DiGraphBuilder: algorithms only handle these 32-bit indices and access
+//! per node data with plain arrays. The sparse identifiers given by Firefox
+//! are only kept in a side table, to translate them at the boundaries (graph
+//! creation, layout cache, bookmark lookup).
+//!
+//! The destination nodes of all nodes are packed in a single array, in the
+//! order edges were added: degree() and neighbors() are O(1) and iterating on
+//! neighbors streams contiguous memory. Bookmarks are trees: destination nodes
+//! are the children of a node and parent() gives the reverse link.
+//!
+//! The arrays are shared by the copies of the graph, since they never change.
+//! They are either owned (filled by DiGraphBuilder) or read in place from a
+//! memory mapped file (see IslandSnapshot).
 // *****************************************************************************
 class DiGraph
 {
 public:
 
-    //! \brief A node is simplify an unique identifier (they are given by
-    //! Firefox)
+    //! \brief Unique identifier of a node given by Firefox.
     using Node = size_t;
-    //! \brief Nodes shall be unique.
-    using Nodes = std::set<Node>;
-    //! \brief Node neighbors. Here we do not care about not storing edges.
-    using Neighbors = std::vector<Node>;
-    //! \brief Egdes are unique. Key: source node. Value: destination nodes.
-    using Edges = std::map<Node, Neighbors>;
+    //! \brief Dense index of a node in [0 size()[.
+    using Index = uint32_t;
+
+    //! \brief Returned by index() for unknown nodes and by parent() for roots.
+    //! An enumerator rather than a static member so that it can be bound to
+    //! references without needing a definition in a translation unit.
+    enum : Index { npos = std::numeric_limits<Index>::max() };
+
+    // *************************************************************************
+    //! \brief Read-only view on the indices of the destination nodes of a
+    //! node. Valid as long as the graph is not reassigned.
+    // *************************************************************************
+    class Neighbors
+    {
+    public:
+
+        Neighbors(Index const* first, Index const* last)
+            : m_first(first), m_last(last)
+        {}
+
+        inline Index const* begin() const { return m_first; }
+        inline Index const* end() const { return m_last; }
+        inline size_t size() const { return size_t(m_last - m_first); }
+        inline bool empty() const { return m_first == m_last; }
+        inline Index operator[](size_t const i) const { return m_first[i]; }
+
+    private:
+
+        Index const* m_first;
+        Index const* m_last;
+    };
+
+    //----------------------------------------------------------------------
+    //! \brief Empty graph. Use DiGraphBuilder to fill it.
+    //----------------------------------------------------------------------
+    DiGraph()
+    {
+        own(std::make_shared<Arrays>());
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Return the number of nodes.
+    //----------------------------------------------------------------------
+    inline size_t size() const
+    {
+        return m_size;
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Return the number of edges.
+    //----------------------------------------------------------------------
+    inline size_t edges() const
+    {
+        return m_offsets[m_size];
+    }
 
     //----------------------------------------------------------------------
-    //! \brief Make the graph dummy.
+    //! \brief Return the Firefox identifier of the node of the given index.
     //----------------------------------------------------------------------
-    inline void reset()
+    inline Node id(Index const index) const
     {
-        m_edges.clear();
-        m_nodes.clear();
+        return m_ids[index];
     }
 
+    //----------------------------------------------------------------------
+    //! \brief Return the index of the node of the given Firefox identifier
+    //! or npos if the graph does not hold it.
+    //----------------------------------------------------------------------
+    inline Index index(Node const node) const
+    {
+        if (m_indices != nullptr)
+        {
+            auto const it = m_indices->find(node);
+            return (it == m_indices->end()) ? npos : it->second;
+        }
+        return search(node);
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Const getter of the indices of neigbouring nodes (children).
+    //----------------------------------------------------------------------
+    inline Neighbors neighbors(Index const index) const
+    {
+        return Neighbors(m_destinations + m_offsets[index],
+                         m_destinations + m_offsets[index + 1u]);
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Return the number of output edges of the given node.
+    //----------------------------------------------------------------------
+    inline size_t degree(Index const index) const
+    {
+        return m_offsets[index + 1u] - m_offsets[index];
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Return the source node of the first edge added toward the given
+    //! node (its folder) or npos for roots.
+    //----------------------------------------------------------------------
+    inline Index parent(Index const index) const
+    {
+        return m_parents[index];
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Print on the console the graph.
+    //----------------------------------------------------------------------
+    friend std::ostream& operator<<(std::ostream& os, DiGraph const& g)
+    {
+        for (Index n = 0u; n < g.size(); ++n)
+        {
+            os << g.m_ids[n] << ":";
+            for (auto const& neighbor: g.neighbors(n))
+            {
+                os << " " << g.m_ids[neighbor];
+            }
+            os << std::endl;
+        }
+        return os;
+    }
+
+private:
+
+    friend class DiGraphBuilder;
+    friend class IslandSnapshot;
+
+    // *************************************************************************
+    //! \brief Arrays owned by the graph.
+    // *************************************************************************
+    struct Arrays
+    {
+        std::vector<Node> ids;
+        std::unordered_map<Node, Index> indices;
+        std::vector<uint32_t> offsets{ 0u };
+        std::vector<Index> destinations;
+        std::vector<Index> parents;
+    };
+
+    //----------------------------------------------------------------------
+    //! \brief Point to the given owned arrays.
+    //----------------------------------------------------------------------
+    void own(std::shared_ptr<Arrays> const& arrays);
+
+    //----------------------------------------------------------------------
+    //! \brief Binary search of the node in m_order (mapped graphs).
+    //----------------------------------------------------------------------
+    Index search(Node const node) const;
+
+private:
+
+    //! \brief Keep alive the arrays below (Arrays or mapped file).
+    std::shared_ptr<void const> m_storage;
+    //! \brief Number of nodes.
+    size_t m_size = 0u;
+    //! \brief Firefox identifier of each node (side table).
+    Node const* m_ids = nullptr;
+    //! \brief Index of each Firefox identifier (side table). Mapped graphs
+    //! have no hash table but the node indices sorted by identifiers.
+    std::unordered_map<Node, Index> const* m_indices = nullptr;
+    Index const* m_order = nullptr;
+    //! \brief Destination nodes of node n are m_destinations[m_offsets[n] ..
+    //! m_offsets[n + 1][.
+    uint32_t const* m_offsets = nullptr;
+    //! \brief Destination nodes of all nodes, grouped by source node.
+    Index const* m_destinations = nullptr;
+    //! \brief Parent of each node (npos for roots).
+    Index const* m_parents = nullptr;
+};
+
+// *****************************************************************************
+//! \brief Collect the nodes and the edges of a DiGraph then pack them once in
+//! its compressed sparse rows. Edges are grouped by source node with a
+//! parallel radix sort, which is stable: the neighbors of a node keep the
+//! order they were added in.
+// *****************************************************************************
+class DiGraphBuilder
+{
+public:
+
+    using Node = DiGraph::Node;
+    using Index = DiGraph::Index;
+
+    //----------------------------------------------------------------------
+    //! \brief Make the builder empty.
+    //----------------------------------------------------------------------
+    void reset();
+
+    //----------------------------------------------------------------------
+    //! \brief Reserve memory for the given number of nodes and edges.
+    //----------------------------------------------------------------------
+    void reserve(size_t const nodes, size_t const edges);
+
     //----------------------------------------------------------------------
     //! \brief Add a node in the graph. If node was already inserted it is
     //! not insrted a second times.
+    //! \return the index of the node.
     //----------------------------------------------------------------------
-    inline void add_node(Node const node)
+    inline Index add_node(Node const node)
     {
-        m_nodes.insert(node);
-        m_edges[node];
+        auto const it = m_indices.emplace(node, Index(m_ids.size()));
+        if (it.second)
+        {
+            m_ids.push_back(node);
+            m_parents.push_back(DiGraph::npos);
+        }
+        return it.first->second;
     }
 
     //----------------------------------------------------------------------
@@ -75,75 +274,218 @@ public:
     //----------------------------------------------------------------------
     void add_edge(Node const from, Node const to)
     {
-        add_node(from);
+        const Index source = add_node(from);
         // No cycles (ugly hack to fix root node with parent which is refering
         // to itself as given in the Firefox JSON file).
         if (to != from)
         {
-            add_node(to);
-            m_edges[from].push_back(to);
+            const Index destination = add_node(to);
+            m_sources.push_back(source);
+            m_destinations.push_back(destination);
+            if (m_parents[destination] == DiGraph::npos)
+            {
+                m_parents[destination] = source;
+            }
         }
     }
 
     //----------------------------------------------------------------------
-    //! \brief Const getter of the nodes.
+    //! \brief Return the number of nodes added so far.
     //----------------------------------------------------------------------
-    inline Nodes const& nodes() const
+    inline size_t size() const
     {
-        return m_nodes;
+        return m_ids.size();
     }
 
     //----------------------------------------------------------------------
-    //! \brief Const getter of the arcs.
+    //! \brief Return the Firefox identifier of the node of the given index.
     //----------------------------------------------------------------------
-    inline Edges const& edges() const
+    inline Node id(Index const index) const
     {
-        return m_edges;
+        return m_ids[index];
     }
 
     //----------------------------------------------------------------------
-    //! \brief Const getter of neigbouring nodes.
+    //! \brief Pack the nodes and edges added so far into a graph. The builder
+    //! is left empty.
+    //----------------------------------------------------------------------
+    DiGraph build();
+
+private:
+
     //----------------------------------------------------------------------
-    inline Neighbors const& neighbors(Node const node) const
+    //! \brief One pass of the radix sort: stable scatter of the edges on the
+    //! digit of their source node starting at the given bit.
+    //----------------------------------------------------------------------
+    void scatter(size_t const shift, std::vector<Index>& sources,
+                 std::vector<Index>& destinations);
+
+private:
+
+    //! \brief Number of bits of the source nodes sorted per radix pass.
+    static constexpr size_t RADIX_BITS = 11u;
+
+    //! \brief Firefox identifier of each node.
+    std::vector<Node> m_ids;
+    //! \brief Index of each Firefox identifier.
+    std::unordered_map<Node, Index> m_indices;
+    //! \brief Parent of each node (npos for roots).
+    std::vector<Index> m_parents;
+    //! \brief Edges in the order they were added.
+    std::vector<Index> m_sources;
+    std::vector<Index> m_destinations;
+    //! \brief Per thread histograms of the radix sort.
+    std::vector<uint32_t> m_histograms;
+};
+
+
+// *****************************************************************************
+//! \brief Versioned log of the changes made to the bookmark tree. DiGraph is
+//! immutable: it is rebuilt after changes, and so are the index of URLs and
+//! titles and the vertices of the layout. The log tells what kind of changes
+//! have been made since the epoch a consumer last saw: IslandedBrowser skips
+//! the rebuild of the graph after renames only and places moved subtrees
+//! again, the positions of other nodes being kept. Rebuilding the graph and
+//! its index is linear (about 140 ms for 200000 nodes), far below the cost
+//! of relaxing the layout around the changes.
+//!
+//! Changes are recorded one by one then committed together: each commit
+//! closes a batch and numbers it with a new epoch. Only the latest changes
+//! are kept (whole epochs are dropped once the capacity is exceeded): a
+//! consumer lagging behind is told to rebuild everything (see complete()).
+// *****************************************************************************
+class DiGraphLog
+{
+public:
+
+    using Node = DiGraph::Node;
+
+    // *************************************************************************
+    //! \brief Kind of change.
+    // *************************************************************************
+    enum class Kind : uint8_t
     {
-        auto const& it = m_edges.find(node);
-        if (it == m_edges.end())
-        {
-            static Neighbors const dummy;
-            return dummy;
-        }
-        return it->second;
+        //! \brief New node added under the parent node.
+        Add,
+        //! \brief Node removed (its subtree is removed too, each node being
+        //! recorded).
+        Remove,
+        //! \brief Node moved with its subtree under the parent node.
+        Move,
+        //! \brief Title or URL of the node changed (no structural change).
+        Rename
+    };
+
+    // *************************************************************************
+    //! \brief Change of a single node.
+    // *************************************************************************
+    struct Change
+    {
+        //! \brief Epoch of the commit holding the change.
+        uint64_t epoch;
+        //! \brief Firefox identifier of the changed node.
+        Node node;
+        //! \brief Firefox identifier of the new parent (Add and Move only).
+        Node parent;
+        //! \brief What changed.
+        Kind kind;
+    };
+
+    // *************************************************************************
+    //! \brief Read-only view on consecutive changes. Valid until the next
+    //! commit().
+    // *************************************************************************
+    class Changes
+    {
+    public:
+
+        Changes(Change const* first, Change const* last)
+            : m_first(first), m_last(last)
+        {}
+
+        inline Change const* begin() const { return m_first; }
+        inline Change const* end() const { return m_last; }
+        inline size_t size() const { return size_t(m_last - m_first); }
+        inline bool empty() const { return m_first == m_last; }
+
+    private:
+
+        Change const* m_first;
+        Change const* m_last;
+    };
+
+    //----------------------------------------------------------------------
+    //! \brief Empty log at epoch 0.
+    //! \param[in] capacity number of changes above which the oldest epochs
+    //! are dropped.
+    //----------------------------------------------------------------------
+    DiGraphLog(size_t const capacity = 65536u)
+        : m_capacity(capacity)
+    {}
+
+    //----------------------------------------------------------------------
+    //! \brief Record changes in the pending batch.
+    //----------------------------------------------------------------------
+    inline void add(Node const node, Node const parent)
+    {
+        m_changes.push_back({ m_epoch + 1u, node, parent, Kind::Add });
+    }
+
+    inline void remove(Node const node)
+    {
+        m_changes.push_back({ m_epoch + 1u, node, node, Kind::Remove });
+    }
+
+    inline void move(Node const node, Node const parent)
+    {
+        m_changes.push_back({ m_epoch + 1u, node, parent, Kind::Move });
+    }
+
+    inline void rename(Node const node)
+    {
+        m_changes.push_back({ m_epoch + 1u, node, node, Kind::Rename });
     }
 
     //----------------------------------------------------------------------
-    //! \brief Return the number of output edges of the given node.
+    //! \brief Close the pending batch of changes. Does nothing if no change
+    //! is pending.
+    //! \return the current epoch.
     //----------------------------------------------------------------------
-    inline size_t degree(Node const node) const
+    uint64_t commit();
+
+    //----------------------------------------------------------------------
+    //! \brief Return the epoch of the last commit (0 before any change).
+    //----------------------------------------------------------------------
+    inline uint64_t epoch() const
     {
-        return neighbors(node).size();
+        return m_epoch;
     }
 
     //----------------------------------------------------------------------
-    //! \brief Print on the console the graph.
+    //! \brief Return true if the log still holds all the changes committed
+    //! after the given epoch. Else the consumer shall rebuild from scratch.
     //----------------------------------------------------------------------
-    friend std::ostream& operator<<(std::ostream& os, DiGraph const& g)
+    inline bool complete(uint64_t const since) const
     {
-        for (auto const& node: g.m_nodes)
-        {
-            os << node << ":";
-            for (auto const& neighbor: g.neighbors(node))
-            {
-                os << " " << neighbor;
-            }
-            os << std::endl;
-        }
-        return os;
+        return since >= m_dropped;
     }
 
+    //----------------------------------------------------------------------
+    //! \brief Return the changes committed after the given epoch, oldest
+    //! first (pending changes are not returned).
+    //----------------------------------------------------------------------
+    Changes changes(uint64_t const since) const;
+
 private:
 
-    Nodes m_nodes;
-    Edges m_edges;
+    //! \brief Changes of the last epochs then the pending changes.
+    std::vector<Change> m_changes;
+    //! \brief Epoch of the last commit.
+    uint64_t m_epoch = 0u;
+    //! \brief Last epoch whose changes have been dropped.
+    uint64_t m_dropped = 0u;
+    //! \brief Number of changes kept.
+    size_t m_capacity;
 };
 
 #endif
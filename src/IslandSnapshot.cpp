@@ -0,0 +1,356 @@
+/* *****************************************************************************
+** MIT License
+**
+** Copyright (c) 2022 Quentin Quadrat
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+********************************************************************************
+*/
+
+#include "IslandSnapshot.hpp"
+#include "MappedFile.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#include <sys/stat.h>
+
+//! \brief "IBIS": Islanded Browser Island Snapshot.
+static constexpr uint32_t MAGIC = 0x53494249u;
+//! \brief To be incremented when the format changes.
+static constexpr uint32_t VERSION = 3u;
+
+// *****************************************************************************
+//! \brief Sections of the snapshot file, in the order they are stored.
+// *****************************************************************************
+enum Section
+{
+    Ids, Order, Parents, Kinds, Offsets, Destinations, First, Last,
+    UrlOffsets, Urls, TitleOffsets, Titles, SECTIONS
+};
+
+// *****************************************************************************
+//! \brief Header of the snapshot file.
+// *****************************************************************************
+struct Header
+{
+    uint32_t magic;
+    uint32_t version;
+    //! \brief Size of the whole file, checksum included.
+    uint64_t bytes;
+    //! \brief Stamp of the bookmarks file.
+    uint64_t stamp;
+    uint64_t nodes;
+    uint64_t edges;
+    //! \brief Number of bookmarks with an URL (see SubtreeIndex).
+    uint64_t ranks;
+    uint64_t url_bytes;
+    uint64_t title_bytes;
+    //! \brief Offset in bytes of each section from the beginning of the file.
+    uint64_t sections[SECTIONS];
+};
+
+static_assert(sizeof(DiGraph::Node) == sizeof(uint64_t), "Identifiers are stored on 64 bits");
+static_assert(sizeof(SubtreeIndex::Kind) == sizeof(uint8_t), "Kinds are stored on 8 bits");
+static_assert(sizeof(Header) % 8u == 0u, "Sections are aligned on 8 bytes");
+
+//------------------------------------------------------------------------------
+//! \brief Round up to a multiple of 8 bytes.
+static inline uint64_t align(uint64_t const offset)
+{
+    return (offset + 7u) & ~uint64_t(7u);
+}
+
+//------------------------------------------------------------------------------
+//! \brief Fill the offsets of the sections from the counts of the header.
+//! \return the size of the file, checksum included.
+static uint64_t sections(Header& header)
+{
+    const uint64_t sizes[SECTIONS] =
+    {
+        header.nodes * sizeof(uint64_t),        // Ids
+        header.nodes * sizeof(uint32_t),        // Order
+        header.nodes * sizeof(uint32_t),        // Parents
+        header.nodes * sizeof(uint8_t),         // Kinds
+        (header.nodes + 1u) * sizeof(uint32_t), // Offsets
+        header.edges * sizeof(uint32_t),        // Destinations
+        header.nodes * sizeof(uint32_t),        // First
+        header.nodes * sizeof(uint32_t),        // Last
+        (header.ranks + 1u) * sizeof(uint32_t), // UrlOffsets
+        header.url_bytes,                       // Urls
+        (header.nodes + 1u) * sizeof(uint32_t), // TitleOffsets
+        header.title_bytes,                     // Titles
+    };
+
+    uint64_t offset = sizeof(Header);
+    for (size_t s = 0u; s < SECTIONS; ++s)
+    {
+        header.sections[s] = offset;
+        offset = align(offset + sizes[s]);
+    }
+    return offset + sizeof(uint64_t);
+}
+
+//------------------------------------------------------------------------------
+//! \brief 64-bit FNV-1a hash of the given bytes taken 8 by 8 (the size shall
+//! be a multiple of 8). Any change of a single word changes the hash.
+static uint64_t checksum(const char* data, size_t const size)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0u; i < size; i += sizeof(uint64_t))
+    {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(uint64_t));
+        hash = (hash ^ word) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+//------------------------------------------------------------------------------
+//! \brief Typed pointer on a section of the file.
+template<class T>
+static inline T const* section(const char* data, Header const& header, Section const s)
+{
+    return reinterpret_cast<T const*>(data + header.sections[s]);
+}
+
+//------------------------------------------------------------------------------
+//! \brief Check that the values of the sections are in range, so that the
+//! views handed out never read outside the file: one pass over each section.
+//! The checksum only catches accidental damages of the file.
+static bool consistent(const char* data, Header const& header)
+{
+    const uint64_t nodes = header.nodes;
+    uint64_t const* ids = section<uint64_t>(data, header, Ids);
+    uint32_t const* order = section<uint32_t>(data, header, Order);
+    uint32_t const* parents = section<uint32_t>(data, header, Parents);
+    uint8_t const* kinds = section<uint8_t>(data, header, Kinds);
+    uint32_t const* offsets = section<uint32_t>(data, header, Offsets);
+    uint32_t const* destinations = section<uint32_t>(data, header, Destinations);
+    uint32_t const* first = section<uint32_t>(data, header, First);
+    uint32_t const* last = section<uint32_t>(data, header, Last);
+    uint32_t const* url_offsets = section<uint32_t>(data, header, UrlOffsets);
+    uint32_t const* title_offsets = section<uint32_t>(data, header, TitleOffsets);
+
+    // Offsets start at 0, never decrease and end at the size of their table
+    auto sorted = [](uint32_t const* values, uint64_t const count, uint64_t const end)
+    {
+        if ((values[0] != 0u) || (values[count] != end))
+            return false;
+        for (uint64_t i = 0u; i < count; ++i)
+        {
+            if (values[i] > values[i + 1u])
+                return false;
+        }
+        return true;
+    };
+    if (!sorted(offsets, nodes, header.edges) ||
+        !sorted(url_offsets, header.ranks, header.url_bytes) ||
+        !sorted(title_offsets, nodes, header.title_bytes))
+        return false;
+
+    for (uint64_t e = 0u; e < header.edges; ++e)
+    {
+        if (destinations[e] >= nodes)
+            return false;
+    }
+
+    for (uint64_t n = 0u; n < nodes; ++n)
+    {
+        if (((parents[n] >= nodes) && (parents[n] != DiGraph::npos)) ||
+            (first[n] > last[n]) || (last[n] > header.ranks) ||
+            (kinds[n] > uint8_t(SubtreeIndex::Kind::Bookmark)))
+            return false;
+    }
+
+    // Indices sorted by strictly increasing identifiers: being in range and
+    // distinct, they are a permutation of the nodes.
+    for (uint64_t n = 0u; n < nodes; ++n)
+    {
+        if ((order[n] >= nodes) || ((n != 0u) && (ids[order[n - 1u]] >= ids[order[n]])))
+            return false;
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+uint64_t IslandSnapshot::stamp(std::string const& path)
+{
+    struct stat status;
+    if (stat(path.c_str(), &status) != 0)
+        return 0u;
+
+    const uint64_t values[3] = { uint64_t(status.st_size), uint64_t(status.st_mtim.tv_sec),
+                                 uint64_t(status.st_mtim.tv_nsec) };
+    return checksum(reinterpret_cast<const char*>(values), sizeof(values));
+}
+
+//------------------------------------------------------------------------------
+bool IslandSnapshot::open(std::string const& path, uint64_t const stamp)
+{
+    m_digraph = DiGraph();
+    m_subtrees = SubtreeIndex();
+
+    auto file = std::make_shared<MappedFile>(path, MADV_WILLNEED);
+    const char* data = file->data();
+    const size_t size = file->size();
+    if (data == nullptr)
+    {
+        m_error = "Cannot read the snapshot file " + path;
+        return false;
+    }
+
+    // Check the size before reading anything. Each element of a section takes
+    // at least one byte: larger counts are corrupted and could overflow the
+    // computation of the offsets.
+    Header header;
+    if (size < sizeof(Header) + sizeof(uint64_t))
+    {
+        m_error = path + ": truncated snapshot";
+        return false;
+    }
+    memcpy(&header, data, sizeof(Header));
+    if ((header.magic != MAGIC) || (header.version != VERSION))
+    {
+        m_error = path + ": not a snapshot or unsupported version";
+        return false;
+    }
+    if (header.stamp != stamp)
+    {
+        m_error = path + ": snapshot of other bookmarks";
+        return false;
+    }
+    Header expected = header;
+    if ((header.bytes != size) || (header.nodes >= size) || (header.edges >= size) ||
+        (header.ranks >= size) || (header.url_bytes >= size) ||
+        (header.title_bytes >= size) || (header.nodes >= DiGraph::npos) ||
+        (sections(expected) != size) ||
+        !std::equal(header.sections, header.sections + SECTIONS, expected.sections))
+    {
+        m_error = path + ": truncated or corrupted snapshot";
+        return false;
+    }
+
+    uint64_t saved;
+    const size_t payload = size - sizeof(uint64_t);
+    memcpy(&saved, data + payload, sizeof(uint64_t));
+    if (saved != checksum(data, payload))
+    {
+        m_error = path + ": bad checksum";
+        return false;
+    }
+
+    if (!consistent(data, header))
+    {
+        m_error = path + ": inconsistent snapshot";
+        return false;
+    }
+
+    // Views on the mapped sections, sharing the mapping
+    const size_t nodes = size_t(header.nodes);
+    m_digraph.m_size = nodes;
+    m_digraph.m_ids = section<DiGraph::Node>(data, header, Ids);
+    m_digraph.m_indices = nullptr;
+    m_digraph.m_order = section<DiGraph::Index>(data, header, Order);
+    m_digraph.m_offsets = section<uint32_t>(data, header, Offsets);
+    m_digraph.m_destinations = section<DiGraph::Index>(data, header, Destinations);
+    m_digraph.m_parents = section<DiGraph::Index>(data, header, Parents);
+    m_digraph.m_storage = file;
+
+    m_subtrees.m_size = nodes;
+    m_subtrees.m_ranks = size_t(header.ranks);
+    m_subtrees.m_first = section<uint32_t>(data, header, First);
+    m_subtrees.m_last = section<uint32_t>(data, header, Last);
+    m_subtrees.m_urls = section<char>(data, header, Urls);
+    m_subtrees.m_url_offsets = section<uint32_t>(data, header, UrlOffsets);
+    m_subtrees.m_titles = section<char>(data, header, Titles);
+    m_subtrees.m_title_offsets = section<uint32_t>(data, header, TitleOffsets);
+    m_subtrees.m_kinds = section<SubtreeIndex::Kind>(data, header, Kinds);
+    m_subtrees.m_storage = file;
+
+    m_error.clear();
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool IslandSnapshot::save(std::string const& path, uint64_t const stamp,
+                          DiGraph const& digraph, SubtreeIndex const& subtrees)
+{
+    const size_t nodes = digraph.size();
+    if (subtrees.m_size != nodes)
+        return false;
+
+    Header header;
+    memset(&header, 0, sizeof(Header));
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.stamp = stamp;
+    header.nodes = nodes;
+    header.edges = digraph.edges();
+    header.ranks = subtrees.m_ranks;
+    header.url_bytes = subtrees.m_url_offsets[subtrees.m_ranks];
+    header.title_bytes = subtrees.m_title_offsets[nodes];
+    header.bytes = sections(header);
+
+    // Zeroed so that the padding between sections is deterministic
+    std::vector<char> bytes(size_t(header.bytes), 0);
+    char* data = bytes.data();
+    memcpy(data, &header, sizeof(Header));
+    auto copy = [&](Section const s, void const* source, size_t const size)
+    {
+        if (size != 0u)
+            memcpy(data + header.sections[s], source, size);
+    };
+
+    // Node indices sorted by identifiers, for lookups without hash table
+    std::vector<DiGraph::Index> order(nodes);
+    std::iota(order.begin(), order.end(), DiGraph::Index(0));
+    std::sort(order.begin(), order.end(),
+              [&digraph](DiGraph::Index const a, DiGraph::Index const b)
+              {
+                  return digraph.id(a) < digraph.id(b);
+              });
+
+    copy(Ids, digraph.m_ids, nodes * sizeof(DiGraph::Node));
+    copy(Order, order.data(), nodes * sizeof(DiGraph::Index));
+    copy(Parents, digraph.m_parents, nodes * sizeof(DiGraph::Index));
+    copy(Kinds, subtrees.m_kinds, nodes * sizeof(SubtreeIndex::Kind));
+    copy(Offsets, digraph.m_offsets, (nodes + 1u) * sizeof(uint32_t));
+    copy(Destinations, digraph.m_destinations, digraph.edges() * sizeof(DiGraph::Index));
+    copy(First, subtrees.m_first, nodes * sizeof(uint32_t));
+    copy(Last, subtrees.m_last, nodes * sizeof(uint32_t));
+    copy(UrlOffsets, subtrees.m_url_offsets, (subtrees.m_ranks + 1u) * sizeof(uint32_t));
+    copy(Urls, subtrees.m_urls, size_t(header.url_bytes));
+    copy(TitleOffsets, subtrees.m_title_offsets, (nodes + 1u) * sizeof(uint32_t));
+    copy(Titles, subtrees.m_titles, size_t(header.title_bytes));
+
+    const size_t payload = bytes.size() - sizeof(uint64_t);
+    const uint64_t sum = checksum(data, payload);
+    memcpy(data + payload, &sum, sizeof(uint64_t));
+
+    const std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file.write(bytes.data(), std::streamsize(bytes.size())))
+            return false;
+    }
+    return std::rename(temporary.c_str(), path.c_str()) == 0;
+}
@@ -0,0 +1,121 @@
+/* *****************************************************************************
+** MIT License
+**
+** Copyright (c) 2022 Quentin Quadrat
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+********************************************************************************
+*/
+
+#ifndef ISLANDSNAPSHOT_HPP
+#  define ISLANDSNAPSHOT_HPP
+
+#  include "Graph.hpp"
+#  include "SubtreeIndex.hpp"
+#  include <string>
+
+// *****************************************************************************
+//! \brief Bookmark graph saved on disk in the very layout it has in memory,
+//! so that the next launch maps the file read-only and runs on it directly:
+//! no parsing, no map of bookmarks, no string built. DiGraph and SubtreeIndex
+//! returned by open() are views on the mapped pages, kept mapped as long as
+//! one of their copies lives.
+//!
+//! The snapshot is keyed by a stamp of the bookmarks file it was made from
+//! (see stamp()): it is ignored once the bookmarks have been exported again.
+//!
+//! Binary format (native endianness, version 3): a header (magic, version,
+//! file size, stamp, number of nodes, edges, ranked bookmarks and bytes of
+//! strings, offsets of the sections), then the sections,
+//! each one aligned on 8 bytes:
+//! - node table: Firefox identifiers, node indices sorted by identifiers,
+//!   parents, kinds (folder or bookmark).
+//! - CSR edges: offsets and destination nodes.
+//! - string tables: ranks of the bookmarks below each node, offsets and
+//!   bytes of the quoted URLs, offsets and bytes of the titles.
+//! The file ends with a checksum of all previous bytes. Truncated, corrupted,
+//! foreign or stale files are ignored, as well as files whose indices or
+//! offsets are out of range. The layout is not part of the snapshot: it is
+//! saved by LayoutCache.
+// *****************************************************************************
+class IslandSnapshot
+{
+public:
+
+    //----------------------------------------------------------------------
+    //! \brief Map the snapshot file and check it: header, checksum then
+    //! one pass over the sections checking that node indices, offsets and
+    //! ranks are in range and that the order section is a permutation
+    //! sorted by identifiers.
+    //! \param[in] path path of the snapshot file.
+    //! \param[in] stamp stamp of the bookmarks file (see stamp()).
+    //! \return false if the file is missing, invalid or made from other
+    //! bookmarks. error() tells why.
+    //----------------------------------------------------------------------
+    bool open(std::string const& path, uint64_t const stamp);
+
+    //----------------------------------------------------------------------
+    //! \brief Write the snapshot of the given graph and its index. The
+    //! file is first written aside then renamed: snapshots already mapped
+    //! keep their content.
+    //! \return false if the file could not be written.
+    //----------------------------------------------------------------------
+    static bool save(std::string const& path, uint64_t const stamp,
+                     DiGraph const& digraph, SubtreeIndex const& subtrees);
+
+    //----------------------------------------------------------------------
+    //! \brief Stamp of the given file (size and modification time), 0 if it
+    //! does not exist.
+    //----------------------------------------------------------------------
+    static uint64_t stamp(std::string const& path);
+
+    //----------------------------------------------------------------------
+    //! \brief Return the mapped graph (empty before open()).
+    //----------------------------------------------------------------------
+    inline DiGraph const& graph() const
+    {
+        return m_digraph;
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Return the mapped URLs and titles (empty before open()).
+    //----------------------------------------------------------------------
+    inline SubtreeIndex const& subtrees() const
+    {
+        return m_subtrees;
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Return the reason of the last failure of open().
+    //----------------------------------------------------------------------
+    inline std::string const& error() const
+    {
+        return m_error;
+    }
+
+private:
+
+    //! \brief Views on the mapped file.
+    DiGraph m_digraph;
+    SubtreeIndex m_subtrees;
+    //! \brief Reason of the last failure.
+    std::string m_error;
+};
+
+#endif
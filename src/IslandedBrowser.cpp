@@ -24,137 +24,490 @@
 */
 
 #include "IslandedBrowser.hpp"
+#include "BookmarkLoader.hpp"
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 
 // -----------------------------------------------------------------------------
-IslandedBrowser::IslandedBrowser(sf::Vector2f const dimension)
-   : m_force_directed(dimension, m_digraph)
+IslandedBrowser::IslandedBrowser(sf::Vector2f const dimension, std::string const& cache,
+                                 std::string const& bookmarks, std::string const& snapshot)
+   : m_force_directed(dimension, m_digraph), m_dimension(dimension), m_cache(cache),
+     m_snapshot_file(snapshot), m_stamp(IslandSnapshot::stamp(bookmarks))
 {
-    init(m_bookmarks, m_folders);
-    createGraph();
-    m_force_directed.reset();
+    // Run on the snapshot of the same bookmarks saved by a previous launch.
+    // Else parse the bookmarks and save their snapshot for the next launch.
+    IslandSnapshot island;
+    m_mapped = !m_snapshot_file.empty() && island.open(m_snapshot_file, m_stamp);
+    if (m_mapped)
+    {
+        m_digraph = island.graph();
+        m_subtrees = island.subtrees();
+    }
+    else
+    {
+        if (!bookmarks.empty())
+        {
+            BookmarkLoader loader;
+            if (!loader.load(bookmarks, m_bookmarks, m_folders))
+            {
+                std::cerr << loader.error() << std::endl;
+            }
+        }
+#ifdef EMBEDDED_BOOKMARKS
+        if (m_folders.empty())
+        {
+            init(m_bookmarks, m_folders);
+        }
+#endif
+        createGraph();
+        if (!m_snapshot_file.empty())
+        {
+            IslandSnapshot::save(m_snapshot_file, m_stamp, m_digraph, m_subtrees);
+        }
+    }
+
+    // The layout is saved aside by the layout cache, mapped graph or not
+    m_laid_out = load();
+    if (!m_laid_out)
+    {
+        m_force_directed.reset();
+    }
+    topology();
+    publish();
 }
 
 // -----------------------------------------------------------------------------
-void IslandedBrowser::createGraph()
+bool IslandedBrowser::load()
 {
-    m_digraph.reset();
-    for (auto const& it: m_folders)
+    ForceDirectedGraph::Placements placements;
+    switch (m_cache.load(m_digraph, m_dimension, placements))
     {
-        m_digraph.add_edge(it.second.parent, it.second.id);
+    case LayoutCache::Match::Exact:
+        m_force_directed.restore(placements);
+        m_cached = true;
+        m_separated = true;
+        return true;
+    case LayoutCache::Match::Near:
+        // Most nodes kept their saved position: let the worker thread
+        // settle the layout around the changes
+        m_force_directed.incremental(placements, 0u);
+        return true;
+    case LayoutCache::Match::None:
+    default:
+        return false;
     }
+}
 
-    for (auto const& it: m_bookmarks)
+// -----------------------------------------------------------------------------
+IslandedBrowser::~IslandedBrowser()
+{
+    stop();
+}
+
+// -----------------------------------------------------------------------------
+void IslandedBrowser::start()
+{
+    if (m_thread.joinable())
+        return ;
+
+    m_halt = false;
+    m_thread = std::thread(&IslandedBrowser::simulate, this);
+}
+
+// -----------------------------------------------------------------------------
+void IslandedBrowser::stop()
+{
+    m_halt = true;
+    if (m_thread.joinable())
     {
-        m_digraph.add_edge(it.second.parent, it.second.id);
+        m_thread.join();
     }
 }
 
-// TODO: to be cleaned !!!!
+// -----------------------------------------------------------------------------
+void IslandedBrowser::simulate()
+{
+    if (!m_laid_out)
+    {
+        m_force_directed.multilevel();
+        topology();
+        publish();
+        m_laid_out = true;
+    }
+
+    while (!m_halt)
+    {
+        if (m_force_directed.converged())
+        {
+            // Forces leave crowded vertices overlapping: remove overlaps
+            // once, before showing and saving the final layout.
+            if (!m_separated)
+            {
+                m_force_directed.separate();
+                publish();
+                m_separated = true;
+            }
+            if (!m_cached)
+            {
+                m_cached = m_cache.save(m_digraph, m_dimension,
+                                        m_force_directed.placements());
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            continue ;
+        }
+
+        m_cached = false;
+        m_separated = false;
+        m_force_directed.update();
+        publish();
+    }
+}
 
 // -----------------------------------------------------------------------------
-std::string const& IslandedBrowser::getURL(sf::Vector2i mouse)
+void IslandedBrowser::add(std::vector<Bookmark> const& bookmarks,
+                          std::vector<Folder> const& folders)
 {
-    m_cache_urls.clear();
+    const bool running = m_thread.joinable();
+    stop();
+    materialize();
 
-    for (auto const& v: m_force_directed.vertices())
+    for (auto const& folder: folders)
     {
-        // Squared distance
-        const float distance =
-                   (float(mouse.x) - v.position.x) *
-                   (float(mouse.x) - v.position.x) +
-                   (float(mouse.y) - v.position.y) *
-                   (float(mouse.y) - v.position.y);
+        auto const it = m_folders.find(int(folder.id));
+        if (it == m_folders.end())
+            m_log.add(folder.id, folder.parent);
+        else if (it->second.parent != folder.parent)
+            m_log.move(folder.id, folder.parent);
+        else if (it->second.title != folder.title)
+            m_log.rename(folder.id);
+        m_folders[int(folder.id)] = folder;
+    }
+    for (auto const& bookmark: bookmarks)
+    {
+        auto const it = m_bookmarks.find(int(bookmark.id));
+        if (it == m_bookmarks.end())
+            m_log.add(bookmark.id, bookmark.parent);
+        else if (it->second.parent != bookmark.parent)
+            m_log.move(bookmark.id, bookmark.parent);
+        else if ((it->second.title != bookmark.title) || (it->second.uri != bookmark.uri))
+            m_log.rename(bookmark.id);
+        m_bookmarks[int(bookmark.id)] = bookmark;
+    }
+    update();
 
-        if (distance < 16.0f)
+    if (running)
+    {
+        start();
+    }
+}
+
+// -----------------------------------------------------------------------------
+void IslandedBrowser::remove(std::vector<size_t> const& ids)
+{
+    const bool running = m_thread.joinable();
+    stop();
+    materialize();
+
+    // Removing a folder removes its content
+    std::vector<DiGraph::Node> nodes(ids.begin(), ids.end());
+    for (size_t i = 0u; i < nodes.size(); ++i)
+    {
+        const DiGraph::Index index = m_digraph.index(nodes[i]);
+        if (index != DiGraph::npos)
+        {
+            for (auto const& node: m_digraph.neighbors(index))
+            {
+                nodes.push_back(m_digraph.id(node));
+            }
+        }
+        if (m_folders.erase(int(nodes[i])) + m_bookmarks.erase(int(nodes[i])) != 0u)
         {
-            getURL_chapo(v.id);
-            return m_cache_urls;
+            m_log.remove(nodes[i]);
         }
     }
+    update();
 
-    return m_cache_urls;
+    if (running)
+    {
+        start();
+    }
 }
 
 // -----------------------------------------------------------------------------
-//! \note Only working with graph which are trees and directed else you have
-//! manage infinite recursion by marking visited nodes.
-void IslandedBrowser::getURL_chapo(DiGraph::Node const& node)
+bool IslandedBrowser::move(size_t const id, size_t const parent)
 {
-    if (m_digraph.degree(node) == 0u)
+    materialize();
+    auto const bookmark = m_bookmarks.find(int(id));
+    auto const folder = m_folders.find(int(id));
+    if (((bookmark == m_bookmarks.end()) && (folder == m_folders.end())) ||
+        (m_folders.find(int(parent)) == m_folders.end()))
+        return false;
+
+    // The destination folder shall not be inside the moved one. The root
+    // folder is its own parent.
+    for (size_t p = parent, hops = 0u; hops <= m_folders.size(); ++hops)
     {
-        m_cache_urls += " \"";
-        m_cache_urls += m_bookmarks[node].uri;
-        m_cache_urls += "\"";
+        if (p == id)
+            return false;
+
+        auto const it = m_folders.find(int(p));
+        if ((it == m_folders.end()) || (it->second.parent == p))
+            break ;
+        p = it->second.parent;
     }
-    else
+
+    size_t& current = (bookmark != m_bookmarks.end())
+                      ? bookmark->second.parent : folder->second.parent;
+    if (current == parent)
+        return true;
+
+    const bool running = m_thread.joinable();
+    stop();
+
+    current = parent;
+    m_log.move(id, parent);
+    update();
+
+    if (running)
+    {
+        start();
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+bool IslandedBrowser::rename(size_t const id, std::string const& title)
+{
+    materialize();
+    auto const bookmark = m_bookmarks.find(int(id));
+    auto const folder = m_folders.find(int(id));
+    if ((bookmark == m_bookmarks.end()) && (folder == m_folders.end()))
+        return false;
+
+    const bool running = m_thread.joinable();
+    stop();
+
+    ((bookmark != m_bookmarks.end()) ? bookmark->second.title : folder->second.title) = title;
+    m_log.rename(id);
+    update();
+
+    if (running)
+    {
+        start();
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+void IslandedBrowser::update()
+{
+    // Changes since the graph was built. If some of them have been dropped
+    // from the log, consider the graph has changed.
+    m_log.commit();
+    bool structural = !m_log.complete(m_epoch);
+    std::vector<DiGraph::Node> moved;
+    for (auto const& change: m_log.changes(m_epoch))
+    {
+        structural = structural || (change.kind != DiGraphLog::Kind::Rename);
+        if (change.kind == DiGraphLog::Kind::Move)
+        {
+            moved.push_back(change.node);
+        }
+    }
+    m_epoch = m_log.epoch();
+
+    // Renaming only changes the titles: keep the graph, the layout and the
+    // snapshots.
+    if (!structural)
+    {
+        m_subtrees.build(m_digraph, m_bookmarks, m_folders);
+        return ;
+    }
+
+    // Positions are read before the graph is rebuilt: vertices of the layout
+    // still follow the nodes of the previous graph.
+    ForceDirectedGraph::Placements placements = m_force_directed.placements();
+    createGraph();
+
+    // Moved nodes and their content forget their position, so that they are
+    // placed again next to their new folder.
+    if (!moved.empty())
     {
-        for (const auto& it: m_digraph.neighbors(node))
+        std::vector<uint8_t> visited(m_digraph.size(), 0u);
+        for (size_t i = 0u; i < moved.size(); ++i)
         {
-             getURL_chapo(it);
+            const DiGraph::Index index = m_digraph.index(moved[i]);
+            if ((index == DiGraph::npos) || (visited[index] != 0u))
+                continue ;
+
+            visited[index] = 1u;
+            for (auto const& child: m_digraph.neighbors(index))
+            {
+                moved.push_back(m_digraph.id(child));
+            }
         }
+        std::sort(moved.begin(), moved.end());
+        placements.erase(std::remove_if(placements.begin(), placements.end(),
+                                        [&moved](ForceDirectedGraph::Placement const& p)
+                                        {
+                                            return std::binary_search(moved.begin(), moved.end(), p.id);
+                                        }),
+                         placements.end());
     }
+
+    m_force_directed.incremental(placements);
+    m_cached = false;
+    m_separated = false;
+    topology();
+    publish();
 }
 
 // -----------------------------------------------------------------------------
-std::string const& IslandedBrowser::getTitle(sf::Vector2i mouse)
+void IslandedBrowser::topology()
 {
-    m_cache_urls.clear();
+    ForceDirectedGraph::Vertices const& vertices = m_force_directed.vertices();
+    auto topology = std::make_shared<Snapshot::Topology>();
 
-    for (auto const& v: m_force_directed.vertices())
+    topology->colors.resize(vertices.size());
+    topology->offsets.resize(vertices.size() + 1u);
+    topology->offsets[0] = 0u;
+    for (size_t i = 0u; i < vertices.size(); ++i)
     {
-        // Squared distance
-        const float distance =
-                   (float(mouse.x) - v.position.x) *
-                   (float(mouse.x) - v.position.x) +
-                   (float(mouse.y) - v.position.y) *
-                   (float(mouse.y) - v.position.y);
-
-        if (distance < 16.0f)
+        topology->colors[i] = vertices[i].color;
+        for (auto const& n: m_force_directed.neighbors(i))
         {
-            getTitle_chapo(v.id);
-            return m_cache_urls;
+            topology->adjacency.push_back(n);
         }
+        topology->offsets[i + 1u] = uint32_t(topology->adjacency.size());
     }
 
-    return m_cache_urls;
+    m_topology = topology;
 }
 
 // -----------------------------------------------------------------------------
-void IslandedBrowser::getTitle_chapo(DiGraph::Node const& node)
+void IslandedBrowser::publish()
 {
-    if (m_digraph.degree(node) == 0u)
+    ForceDirectedGraph::Vertices const& vertices = m_force_directed.vertices();
+    Snapshot& snapshot = m_snapshots.back();
+
+    snapshot.topology = m_topology;
+    snapshot.positions.resize(vertices.size());
+    for (size_t i = 0u; i < vertices.size(); ++i)
     {
-        m_cache_urls += m_bookmarks[node].title;
+        snapshot.positions[i] = vertices[i].position;
     }
-    else
+
+    m_snapshots.publish();
+}
+
+// -----------------------------------------------------------------------------
+IslandedBrowser::Snapshot const& IslandedBrowser::snapshot()
+{
+    m_snapshots.fetch();
+    return m_snapshots.front();
+}
+
+// -----------------------------------------------------------------------------
+void IslandedBrowser::createGraph()
+{
+    const size_t count = m_folders.size() + m_bookmarks.size();
+    DiGraphBuilder builder;
+    builder.reserve(count + 1u, count);
+    for (auto const& it: m_folders)
+    {
+        builder.add_edge(it.second.parent, it.second.id);
+    }
+
+    for (auto const& it: m_bookmarks)
     {
-        m_cache_urls += m_folders[node].title;
+        builder.add_edge(it.second.parent, it.second.id);
     }
+    m_digraph = builder.build();
+    m_subtrees.build(m_digraph, m_bookmarks, m_folders);
 }
 
-#if 0
 // -----------------------------------------------------------------------------
-std::string const& IslandedBrowser::getURL(DiGraph::Node const& node)
+void IslandedBrowser::materialize()
 {
-    if (m_digraph.degree(node) == 0u)
+    if (!m_mapped)
+        return ;
+
+    // Parents follow the edges of the graph. The root folder is its own
+    // parent. Bookmarks are leaves: their own URL is the quoted one of their
+    // subtree.
+    for (DiGraph::Index n = 0u; n < m_digraph.size(); ++n)
     {
-        m_cache_urls = m_bookmarks[node].uri;
+        const size_t id = m_digraph.id(n);
+        const DiGraph::Index p = m_digraph.parent(n);
+        const size_t parent = (p == DiGraph::npos) ? id : m_digraph.id(p);
+        SubtreeIndex::Slice const title = m_subtrees.title(n);
+        switch (m_subtrees.kind(n))
+        {
+        case SubtreeIndex::Kind::Folder:
+            m_folders[int(id)] = { std::string(title.data(), title.size()), id, parent };
+            break;
+        case SubtreeIndex::Kind::Bookmark:
+            {
+                std::string uri;
+                if (m_digraph.degree(n) == 0u)
+                    uri = SubtreeIndex::unquote(m_subtrees.urls(n));
+                m_bookmarks[int(id)] = { std::string(title.data(), title.size()), uri, id, parent };
+            }
+            break;
+        case SubtreeIndex::Kind::None:
+        default:
+            break;
+        }
     }
-    else
+    m_mapped = false;
+}
+
+// TODO: to be cleaned !!!!
+
+// -----------------------------------------------------------------------------
+bool IslandedBrowser::pick(sf::Vector2i const& mouse, DiGraph::Index& node)
+{
+    Snapshot const& shot = snapshot();
+    if (shot.topology == nullptr)
+        return false;
+
+    for (size_t i = 0u; i < shot.positions.size(); ++i)
     {
-        for (const auto& it: m_digraph.neighbors(node))
+        sf::Vector2f const& p = shot.positions[i];
+
+        // Squared distance
+        const float distance =
+                   (float(mouse.x) - p.x) * (float(mouse.x) - p.x) +
+                   (float(mouse.y) - p.y) * (float(mouse.y) - p.y);
+
+        if (distance < 16.0f)
         {
-             m_cache_urls += " ";
-             m_cache_urls += m_bookmarks[node].uri;
+            node = DiGraph::Index(i);
+            return true;
         }
     }
-    return m_cache_urls;
+
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+SubtreeIndex::Slice IslandedBrowser::getURL(sf::Vector2i mouse)
+{
+    DiGraph::Index node;
+    return pick(mouse, node) ? m_subtrees.urls(node) : SubtreeIndex::Slice();
+}
+
+// -----------------------------------------------------------------------------
+SubtreeIndex::Slice IslandedBrowser::getTitle(sf::Vector2i mouse)
+{
+    DiGraph::Index node;
+    return pick(mouse, node) ? m_subtrees.title(node) : SubtreeIndex::Slice();
 }
-#endif
 
 // -----------------------------------------------------------------------------
 void IslandedBrowser::forceDirectedGraph()
 {
     m_force_directed.update();
+    publish();
 }
@@ -28,25 +28,155 @@
 
 #  include "Bookmarks.hpp"
 #  include "ForceDirectedGraph.hpp"
+#  include "IslandSnapshot.hpp"
+#  include "LayoutCache.hpp"
+#  include "Settings.hpp"
+#  include "SubtreeIndex.hpp"
+#  include "TripleBuffer.hpp"
+#  include <SFML/Graphics/Color.hpp>
+#  include <map>
+#  include <memory>
 #  include <string>
+#  include <thread>
 
 // *****************************************************************************
 //! \brief Class owning the context of the application.
+//!
+//! The layout of the graph can be computed on a worker thread (see start())
+//! so that the GUI is never blocked by the simulation. The worker publishes
+//! immutable snapshots of the vertex positions through a lock-free triple
+//! buffer: the GUI thread reads the newest one with snapshot() without
+//! stalling the simulation.
 // *****************************************************************************
 class IslandedBrowser
 {
+    //! \brief Headless benchmark timing each stage (see Benchmark.cpp).
+    friend class Benchmark;
+
 public:
 
+    // *************************************************************************
+    //! \brief Immutable copy of the layout made for the GUI thread.
+    // *************************************************************************
+    struct Snapshot
+    {
+        // *********************************************************************
+        //! \brief Part of the snapshot which only changes when the graph is
+        //! rebuilt. Shared between snapshots.
+        // *********************************************************************
+        struct Topology
+        {
+            //! \brief Color of each vertex.
+            std::vector<sf::Color> colors;
+            //! \brief Compressed sparse row adjacency (see
+            //! ForceDirectedGraph::neighbors()).
+            std::vector<uint32_t> offsets;
+            std::vector<uint32_t> adjacency;
+
+            //! \brief Indices of the neighbors of the given vertex.
+            inline ForceDirectedGraph::Neighbors neighbors(size_t const vertex) const
+            {
+                uint32_t const* a = adjacency.data();
+                return { a + offsets[vertex], a + offsets[vertex + 1u] };
+            }
+        };
+
+        //! \brief Vertices and edges (empty until the first publication).
+        std::shared_ptr<Topology const> topology;
+        //! \brief Position of each vertex.
+        std::vector<sf::Vector2f> positions;
+    };
+
     //! \brief Collection of bookmarks
     using Bookmarks = std::map<int, Bookmark>;
     //! \brief Collection of bookmark folders
     using Folders = std::map<int, Folder>;
 
     //----------------------------------------------------------------------
-    //! \brief Default constructor. Set the dimension of the layout.
+    //! \brief Default constructor. Set the dimension of the layout. The
+    //! layout saved by a previous launch is reused if the bookmarks have not
+    //! changed (or used as starting point if they have slightly changed).
+    //! If the snapshot saved by a previous launch has been made from the same
+    //! bookmarks file, the browser runs directly on its mapped memory and the
+    //! JSON file is not parsed.
     //! \param[in] dimension dimension of the layout along X and Y axes.
+    //! \param[in] cache path of the file caching the layout.
+    //! \param[in] bookmarks path of the Firefox bookmarks exported as JSON
+    //! file (none if empty).
+    //! \param[in] snapshot path of the binary snapshot of the bookmarks
+    //! (none if empty).
+    //----------------------------------------------------------------------
+    IslandedBrowser(sf::Vector2f const dimension,
+                    std::string const& cache = LAYOUT_CACHE_PATH,
+                    std::string const& bookmarks = BOOKMARKS_PATH,
+                    std::string const& snapshot = ISLAND_SNAPSHOT_PATH);
+
+    //----------------------------------------------------------------------
+    //! \brief Stop the worker thread if running.
+    //----------------------------------------------------------------------
+    ~IslandedBrowser();
+
+    //----------------------------------------------------------------------
+    //! \brief Start the worker thread computing the layout: the multilevel
+    //! layout is computed first then the simulation continues until stop()
+    //! is called. Does nothing if already running.
+    //----------------------------------------------------------------------
+    void start();
+
+    //----------------------------------------------------------------------
+    //! \brief Stop the worker thread and wait for it.
+    //----------------------------------------------------------------------
+    void stop();
+
+    //----------------------------------------------------------------------
+    //! \brief Add bookmarks and folders (or replace the ones having the same
+    //! identifier) and update the layout incrementally: the current layout
+    //! is kept and only the neighborhood of new nodes is relaxed. The worker
+    //! thread, if running, is paused during the update.
+    //----------------------------------------------------------------------
+    void add(std::vector<Bookmark> const& bookmarks,
+             std::vector<Folder> const& folders);
+
+    //----------------------------------------------------------------------
+    //! \brief Remove bookmarks and folders (with their content) and update
+    //! the layout incrementally (see add()).
+    //! \param[in] ids identifiers of bookmarks and folders to remove.
+    //----------------------------------------------------------------------
+    void remove(std::vector<size_t> const& ids);
+
+    //----------------------------------------------------------------------
+    //! \brief Move a bookmark or a folder (with its content) into another
+    //! folder and update the layout incrementally (see add()): the moved
+    //! nodes are placed again next to their new folder.
+    //! \param[in] id identifier of the bookmark or folder to move.
+    //! \param[in] parent identifier of the destination folder.
+    //! \return false if a node is unknown or if a folder would be moved
+    //! into its own content.
     //----------------------------------------------------------------------
-    IslandedBrowser(sf::Vector2f const dimension);
+    bool move(size_t const id, size_t const parent);
+
+    //----------------------------------------------------------------------
+    //! \brief Change the title of a bookmark or a folder. The graph and the
+    //! layout are kept as they are.
+    //! \return false if the node is unknown.
+    //----------------------------------------------------------------------
+    bool rename(size_t const id, std::string const& title);
+
+    //----------------------------------------------------------------------
+    //! \brief Return the log of the changes made to bookmarks and folders
+    //! (see DiGraphLog::changes()).
+    //----------------------------------------------------------------------
+    inline DiGraphLog const& log() const
+    {
+        return m_log;
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Return the newest layout published by the simulation. To be
+    //! called from a single thread (the GUI thread): the returned reference
+    //! remains valid and unchanged until the next call.
+    //----------------------------------------------------------------------
+    Snapshot const& snapshot();
 
     //----------------------------------------------------------------------
     //! \brief Print on the console the graph structure.
@@ -68,6 +198,8 @@ public:
 
     //----------------------------------------------------------------------
     //! \brief Const getter of the graph nodes to display.
+    //! \note Not thread safe while the worker thread is running: use
+    //! snapshot() instead.
     //----------------------------------------------------------------------
     inline ForceDirectedGraph::Vertices const& vertices() const
     {
@@ -75,44 +207,96 @@ public:
     }
 
     //----------------------------------------------------------------------
-    //! \brief Do a single step on the expension of the graph.
+    //! \brief Getter of the layout algorithm to tune its parameters.
+    //----------------------------------------------------------------------
+    inline ForceDirectedGraph& layout()
+    {
+        return m_force_directed;
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Do a single step on the expension of the graph and publish the
+    //! snapshot. To be used when the worker thread is not running.
     //----------------------------------------------------------------------
     void forceDirectedGraph();
 
     //----------------------------------------------------------------------
-    //! \brief Get the URL of the node under the mouse position.
+    //! \brief Get the URL of the node under the mouse position in the newest
+    //! snapshot.
     //! \param[in] mouse mouse position along the layout dimension.
-    //! \return A dummy string if there is no node under the mouse cursor.
-    //! \return The URL if the selected node is a bookmark.
-    //! \return A string of all URLs separated by a space if the selected node
-    //! is a folder.
+    //! \return An empty slice if there is no node under the mouse cursor.
+    //! \return The quoted URL if the selected node is a bookmark.
+    //! \return All quoted URLs below the folder, each one preceded by a
+    //! space, if the selected node is a folder.
     //----------------------------------------------------------------------
-    std::string const& getURL(sf::Vector2i mouse);
+    SubtreeIndex::Slice getURL(sf::Vector2i mouse);
 
     //----------------------------------------------------------------------
     //! \brief Get the title of the node (bookmark or folder) under the mouse
-    //! position.
-    //! \return The title of the node.
+    //! position in the newest snapshot.
+    //! \return The title of the node (empty if no node is under the mouse).
     //----------------------------------------------------------------------
-    std::string const& getTitle(sf::Vector2i mouse);
+    SubtreeIndex::Slice getTitle(sf::Vector2i mouse);
 
 private:
 
-    void getURL_chapo(DiGraph::Node const& node);
-    void getTitle_chapo(DiGraph::Node const& node);
+    //----------------------------------------------------------------------
+    //! \brief Return the index of the graph node under the mouse in the
+    //! newest snapshot (vertices of the layout share the node indices).
+    //! \return false if no node is under the mouse.
+    //----------------------------------------------------------------------
+    bool pick(sf::Vector2i const& mouse, DiGraph::Index& node);
 
     //----------------------------------------------------------------------
-    //! \brief C++ code generated by the script ../tool/bookmark.py from
-    //! the Firefox bookmarks exported as JSON file.
+    //! \brief Copy the topology of the layout for next snapshots. To be
+    //! called by the thread computing the layout after each reset.
+    //----------------------------------------------------------------------
+    void topology();
+
+    //----------------------------------------------------------------------
+    //! \brief Copy positions of the layout and publish them. To be called by
+    //! the thread computing the layout.
+    //----------------------------------------------------------------------
+    void publish();
+
+    //----------------------------------------------------------------------
+    //! \brief Entry point of the worker thread.
+    //----------------------------------------------------------------------
+    void simulate();
+
+    //----------------------------------------------------------------------
+    //! \brief Commit the changes recorded in the log since the last update.
+    //! Renaming only updates titles. Structural changes rebuild the graph
+    //! and update the layout from the current one.
+    //----------------------------------------------------------------------
+    void update();
+
+    //----------------------------------------------------------------------
+    //! \brief Start from the cached layout if usable.
+    //! \return true if the layout has been restored or warm started.
+    //----------------------------------------------------------------------
+    bool load();
+
+    //----------------------------------------------------------------------
+    //! \brief C++ code generated by the script bookmarks/parser.py from
+    //! the Firefox bookmarks exported as JSON file. Only used when compiled
+    //! with EMBEDDED_BOOKMARKS and the JSON file cannot be loaded.
     //----------------------------------------------------------------------
     void init(Bookmarks& bookmarks, Folders& folders);
 
     //----------------------------------------------------------------------
     //! \brief Create a directed graph from the Firefox bookmarks exported
-    //! as JSON file.
+    //! as JSON file, and index the URLs and titles of its subtrees.
     //----------------------------------------------------------------------
     void createGraph();
 
+    //----------------------------------------------------------------------
+    //! \brief Fill the bookmarks and folders from the graph and its index
+    //! when they have been mapped from a snapshot. To be called before
+    //! changing them. Does nothing otherwise.
+    //----------------------------------------------------------------------
+    void materialize();
+
 private:
 
     //! \brief Directed graph of bookmarks.
@@ -123,8 +307,39 @@ private:
     Bookmarks m_bookmarks;
     //! \brief Database for the graph (bookmark folders).
     Folders m_folders;
-    //! \brief Reserve memory for returning URL
-    std::string m_cache_urls;
+    //! \brief URLs and titles of the nodes and of their subtrees.
+    SubtreeIndex m_subtrees;
+    //! \brief Changes made to bookmarks and folders.
+    DiGraphLog m_log{ GRAPH_LOG_CAPACITY };
+    //! \brief Epoch of the log the graph and the layout have been built at.
+    uint64_t m_epoch = 0u;
+    //! \brief Topology of the layout, shared by snapshots.
+    std::shared_ptr<Snapshot::Topology const> m_topology;
+    //! \brief Snapshots exchanged between the worker and the GUI threads.
+    TripleBuffer<Snapshot> m_snapshots;
+    //! \brief Worker thread computing the layout.
+    std::thread m_thread;
+    //! \brief Request the worker thread to halt.
+    std::atomic<bool> m_halt{false};
+    //! \brief Dimension of the layout.
+    sf::Vector2f m_dimension;
+    //! \brief Layout saved between launches.
+    LayoutCache m_cache;
+    //! \brief Path of the snapshot file (none if empty).
+    std::string m_snapshot_file;
+    //! \brief Stamp of the bookmarks file the snapshot is made from.
+    uint64_t m_stamp;
+    //! \brief Set while the graph and its index are mapped from the snapshot
+    //! (the bookmarks and folders are then empty).
+    bool m_mapped = false;
+    //! \brief Set when the cache holds the current converged layout.
+    bool m_cached = false;
+    //! \brief Set when overlaps have been removed from the current converged
+    //! layout.
+    bool m_separated = false;
+    //! \brief Set once the initial (multilevel) layout has been computed:
+    //! next starts of the worker thread continue from the current layout.
+    bool m_laid_out = false;
 };
 
 #endif
@@ -53,11 +53,15 @@ void IslandedBrowserGUI::deactivate()
 
 //------------------------------------------------------------------------------
 void IslandedBrowserGUI::create()
-{}
+{
+    m_island.start();
+}
 
 //------------------------------------------------------------------------------
 void IslandedBrowserGUI::release()
-{}
+{
+    m_island.stop();
+}
 
 //------------------------------------------------------------------------------
 void IslandedBrowserGUI::handleInput()
@@ -67,10 +71,10 @@ void IslandedBrowserGUI::handleInput()
     m_mouse = sf::Mouse::getPosition(renderer());
 
     // Show the URL of the node pointed by the mouse cursor
-    std::string const& title = m_island.getTitle(m_mouse);
+    SubtreeIndex::Slice const title = m_island.getTitle(m_mouse);
     if (!title.empty())
     {
-        m_message_bar.entry(title, MESSAGEBAR_COLOR);
+        m_message_bar.entry(std::string(title.data(), title.size()), MESSAGEBAR_COLOR);
     }
 
     while (m_renderer.pollEvent(event))
@@ -85,14 +89,75 @@ void IslandedBrowserGUI::handleInput()
             {
                 m_renderer.close();
             }
+            else if (event.key.code == sf::Keyboard::R)
+            {
+                // Cycle between algorithms computing repulsive forces
+                ForceDirectedGraph& layout = m_island.layout();
+                switch (layout.repulsion())
+                {
+                case ForceDirectedGraph::Repulsion::Exact:
+                    layout.repulsion(ForceDirectedGraph::Repulsion::BarnesHut);
+                    m_message_bar.entry("Repulsion: Barnes-Hut", MESSAGEBAR_COLOR);
+                    break;
+                case ForceDirectedGraph::Repulsion::BarnesHut:
+                    layout.repulsion(ForceDirectedGraph::Repulsion::SIMD);
+                    m_message_bar.entry(std::string("Repulsion: exact ") +
+                                        SoALayout::name(layout.soa().isa()),
+                                        MESSAGEBAR_COLOR);
+                    break;
+                case ForceDirectedGraph::Repulsion::SIMD:
+                    layout.repulsion(ForceDirectedGraph::Repulsion::CellList);
+                    m_message_bar.entry("Repulsion: cell list", MESSAGEBAR_COLOR);
+                    break;
+                case ForceDirectedGraph::Repulsion::CellList:
+                default:
+                    layout.repulsion(ForceDirectedGraph::Repulsion::Exact);
+                    m_message_bar.entry("Repulsion: exact", MESSAGEBAR_COLOR);
+                    break;
+                }
+            }
+            else if (event.key.code == sf::Keyboard::M)
+            {
+                // Cycle between the laws of forces
+                ForceDirectedGraph& layout = m_island.layout();
+                switch (layout.model())
+                {
+                case ForceDirectedGraph::ForceModel::FruchtermanReingold:
+                    layout.model(ForceDirectedGraph::ForceModel::ForceAtlas2);
+                    m_message_bar.entry("Force model: ForceAtlas2", MESSAGEBAR_COLOR);
+                    break;
+                case ForceDirectedGraph::ForceModel::ForceAtlas2:
+                    layout.model(ForceDirectedGraph::ForceModel::LinLog);
+                    m_message_bar.entry("Force model: LinLog", MESSAGEBAR_COLOR);
+                    break;
+                case ForceDirectedGraph::ForceModel::LinLog:
+                default:
+                    layout.model(ForceDirectedGraph::ForceModel::FruchtermanReingold);
+                    m_message_bar.entry("Force model: Fruchterman-Reingold", MESSAGEBAR_COLOR);
+                    break;
+                }
+            }
+            else if ((event.key.code == sf::Keyboard::Add) ||
+                     (event.key.code == sf::Keyboard::Subtract))
+            {
+                // Tune the accuracy of the Barnes-Hut approximation
+                ForceDirectedGraph& layout = m_island.layout();
+                layout.theta(layout.theta() +
+                             ((event.key.code == sf::Keyboard::Add) ? 0.1f : -0.1f));
+                m_message_bar.entry("Barnes-Hut theta: " +
+                                    std::to_string(layout.theta()),
+                                    MESSAGEBAR_COLOR);
+            }
             break;
         case sf::Event::MouseButtonPressed:
             {
                 // TODO call several times Firefox because
-                std::string const& url = m_island.getURL(m_mouse);
-                if (!url.empty())
+                SubtreeIndex::Slice const urls = m_island.getURL(m_mouse);
+                if (!urls.empty())
                 {
-                    std::string command = BROWSER_NAME + url;
+                    // URLs are single quoted for the shell by SubtreeIndex
+                    std::string command(BROWSER_NAME);
+                    command.append(urls.data(), urls.size());
                     std::cout << "command: " << command << std::endl;
                     system(command.c_str());
                 }
@@ -108,23 +173,28 @@ void IslandedBrowserGUI::handleInput()
 void IslandedBrowserGUI::update(const float dt)
 {
     //std::cout << "FPS:" << 1.0f / dt << std::endl;
-    m_island.forceDirectedGraph();
+    // The layout is computed by the worker thread of m_island
 }
 
 //------------------------------------------------------------------------------
 void IslandedBrowserGUI::draw()
 {
-    // Scene view
-    for (auto const& it: m_island.vertices())
+    // Scene view: newest layout computed by the worker thread
+    IslandedBrowser::Snapshot const& snapshot = m_island.snapshot();
+    if (snapshot.topology != nullptr)
     {
-        Circle circle(it.position, NODE_RADIUS, it.color);
-        renderer().draw(circle);
-
-        for (auto const& n: it.neighbors)
+        auto const& topology = *snapshot.topology;
+        auto const& positions = snapshot.positions;
+        for (size_t i = 0u; i < positions.size(); ++i)
         {
-            Arrow arrow(it.position.x, it.position.y,
-                        n.position->x, n.position->y);
-            renderer().draw(arrow);
+            Circle circle(positions[i], NODE_RADIUS, topology.colors[i]);
+            renderer().draw(circle);
+
+            for (auto const& n: topology.neighbors(i))
+            {
+                Arrow arrow(positions[i], positions[n]);
+                renderer().draw(arrow);
+            }
         }
     }
 
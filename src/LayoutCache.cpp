@@ -0,0 +1,246 @@
+/* *****************************************************************************
+** MIT License
+**
+** Copyright (c) 2022 Quentin Quadrat
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+********************************************************************************
+*/
+
+#include "LayoutCache.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <numeric>
+
+//! \brief "IBLC": Islanded Browser Layout Cache.
+static constexpr uint32_t MAGIC = 0x434c4249u;
+//! \brief To be incremented when the format changes.
+static constexpr uint32_t VERSION = 1u;
+//! \brief Minimal share of nodes in common between the saved graph and the
+//! current one for a warm start: below, the saved positions would pin too few
+//! nodes and the incremental layout would be worse than a fresh one.
+static constexpr size_t NEAR_PERCENT = 50u;
+
+// *****************************************************************************
+//! \brief Header of the cache file.
+// *****************************************************************************
+struct Header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t fingerprint;
+    float width;
+    float height;
+    uint64_t count;
+};
+
+// *****************************************************************************
+//! \brief Layout of a node in the cache file.
+// *****************************************************************************
+struct Record
+{
+    uint64_t id;
+    float x;
+    float y;
+    uint32_t degree;
+    uint32_t padding;
+};
+
+//------------------------------------------------------------------------------
+//! \brief 64-bit FNV-1a hash of the given bytes, continuing the given hash.
+static uint64_t fnv1a(void const* data, size_t const size,
+                      uint64_t hash = 0xcbf29ce484222325ull)
+{
+    unsigned char const* bytes = static_cast<unsigned char const*>(data);
+    for (size_t i = 0u; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+//------------------------------------------------------------------------------
+//! \brief Continue the hash with the bytes of the given value.
+template<class T>
+static uint64_t combine(T const& value, uint64_t const hash)
+{
+    return fnv1a(&value, sizeof(T), hash);
+}
+
+//------------------------------------------------------------------------------
+LayoutCache::LayoutCache(std::string const& path)
+    : m_path(path)
+{}
+
+//------------------------------------------------------------------------------
+uint64_t LayoutCache::fingerprint(DiGraph const& digraph, sf::Vector2f const& dimension)
+{
+    uint64_t hash = combine(uint64_t(digraph.size()), 0xcbf29ce484222325ull);
+    hash = combine(dimension.x, hash);
+    hash = combine(dimension.y, hash);
+
+    // Indices and destination nodes depend on the order nodes and edges were
+    // added: hash nodes sorted by their identifier.
+    std::vector<DiGraph::Index> nodes(digraph.size());
+    std::iota(nodes.begin(), nodes.end(), DiGraph::Index(0));
+    std::sort(nodes.begin(), nodes.end(),
+              [&digraph](DiGraph::Index const a, DiGraph::Index const b)
+              {
+                  return digraph.id(a) < digraph.id(b);
+              });
+
+    std::vector<DiGraph::Node> destinations;
+    for (auto const& n: nodes)
+    {
+        destinations.clear();
+        for (auto const& neighbor: digraph.neighbors(n))
+        {
+            destinations.push_back(digraph.id(neighbor));
+        }
+        std::sort(destinations.begin(), destinations.end());
+        hash = combine(uint64_t(digraph.id(n)), hash);
+        hash = combine(uint64_t(destinations.size()), hash);
+        for (auto const& node: destinations)
+        {
+            hash = combine(uint64_t(node), hash);
+        }
+    }
+
+    return hash;
+}
+
+//------------------------------------------------------------------------------
+LayoutCache::Match LayoutCache::load(DiGraph const& digraph, sf::Vector2f const& dimension,
+                                     ForceDirectedGraph::Placements& placements) const
+{
+    placements.clear();
+
+    std::ifstream file(m_path, std::ios::binary);
+    if (!file)
+        return Match::None;
+
+    const std::vector<char> bytes((std::istreambuf_iterator<char>(file)),
+                                  std::istreambuf_iterator<char>());
+
+    // Check the size before reading anything. The division guards against a
+    // corrupted count overflowing the multiplication.
+    Header header;
+    if (bytes.size() < sizeof(Header) + sizeof(uint64_t))
+        return Match::None;
+    memcpy(&header, bytes.data(), sizeof(Header));
+    if ((header.magic != MAGIC) || (header.version != VERSION))
+        return Match::None;
+    if (header.count != (bytes.size() - sizeof(Header) - sizeof(uint64_t)) / sizeof(Record))
+        return Match::None;
+    if (bytes.size() != sizeof(Header) + header.count * sizeof(Record) + sizeof(uint64_t))
+        return Match::None;
+
+    uint64_t checksum;
+    const size_t payload = bytes.size() - sizeof(uint64_t);
+    memcpy(&checksum, bytes.data() + payload, sizeof(uint64_t));
+    if (checksum != fnv1a(bytes.data(), payload))
+        return Match::None;
+
+    // A layout made for other dimensions is useless
+    if ((std::abs(header.width - dimension.x) > 0.5f) ||
+        (std::abs(header.height - dimension.y) > 0.5f))
+        return Match::None;
+
+    placements.resize(size_t(header.count));
+    char const* data = bytes.data() + sizeof(Header);
+    for (size_t i = 0u; i < placements.size(); ++i, data += sizeof(Record))
+    {
+        Record record;
+        memcpy(&record, data, sizeof(Record));
+
+        // Records shall be sorted and inside the layout
+        if (((i > 0u) && (record.id <= placements[i - 1u].id)) ||
+            !(record.x >= 0.0f && record.x <= dimension.x) ||
+            !(record.y >= 0.0f && record.y <= dimension.y))
+        {
+            placements.clear();
+            return Match::None;
+        }
+        placements[i] = { DiGraph::Node(record.id), sf::Vector2f(record.x, record.y),
+                          record.degree };
+    }
+
+    if (header.fingerprint == fingerprint(digraph, dimension))
+        return Match::Exact;
+
+    // Share of nodes in common, relative to the larger of both graphs so
+    // that many additions or many removals both count.
+    size_t common = 0u;
+    for (auto const& placement: placements)
+    {
+        common += (digraph.index(placement.id) != DiGraph::npos) ? 1u : 0u;
+    }
+    if (100u * common < NEAR_PERCENT * std::max(placements.size(), digraph.size()))
+    {
+        placements.clear();
+        return Match::None;
+    }
+    return Match::Near;
+}
+
+//------------------------------------------------------------------------------
+bool LayoutCache::save(DiGraph const& digraph, sf::Vector2f const& dimension,
+                       ForceDirectedGraph::Placements const& placements) const
+{
+    std::vector<char> bytes(sizeof(Header) + placements.size() * sizeof(Record)
+                            + sizeof(uint64_t));
+
+    Header header;
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.fingerprint = fingerprint(digraph, dimension);
+    header.width = dimension.x;
+    header.height = dimension.y;
+    header.count = placements.size();
+    memcpy(bytes.data(), &header, sizeof(Header));
+
+    char* data = bytes.data() + sizeof(Header);
+    for (auto const& placement: placements)
+    {
+        Record record;
+        record.id = placement.id;
+        record.x = placement.position.x;
+        record.y = placement.position.y;
+        record.degree = placement.degree;
+        record.padding = 0u;
+        memcpy(data, &record, sizeof(Record));
+        data += sizeof(Record);
+    }
+
+    const uint64_t checksum = fnv1a(bytes.data(), size_t(data - bytes.data()));
+    memcpy(data, &checksum, sizeof(uint64_t));
+
+    const std::string temporary = m_path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file.write(bytes.data(), std::streamsize(bytes.size())))
+            return false;
+    }
+    return std::rename(temporary.c_str(), m_path.c_str()) == 0;
+}
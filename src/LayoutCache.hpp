@@ -0,0 +1,101 @@
+/* *****************************************************************************
+** MIT License
+**
+** Copyright (c) 2022 Quentin Quadrat
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+********************************************************************************
+*/
+
+#ifndef LAYOUTCACHE_HPP
+#  define LAYOUTCACHE_HPP
+
+#  include "ForceDirectedGraph.hpp"
+#  include <string>
+
+// *****************************************************************************
+//! \brief Layout saved on disk between two launches of the application, so
+//! that an unchanged bookmark graph is not laid out again.
+//!
+//! The file is keyed by a fingerprint of the graph structure (nodes and edges)
+//! and of the layout dimensions:
+//! - same fingerprint: the saved positions are used as they are and the
+//!   simulation is skipped.
+//! - same dimensions but different graph sharing at least half of its nodes
+//!   (relative to the larger of both graphs): the saved positions are a warm
+//!   start for nodes still present (see ForceDirectedGraph::incremental()).
+//! - otherwise the file is ignored.
+//!
+//! Binary format (native endianness): a header (magic, version, fingerprint,
+//! dimensions, number of nodes), one record per node (identifier, position,
+//! degree) sorted by identifiers, then a checksum of all previous bytes.
+//! Truncated, corrupted or foreign files are ignored.
+// *****************************************************************************
+class LayoutCache
+{
+public:
+
+    // *************************************************************************
+    //! \brief Result of load().
+    // *************************************************************************
+    enum class Match
+    {
+        //! \brief No usable cache.
+        None,
+        //! \brief The cache holds the layout of a different graph sharing at
+        //! least half of the nodes.
+        Near,
+        //! \brief The cache holds the layout of the same graph.
+        Exact
+    };
+
+    //----------------------------------------------------------------------
+    //! \brief Set the path of the cache file.
+    //----------------------------------------------------------------------
+    LayoutCache(std::string const& path);
+
+    //----------------------------------------------------------------------
+    //! \brief Read the cache file.
+    //! \param[in] digraph the graph to lay out.
+    //! \param[in] dimension the dimension of the layout.
+    //! \param[out] placements the saved layout (empty if Match::None).
+    //----------------------------------------------------------------------
+    Match load(DiGraph const& digraph, sf::Vector2f const& dimension,
+               ForceDirectedGraph::Placements& placements) const;
+
+    //----------------------------------------------------------------------
+    //! \brief Write the cache file. The file is first written aside then
+    //! renamed so that a crash never leaves a partial file.
+    //! \return false if the file could not be written.
+    //----------------------------------------------------------------------
+    bool save(DiGraph const& digraph, sf::Vector2f const& dimension,
+              ForceDirectedGraph::Placements const& placements) const;
+
+    //----------------------------------------------------------------------
+    //! \brief Hash of the graph structure and of the layout dimension.
+    //----------------------------------------------------------------------
+    static uint64_t fingerprint(DiGraph const& digraph, sf::Vector2f const& dimension);
+
+private:
+
+    //! \brief Path of the cache file.
+    std::string m_path;
+};
+
+#endif
@@ -0,0 +1,393 @@
+/* *****************************************************************************
+** MIT License
+**
+** Copyright (c) 2022 Quentin Quadrat
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+********************************************************************************
+*/
+
+#include "LayoutMetrics.hpp"
+#include <algorithm>
+#include <limits>
+
+//------------------------------------------------------------------------------
+template<size_t D>
+LayoutMetrics<D>::LayoutMetrics(size_t const pivots, float const radius)
+    : m_pivot_count(std::max(size_t(1u), pivots)), m_radius(radius)
+{}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+typename LayoutMetrics<D>::Metrics const&
+LayoutMetrics<D>::measure(Layout const& layout)
+{
+    distances(layout);
+    m_metrics.stress = stress(layout);
+    m_metrics.edge_cv = edge_cv(layout);
+    m_metrics.overlaps = overlaps(layout);
+    m_metrics.crossings = crossings(layout);
+    return m_metrics;
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+void LayoutMetrics<D>::distances(Layout const& layout)
+{
+    const size_t count = layout.vertices().size();
+
+    // Hash the adjacency: cheap compared to the breadth first searches
+    uint64_t signature = 14695981039346656037ull;
+    m_edges.clear();
+    for (size_t n = 0u; n < count; ++n)
+    {
+        for (auto const& u: layout.neighbors(n))
+        {
+            signature = (signature ^ u) * 1099511628211ull;
+            if (n < u)
+            {
+                m_edges.push_back(uint32_t(n));
+                m_edges.push_back(u);
+            }
+        }
+        signature = (signature ^ 0xffffffffull) * 1099511628211ull;
+    }
+    if ((count == m_size) && (signature == m_signature))
+        return ;
+
+    m_size = count;
+    m_signature = signature;
+
+    // Pivots evenly spread over the indices, which follow the creation
+    // order of the graph (so they spread over the folder hierarchy).
+    const size_t k = std::min(m_pivot_count, count);
+    m_pivots.resize(k);
+    for (size_t p = 0u; p < k; ++p)
+    {
+        m_pivots[p] = uint32_t(p * count / k);
+    }
+
+    m_distances.assign(k * count, std::numeric_limits<uint32_t>::max());
+    #pragma omp parallel default(shared)
+    {
+        std::vector<uint32_t> queue;
+        queue.reserve(count);
+
+        #pragma omp for schedule(dynamic, 1)
+        for (size_t p = 0u; p < k; ++p)
+        {
+            uint32_t* distances = &m_distances[p * count];
+            queue.clear();
+            queue.push_back(m_pivots[p]);
+            distances[m_pivots[p]] = 0u;
+            for (size_t q = 0u; q < queue.size(); ++q)
+            {
+                const uint32_t n = queue[q];
+                for (auto const& u: layout.neighbors(n))
+                {
+                    if (distances[u] == std::numeric_limits<uint32_t>::max())
+                    {
+                        distances[u] = distances[n] + 1u;
+                        queue.push_back(u);
+                    }
+                }
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+float LayoutMetrics<D>::stress(Layout const& layout) const
+{
+    // With the weights 1 / d^2, the stress of the layout scaled by s is the
+    // mean of (s x / d - 1)^2 over pairs at graph distance d and distance x.
+    // The optimal s = A / B with A = sum(x / d) and B = sum(x^2 / d^2) gives
+    // the normalized stress 1 - A^2 / (B pairs).
+    typename Layout::Vertices const& vertices = layout.vertices();
+    const size_t count = vertices.size();
+    const size_t k = m_pivots.size();
+    double a = 0.0, b = 0.0, pairs = 0.0;
+
+    #pragma omp parallel for default(shared) schedule(static) reduction(+: a, b, pairs)
+    for (size_t j = 0u; j < count; ++j)
+    {
+        for (size_t p = 0u; p < k; ++p)
+        {
+            const uint32_t d = m_distances[p * count + j];
+            if ((d == 0u) || (d == std::numeric_limits<uint32_t>::max()))
+                continue ;
+
+            const Vector delta = vertices[m_pivots[p]].position - vertices[j].position;
+            const double x = std::sqrt(double(dot(delta, delta))) / double(d);
+            a += x;
+            b += x * x;
+            pairs += 1.0;
+        }
+    }
+
+    return (b > 0.0) ? float(1.0 - a * a / (b * pairs)) : 0.0f;
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+float LayoutMetrics<D>::edge_cv(Layout const& layout) const
+{
+    typename Layout::Vertices const& vertices = layout.vertices();
+    const size_t edges = m_edges.size() / 2u;
+    double sum = 0.0, squares = 0.0;
+
+    #pragma omp parallel for default(shared) schedule(static) reduction(+: sum, squares)
+    for (size_t e = 0u; e < edges; ++e)
+    {
+        const Vector delta = vertices[m_edges[2u * e]].position -
+                             vertices[m_edges[2u * e + 1u]].position;
+        const double length = std::sqrt(double(dot(delta, delta)));
+        sum += length;
+        squares += length * length;
+    }
+
+    if ((edges == 0u) || (sum <= 0.0))
+        return 0.0f;
+    const double mean = sum / double(edges);
+    const double variance = std::max(0.0, squares / double(edges) - mean * mean);
+    return float(std::sqrt(variance) / mean);
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+size_t LayoutMetrics<D>::overlaps(Layout const& layout)
+{
+    typename Layout::Vertices const& vertices = layout.vertices();
+    const size_t count = vertices.size();
+    if (count == 0u)
+        return 0u;
+
+    Vector min = vertices[0].position, max = vertices[0].position;
+    for (auto const& vertex: vertices)
+    {
+        min = lower(min, vertex.position);
+        max = upper(max, vertex.position);
+    }
+
+    const float diameter = 2.0f * m_radius;
+    m_grid.build(count, min, max, diameter, [&vertices](size_t const i)
+    {
+        return vertices[i].position;
+    });
+
+    size_t overlaps = 0u;
+    #pragma omp parallel for default(shared) schedule(static) reduction(+: overlaps)
+    for (size_t i = 0u; i < count; ++i)
+    {
+        Vector const& position = vertices[i].position;
+        m_grid.neighbors(position, [&](size_t const j)
+        {
+            if (j > i)
+            {
+                const Vector delta = position - vertices[j].position;
+                if (dot(delta, delta) < diameter * diameter)
+                    ++overlaps;
+            }
+        });
+    }
+
+    return overlaps;
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+size_t LayoutMetrics<D>::crossings(Layout const& /*layout*/)
+{
+    // Crossings are only meaningful for a drawing in the plane
+    return 0u;
+}
+
+//------------------------------------------------------------------------------
+template<>
+size_t LayoutMetrics<2u>::crossings(Layout const& layout)
+{
+    Layout::Vertices const& vertices = layout.vertices();
+    const size_t edges = m_edges.size() / 2u;
+    if (edges < 2u)
+        return 0u;
+
+    // Cells about the size of an edge: an edge overlaps few cells and a cell
+    // holds few edges.
+    Vector min = vertices[0].position, max = vertices[0].position;
+    double length = 0.0;
+    for (size_t e = 0u; e < edges; ++e)
+    {
+        Vector const& p = vertices[m_edges[2u * e]].position;
+        Vector const& q = vertices[m_edges[2u * e + 1u]].position;
+        min = lower(min, lower(p, q));
+        max = upper(max, upper(p, q));
+        length += std::sqrt(double(dot(p - q, p - q)));
+    }
+    const float extent = std::max(max.x - min.x, max.y - min.y);
+    const float size = std::max(std::max(float(length / double(edges)),
+                                         extent / float(MAX_CELLS)), 1e-6f);
+    const float inv_size = 1.0f / size;
+    const int32_t columns = std::max(1, int32_t(std::ceil((max.x - min.x) * inv_size)));
+    const int32_t rows = std::max(1, int32_t(std::ceil((max.y - min.y) * inv_size)));
+    auto axis = [inv_size](float const x, float const origin, int32_t const cells)
+    {
+        return std::min(cells - 1, std::max(0, int32_t((x - origin) * inv_size)));
+    };
+
+    // Bin edges into the cells covered by their bounding box (counting sort)
+    const size_t ncells = size_t(columns) * size_t(rows);
+    m_ranges.resize(4u * edges);
+    m_cell_start.assign(ncells + 1u, 0u);
+    for (size_t e = 0u; e < edges; ++e)
+    {
+        Vector const& p = vertices[m_edges[2u * e]].position;
+        Vector const& q = vertices[m_edges[2u * e + 1u]].position;
+        int32_t* range = &m_ranges[4u * e];
+        range[0] = axis(std::min(p.x, q.x), min.x, columns);
+        range[1] = axis(std::min(p.y, q.y), min.y, rows);
+        range[2] = axis(std::max(p.x, q.x), min.x, columns);
+        range[3] = axis(std::max(p.y, q.y), min.y, rows);
+        for (int32_t y = range[1]; y <= range[3]; ++y)
+        {
+            for (int32_t x = range[0]; x <= range[2]; ++x)
+            {
+                ++m_cell_start[size_t(y) * size_t(columns) + size_t(x) + 1u];
+            }
+        }
+    }
+    for (size_t c = 0u; c < ncells; ++c)
+    {
+        m_cell_start[c + 1u] += m_cell_start[c];
+    }
+    m_cell_edges.resize(m_cell_start[ncells]);
+    for (size_t e = 0u; e < edges; ++e)
+    {
+        int32_t const* range = &m_ranges[4u * e];
+        for (int32_t y = range[1]; y <= range[3]; ++y)
+        {
+            for (int32_t x = range[0]; x <= range[2]; ++x)
+            {
+                m_cell_edges[m_cell_start[size_t(y) * size_t(columns) + size_t(x)]++] = uint32_t(e);
+            }
+        }
+    }
+    for (size_t c = ncells; c > 0u; --c)
+    {
+        m_cell_start[c] = m_cell_start[c - 1u];
+    }
+    m_cell_start[0] = 0u;
+
+    // Twice the signed area of the triangle abc
+    auto orientation = [](Vector const& a, Vector const& b, Vector const& c)
+    {
+        return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    };
+
+    // Test pairs of edges sharing a cell. A pair sharing several cells is
+    // only counted in the lowest cell of the intersection of their bounding
+    // boxes. Edges sharing a vertex never cross: in each cell, edges are
+    // grouped by their endpoint having the most edges in the cell, and edges
+    // of a group are not tested against each other. The edges of a folder
+    // with many children (flat trees) then cost nothing but their sort,
+    // instead of a number of rejected pairs quadratic in the degree.
+    size_t crossings = 0u;
+    #pragma omp parallel default(shared) reduction(+: crossings)
+    {
+        std::vector<uint32_t> ends;
+        std::vector<std::pair<uint32_t, uint32_t>> groups;
+        std::vector<uint32_t> next;
+
+        #pragma omp for schedule(dynamic, 64)
+        for (size_t c = 0u; c < ncells; ++c)
+        {
+            const uint32_t first = m_cell_start[c];
+            const uint32_t count = m_cell_start[c + 1u] - first;
+            if (count < 2u)
+                continue ;
+
+            // Number of edges of the cell at each vertex
+            ends.resize(2u * count);
+            for (uint32_t i = 0u; i < count; ++i)
+            {
+                const uint32_t e = m_cell_edges[first + i];
+                ends[2u * i] = m_edges[2u * e];
+                ends[2u * i + 1u] = m_edges[2u * e + 1u];
+            }
+            std::sort(ends.begin(), ends.end());
+            auto degree = [&ends](uint32_t const v)
+            {
+                auto const range = std::equal_range(ends.begin(), ends.end(), v);
+                return range.second - range.first;
+            };
+
+            // Edges sorted by group, and end of the group of each edge
+            groups.resize(count);
+            for (uint32_t i = 0u; i < count; ++i)
+            {
+                const uint32_t e = m_cell_edges[first + i];
+                const uint32_t a = m_edges[2u * e], b = m_edges[2u * e + 1u];
+                const auto da = degree(a), db = degree(b);
+                groups[i] = { ((da > db) || ((da == db) && (a < b))) ? a : b, e };
+            }
+            std::sort(groups.begin(), groups.end());
+            next.resize(count);
+            next[count - 1u] = count;
+            for (uint32_t i = count - 1u; i-- > 0u; )
+            {
+                next[i] = (groups[i].first == groups[i + 1u].first) ? next[i + 1u] : i + 1u;
+            }
+
+            const int32_t cx = int32_t(c % size_t(columns));
+            const int32_t cy = int32_t(c / size_t(columns));
+            for (uint32_t i = 0u; i < count; ++i)
+            {
+                const uint32_t e = groups[i].second;
+                const uint32_t a = m_edges[2u * e], b = m_edges[2u * e + 1u];
+                int32_t const* re = &m_ranges[4u * e];
+                for (uint32_t j = next[i]; j < count; ++j)
+                {
+                    const uint32_t f = groups[j].second;
+                    const uint32_t u = m_edges[2u * f], v = m_edges[2u * f + 1u];
+                    if ((a == u) || (a == v) || (b == u) || (b == v))
+                        continue ;
+
+                    int32_t const* rf = &m_ranges[4u * f];
+                    if ((std::max(re[0], rf[0]) != cx) || (std::max(re[1], rf[1]) != cy))
+                        continue ;
+
+                    Vector const& p = vertices[a].position;
+                    Vector const& q = vertices[b].position;
+                    Vector const& r = vertices[u].position;
+                    Vector const& s = vertices[v].position;
+                    if ((orientation(p, q, r) * orientation(p, q, s) < 0.0f) &&
+                        (orientation(r, s, p) * orientation(r, s, q) < 0.0f))
+                    {
+                        ++crossings;
+                    }
+                }
+            }
+        }
+    }
+
+    return crossings;
+}
+
+template class LayoutMetrics<2u>;
+template class LayoutMetrics<3u>;
@@ -0,0 +1,165 @@
+/* *****************************************************************************
+** MIT License
+**
+** Copyright (c) 2022 Quentin Quadrat
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+********************************************************************************
+*/
+
+#ifndef LAYOUTMETRICS_HPP
+#  define LAYOUTMETRICS_HPP
+
+#  include "ForceDirectedGraph.hpp"
+#  include "Settings.hpp"
+#  include <vector>
+#  include <cstdint>
+
+// *****************************************************************************
+//! \brief Quality of a layout, to compare engines and approximations on the
+//! same graph (for example, to plot the quality against the time spent):
+//! - normalized stress: how well distances in the layout match graph
+//!   distances, once the layout is optimally scaled (0 is perfect). It is
+//!   only estimated, from the pairs made of a few pivots and all vertices
+//!   instead of all pairs of vertices: exact when every vertex is a pivot.
+//! - coefficient of variation of the edge lengths: standard deviation divided
+//!   by the mean (0 when all edges have the same length).
+//! - overlaps: number of pairs of vertices whose disks overlap.
+//! - crossings: number of pairs of edges crossing each other (2D only, edges
+//!   sharing a vertex never cross).
+//!
+//! A measure costs O(N) for overlaps with a uniform grid, plus the number of
+//! overlapping pairs for crowded layouts, O(E log E) for crossings with a
+//! grid of edges (only edges sharing a cell but no vertex are tested), plus
+//! the number of crossing pairs, and O(pivots N) for the stress. Graph
+//! distances to the pivots are kept between measures and only computed again
+//! when the graph changes, so that the metrics can be sampled every few steps
+//! of a run.
+// *****************************************************************************
+template<size_t D>
+class LayoutMetrics
+{
+public:
+
+    //! \brief The measured layout.
+    using Layout = ForceDirectedLayout<D>;
+    //! \brief Position in the space of dimension D.
+    using Vector = typename Space<D>::Vector;
+
+    // *************************************************************************
+    //! \brief Result of measure().
+    // *************************************************************************
+    struct Metrics
+    {
+        //! \brief Normalized stress estimated from the pairs (pivot, vertex).
+        float stress = 0.0f;
+        //! \brief Coefficient of variation of the edge lengths.
+        float edge_cv = 0.0f;
+        //! \brief Number of pairs of overlapping vertices.
+        size_t overlaps = 0u;
+        //! \brief Number of pairs of crossing edges (0 in 3D).
+        size_t crossings = 0u;
+    };
+
+public:
+
+    //----------------------------------------------------------------------
+    //! \brief Constructor.
+    //! \param[in] pivots number of vertices from which graph distances are
+    //! computed for the stress.
+    //! \param[in] radius radius of the disk (ball in 3D) drawn for vertices.
+    //----------------------------------------------------------------------
+    LayoutMetrics(size_t const pivots = 32u, float const radius = NODE_RADIUS);
+
+    //----------------------------------------------------------------------
+    //! \brief Measure the current state of the layout.
+    //----------------------------------------------------------------------
+    Metrics const& measure(Layout const& layout);
+
+    //----------------------------------------------------------------------
+    //! \brief Return the result of the last measure.
+    //----------------------------------------------------------------------
+    inline Metrics const& metrics() const
+    {
+        return m_metrics;
+    }
+
+private:
+
+    //----------------------------------------------------------------------
+    //! \brief Choose pivots and compute graph distances from them by breadth
+    //! first searches, unless the graph is the same than the last time.
+    //----------------------------------------------------------------------
+    void distances(Layout const& layout);
+
+    //----------------------------------------------------------------------
+    //! \brief Normalized stress between pivots and vertices.
+    //----------------------------------------------------------------------
+    float stress(Layout const& layout) const;
+
+    //----------------------------------------------------------------------
+    //! \brief Coefficient of variation of the edge lengths.
+    //----------------------------------------------------------------------
+    float edge_cv(Layout const& layout) const;
+
+    //----------------------------------------------------------------------
+    //! \brief Count pairs of vertices closer than twice the radius.
+    //----------------------------------------------------------------------
+    size_t overlaps(Layout const& layout);
+
+    //----------------------------------------------------------------------
+    //! \brief Count pairs of crossing edges.
+    //----------------------------------------------------------------------
+    size_t crossings(Layout const& layout);
+
+private:
+
+    //! \brief Maximum number of cells along an axis of the grid of edges.
+    static constexpr int32_t MAX_CELLS = 1024;
+
+    //! \brief Number of pivots.
+    size_t m_pivot_count;
+    //! \brief Radius of vertices.
+    float m_radius;
+    //! \brief Result of the last measure.
+    Metrics m_metrics;
+    //! \brief Hash of the adjacency of the graph whose distances are known.
+    uint64_t m_signature = 0u;
+    //! \brief Number of vertices of the graph whose distances are known.
+    size_t m_size = 0u;
+    //! \brief Indices of the pivot vertices.
+    std::vector<uint32_t> m_pivots;
+    //! \brief Graph distances from each pivot to each vertex (row p holds the
+    //! distances of the p-th pivot).
+    std::vector<uint32_t> m_distances;
+    //! \brief Vertices binned into cells for overlaps.
+    UniformGrid<D> m_grid;
+    //! \brief Edges as pairs of vertices (first lower than second).
+    std::vector<uint32_t> m_edges;
+    //! \brief Range of cells covered by the bounding box of each edge
+    //! (lowest then highest cell along each axis).
+    std::vector<int32_t> m_ranges;
+    //! \brief Index in m_cell_edges of the first edge of each cell of the grid
+    //! of edges. One more element to hold the end of the last cell.
+    std::vector<uint32_t> m_cell_start;
+    //! \brief Edges overlapping each cell by their bounding box.
+    std::vector<uint32_t> m_cell_edges;
+};
+
+#endif
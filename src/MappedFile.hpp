@@ -0,0 +1,85 @@
+/* *****************************************************************************
+** MIT License
+**
+** Copyright (c) 2022 Quentin Quadrat
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+********************************************************************************
+*/
+
+#ifndef MAPPEDFILE_HPP
+#  define MAPPEDFILE_HPP
+
+#  include <string>
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+
+// *****************************************************************************
+//! \brief Read-only memory mapping of a whole file, unmapped when destroyed.
+//! The mapping stays valid if the file is replaced (renamed over) meanwhile.
+//! Empty or unreadable files give a null data(). The advice tells the kernel
+//! how pages will be accessed (see madvise(2)).
+// *****************************************************************************
+class MappedFile
+{
+public:
+
+    explicit MappedFile(std::string const& path, int const advice = MADV_SEQUENTIAL)
+    {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return ;
+
+        struct stat status;
+        if ((fstat(fd, &status) == 0) && (status.st_size > 0))
+        {
+            void* data = mmap(nullptr, size_t(status.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED)
+            {
+                madvise(data, size_t(status.st_size), advice);
+                m_data = static_cast<const char*>(data);
+                m_size = size_t(status.st_size);
+            }
+        }
+        ::close(fd);
+    }
+
+    ~MappedFile()
+    {
+        if (m_data != nullptr)
+        {
+            munmap(const_cast<char*>(m_data), m_size);
+        }
+    }
+
+    MappedFile(MappedFile const&) = delete;
+    MappedFile& operator=(MappedFile const&) = delete;
+
+    inline const char* data() const { return m_data; }
+    inline size_t size() const { return m_size; }
+
+private:
+
+    const char* m_data = nullptr;
+    size_t m_size = 0u;
+};
+
+#endif
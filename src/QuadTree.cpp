@@ -0,0 +1,152 @@
+/* *****************************************************************************
+** MIT License
+**
+** Copyright (c) 2022 Quentin Quadrat
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+********************************************************************************
+*/
+
+#include "QuadTree.hpp"
+#include <algorithm>
+
+//------------------------------------------------------------------------------
+template<size_t D>
+void Orthtree<D>::reset(Vector const& min, Vector const& max)
+{
+    m_cells.clear();
+
+    float extent = 0.0f;
+    for (size_t i = 0u; i < D; ++i)
+    {
+        extent = std::max(extent, coordinate(max, i) - coordinate(min, i));
+    }
+
+    Cell root;
+    root.center = (min + max) / 2.0f;
+    // Slightly enlarge the region to be sure max is strictly inside
+    root.half = std::max(0.5f, extent * 0.5f * 1.001f);
+    root.mass = 0.0f;
+    root.mass_center = Space<D>::splat(0.0f);
+    root.body = Space<D>::splat(0.0f);
+    root.child = -1;
+    m_cells.push_back(root);
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+void Orthtree<D>::subdivide(size_t const index)
+{
+    const int32_t first = int32_t(m_cells.size());
+    const float half = m_cells[index].half / 2.0f;
+    const Vector center = m_cells[index].center;
+
+    for (int32_t i = 0; i < CHILDREN; ++i)
+    {
+        Cell child;
+        for (size_t j = 0u; j < D; ++j)
+        {
+            coordinate(child.center, j) = coordinate(center, j) +
+                                          (((i >> j) & 1) != 0 ? half : -half);
+        }
+        child.half = half;
+        child.mass = 0.0f;
+        child.mass_center = Space<D>::splat(0.0f);
+        child.body = Space<D>::splat(0.0f);
+        child.child = -1;
+        m_cells.push_back(child);
+    }
+
+    // Beware: push_back() may have invalidated references on the cell
+    Cell& cell = m_cells[index];
+    cell.child = first;
+
+    // Move down the vertex held by the former leaf
+    Cell& moved = m_cells[size_t(first + quadrant(cell, cell.body))];
+    moved.mass = cell.mass;
+    moved.mass_center = cell.mass_center;
+    moved.body = cell.body;
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+void Orthtree<D>::insert(Vector const& position, float const mass)
+{
+    size_t index = 0u;
+    size_t depth = 0u;
+
+    while (true)
+    {
+        Cell& cell = m_cells[index];
+
+        // Empty leaf: store the vertex
+        if ((cell.child < 0) && (cell.mass <= 0.0f))
+        {
+            cell.mass = mass;
+            cell.mass_center = position * mass;
+            cell.body = position;
+            return ;
+        }
+
+        // Leaf already holding a vertex: split it unless too deep
+        if (cell.child < 0)
+        {
+            if (depth >= MAX_DEPTH)
+            {
+                cell.mass += mass;
+                cell.mass_center += position * mass;
+                return ;
+            }
+            subdivide(index);
+        }
+
+        Cell& parent = m_cells[index];
+        parent.mass += mass;
+        parent.mass_center += position * mass;
+        index = size_t(parent.child + quadrant(parent, position));
+        ++depth;
+    }
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+void Orthtree<D>::finalize()
+{
+    const size_t count = m_cells.size();
+
+    #pragma omp parallel for default(shared) schedule(static)
+    for (size_t i = 0u; i < count; ++i)
+    {
+        // Leaves take the exact position of their vertex: dividing the
+        // weighted position by a mass other than 1 may round it, and the
+        // vertex would then repulse itself from a tiny distance.
+        Cell& cell = m_cells[i];
+        if (cell.child < 0)
+        {
+            cell.mass_center = cell.body;
+        }
+        else if (cell.mass > 0.0f)
+        {
+            cell.mass_center /= cell.mass;
+        }
+    }
+}
+
+template class Orthtree<2u>;
+template class Orthtree<3u>;
@@ -0,0 +1,210 @@
+/* *****************************************************************************
+** MIT License
+**
+** Copyright (c) 2022 Quentin Quadrat
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+********************************************************************************
+*/
+
+#ifndef QUADTREE_HPP
+#  define QUADTREE_HPP
+
+#  include "Vector.hpp"
+#  include <vector>
+#  include <cstdint>
+#  include <cmath>
+
+// *****************************************************************************
+//! \brief Quadtree used by the Barnes-Hut approximation of the repulsive
+//! forces. Each cell of the tree knows the total mass and the center of mass of
+//! the vertices it holds: when a cell is far enough from a vertex (the ratio
+//! cell size / distance is lower than the opening angle theta) the whole cell
+//! is seen as a single heavy vertex placed at its center of mass. This reduces
+//! the cost of the repulsion from O(N^2) to O(N log N).
+//!
+//! The tree is meant to be rebuilt from scratch at each step of the layout:
+//! cells are stored in a flat vector whose memory is kept between two builds.
+//!
+//! The tree is written for any dimension D: each cell has 2^D children, i.e.
+//! a quadtree in 2D and an octree in 3D.
+//!
+//! For more information see:
+//! https://en.wikipedia.org/wiki/Barnes%E2%80%93Hut_simulation
+// *****************************************************************************
+template<size_t D>
+class Orthtree
+{
+public:
+
+    //! \brief Position in the space.
+    using Vector = typename Space<D>::Vector;
+
+    //! \brief Number of children of a cell.
+    static constexpr int32_t CHILDREN = 1 << D;
+
+    // *************************************************************************
+    //! \brief Square (or cube) region of the space.
+    // *************************************************************************
+    struct Cell
+    {
+        //! \brief Center of the square.
+        Vector center;
+        //! \brief Half of the square side.
+        float half;
+        //! \brief Total mass of the vertices inside the cell.
+        float mass;
+        //! \brief Sum of weighted positions during the build, then center of
+        //! mass (position of the vertex for leaves).
+        Vector mass_center;
+        //! \brief Position of the vertex when the cell is a leaf holding a
+        //! single vertex.
+        Vector body;
+        //! \brief Index of the first of the 2^D consecutive children. -1 for
+        //! leaves.
+        int32_t child;
+    };
+
+public:
+
+    //----------------------------------------------------------------------
+    //! \brief Clear the tree and set the square region covering all the
+    //! vertices that will be inserted.
+    //! \param[in] min lowest corner of the bounding box of the vertices.
+    //! \param[in] max highest corner of the bounding box of the vertices.
+    //----------------------------------------------------------------------
+    void reset(Vector const& min, Vector const& max);
+
+    //----------------------------------------------------------------------
+    //! \brief Insert a vertex in the tree.
+    //! \param[in] mass strictly positive mass of the vertex.
+    //! \pre The position shall be inside the region given to reset().
+    //----------------------------------------------------------------------
+    void insert(Vector const& position, float const mass = 1.0f);
+
+    //----------------------------------------------------------------------
+    //! \brief Compute the center of mass of each cell. To be called once all
+    //! vertices have been inserted and before calling accumulate().
+    //----------------------------------------------------------------------
+    void finalize();
+
+    //----------------------------------------------------------------------
+    //! \brief Traverse the tree and sum the forces applied on the given
+    //! position.
+    //! \param[in] position world coordinate of the vertex.
+    //! \param[in] theta opening angle: a cell is approximated by its center of
+    //! mass when its size is lower than theta * distance. 0 gives the exact
+    //! O(N) sum.
+    //! \param[in] force functor force(direction, mass) returning the force
+    //! applied by a body of the given mass placed at position - direction.
+    //----------------------------------------------------------------------
+    template<class Force>
+    Vector accumulate(Vector const& position, float const theta,
+                      Force const& force) const
+    {
+        Vector sum = Space<D>::splat(0.0f);
+        if (m_cells.empty())
+            return sum;
+
+        const float theta2 = theta * theta;
+        int32_t stack[MAX_DEPTH * (CHILDREN - 1) + CHILDREN];
+        int32_t top = 0;
+        stack[top++] = 0;
+
+        while (top > 0)
+        {
+            Cell const& cell = m_cells[size_t(stack[--top])];
+            if (cell.mass <= 0.0f)
+                continue ;
+
+            const Vector direction(position - cell.mass_center);
+            if (cell.child < 0)
+            {
+                sum += force(direction, cell.mass);
+                continue ;
+            }
+
+            // Never approximate a cell holding the vertex itself
+            bool inside = true;
+            for (size_t i = 0u; i < D; ++i)
+            {
+                inside &= (std::fabs(coordinate(position, i) - coordinate(cell.center, i)) <= cell.half);
+            }
+            const float size = 2.0f * cell.half;
+            if (!inside && (size * size < theta2 * dot(direction, direction)))
+            {
+                sum += force(direction, cell.mass);
+            }
+            else
+            {
+                for (int32_t i = 0; i < CHILDREN; ++i)
+                    stack[top++] = cell.child + i;
+            }
+        }
+
+        return sum;
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Const getter of the cells. The first one is the root.
+    //----------------------------------------------------------------------
+    inline std::vector<Cell> const& cells() const
+    {
+        return m_cells;
+    }
+
+private:
+
+    //----------------------------------------------------------------------
+    //! \brief Split a leaf into 2^D children.
+    //----------------------------------------------------------------------
+    void subdivide(size_t const index);
+
+    //----------------------------------------------------------------------
+    //! \brief Return the index of the child quadrant (octant in 3D)
+    //! containing the position: bit i is set when the i-th coordinate is on
+    //! the upper side of the center.
+    //----------------------------------------------------------------------
+    inline int32_t quadrant(Cell const& cell, Vector const& p) const
+    {
+        int32_t q = 0;
+        for (size_t i = 0u; i < D; ++i)
+        {
+            q |= ((coordinate(p, i) >= coordinate(cell.center, i)) ? 1 : 0) << i;
+        }
+        return q;
+    }
+
+private:
+
+    //! \brief Maximum depth of the tree. Vertices sharing the same position
+    //! would subdivide endlessly: below this depth they are merged into a
+    //! single leaf.
+    static constexpr size_t MAX_DEPTH = 32u;
+
+    //! \brief Flat storage of the cells.
+    std::vector<Cell> m_cells;
+};
+
+//! \brief Barnes-Hut tree of 2D layouts.
+using QuadTree = Orthtree<2u>;
+//! \brief Barnes-Hut tree of 3D layouts.
+using Octree = Orthtree<3u>;
+
+#endif
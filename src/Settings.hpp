@@ -60,6 +60,15 @@
 #  define FOLDER_COLOR sf::Color::Red
 //! \brief Color of bookmark nodes
 #  define BOOKMARK_COLOR sf::Color::Blue
+//! \brief Firefox bookmarks exported as JSON file, read at launch
+#  define BOOKMARKS_PATH "bookmarks/bookmarks.json"
+//! \brief Binary snapshot of the bookmarks, mapped by the next launch
+#  define ISLAND_SNAPSHOT_PATH "islanded-browser.snapshot"
+//! \brief File caching the layout between two launches
+#  define LAYOUT_CACHE_PATH "islanded-browser.cache"
+//! \brief Number of bookmark changes kept to skip the rebuild of the graph
+//! after renames and to place moved subtrees again, keeping other positions
+#  define GRAPH_LOG_CAPACITY 65536
 //! \brief The name of your favorite browser
 #  define BROWSER_NAME "firefox"
 
@@ -0,0 +1,317 @@
+/* *****************************************************************************
+** MIT License
+**
+** Copyright (c) 2022 Quentin Quadrat
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+********************************************************************************
+*/
+
+#include "SoALayout.hpp"
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#  define SOA_X86 1
+#  include <immintrin.h>
+#endif
+
+//! \brief Minimal squared distance between two vertices (same clamping than
+//! ForceDirectedGraph::distance()).
+static constexpr float MIN_DIST2 = 0.001f * 0.001f;
+
+//------------------------------------------------------------------------------
+//! \brief Reference kernel. Kernels are templates on the dimension D: the
+//! z coordinate is only read when D == 3, the test being resolved at compile
+//! time.
+template<size_t D>
+static void repulsion_scalar(SoALayout& soa, float const c,
+                             uint32_t const* targets, size_t const count)
+{
+    const size_t n = soa.size();
+    float const* x = soa.x.data();
+    float const* y = soa.y.data();
+    float const* z = soa.z.data();
+    float const* m = soa.mass.data();
+
+    #pragma omp parallel for default(shared) schedule(static)
+    for (size_t k = 0u; k < count; ++k)
+    {
+        const size_t i = (targets == nullptr) ? k : targets[k];
+        float fx = 0.0f, fy = 0.0f, fz = 0.0f;
+        for (size_t j = 0u; j < n; ++j)
+        {
+            // i == j gives a null direction and therefore a null force
+            const float ux = x[i] - x[j];
+            const float uy = y[i] - y[j];
+            const float uz = (D > 2u) ? z[i] - z[j] : 0.0f;
+            const float s = c / std::max(MIN_DIST2, ux * ux + uy * uy + uz * uz) * m[j];
+            fx += ux * s;
+            fy += uy * s;
+            fz += uz * s;
+        }
+        soa.dx[i] += fx;
+        soa.dy[i] += fy;
+        if (D > 2u)
+            soa.dz[i] += fz;
+    }
+}
+
+#if defined(SOA_X86)
+
+//------------------------------------------------------------------------------
+//! \brief 4 vertices per instruction. SSE2 is always available on x86-64.
+template<size_t D>
+__attribute__((target("sse2")))
+static void repulsion_sse2(SoALayout& soa, float const c,
+                           uint32_t const* targets, size_t const count)
+{
+    const size_t n = soa.size();
+    const size_t n4 = n & ~size_t(3);
+    float const* x = soa.x.data();
+    float const* y = soa.y.data();
+    float const* z = soa.z.data();
+    float const* m = soa.mass.data();
+
+    #pragma omp parallel for default(shared) schedule(static)
+    for (size_t k = 0u; k < count; ++k)
+    {
+        const size_t i = (targets == nullptr) ? k : targets[k];
+        const __m128 xi = _mm_set1_ps(x[i]);
+        const __m128 yi = _mm_set1_ps(y[i]);
+        const __m128 zi = _mm_set1_ps((D > 2u) ? z[i] : 0.0f);
+        const __m128 cc = _mm_set1_ps(c);
+        const __m128 md = _mm_set1_ps(MIN_DIST2);
+        __m128 fx = _mm_setzero_ps();
+        __m128 fy = _mm_setzero_ps();
+        __m128 fz = _mm_setzero_ps();
+
+        size_t j = 0u;
+        for (; j < n4; j += 4u)
+        {
+            const __m128 ux = _mm_sub_ps(xi, _mm_load_ps(x + j));
+            const __m128 uy = _mm_sub_ps(yi, _mm_load_ps(y + j));
+            __m128 d2 = _mm_add_ps(_mm_mul_ps(ux, ux), _mm_mul_ps(uy, uy));
+            __m128 uz = _mm_setzero_ps();
+            if (D > 2u)
+            {
+                uz = _mm_sub_ps(zi, _mm_load_ps(z + j));
+                d2 = _mm_add_ps(d2, _mm_mul_ps(uz, uz));
+            }
+            const __m128 s = _mm_mul_ps(_mm_div_ps(cc, _mm_max_ps(md, d2)), _mm_load_ps(m + j));
+            fx = _mm_add_ps(fx, _mm_mul_ps(ux, s));
+            fy = _mm_add_ps(fy, _mm_mul_ps(uy, s));
+            if (D > 2u)
+                fz = _mm_add_ps(fz, _mm_mul_ps(uz, s));
+        }
+
+        alignas(16) float sx[4], sy[4], sz[4];
+        _mm_store_ps(sx, fx);
+        _mm_store_ps(sy, fy);
+        _mm_store_ps(sz, fz);
+        float sumx = (sx[0] + sx[1]) + (sx[2] + sx[3]);
+        float sumy = (sy[0] + sy[1]) + (sy[2] + sy[3]);
+        float sumz = (sz[0] + sz[1]) + (sz[2] + sz[3]);
+
+        for (; j < n; ++j)
+        {
+            const float ux = x[i] - x[j];
+            const float uy = y[i] - y[j];
+            const float uz = (D > 2u) ? z[i] - z[j] : 0.0f;
+            const float s = c / std::max(MIN_DIST2, ux * ux + uy * uy + uz * uz) * m[j];
+            sumx += ux * s;
+            sumy += uy * s;
+            sumz += uz * s;
+        }
+        soa.dx[i] += sumx;
+        soa.dy[i] += sumy;
+        if (D > 2u)
+            soa.dz[i] += sumz;
+    }
+}
+
+//------------------------------------------------------------------------------
+//! \brief 8 vertices per instruction.
+template<size_t D>
+__attribute__((target("avx2,fma")))
+static void repulsion_avx2(SoALayout& soa, float const c,
+                           uint32_t const* targets, size_t const count)
+{
+    const size_t n = soa.size();
+    const size_t n8 = n & ~size_t(7);
+    float const* x = soa.x.data();
+    float const* y = soa.y.data();
+    float const* z = soa.z.data();
+    float const* m = soa.mass.data();
+
+    #pragma omp parallel for default(shared) schedule(static)
+    for (size_t k = 0u; k < count; ++k)
+    {
+        const size_t i = (targets == nullptr) ? k : targets[k];
+        const __m256 xi = _mm256_set1_ps(x[i]);
+        const __m256 yi = _mm256_set1_ps(y[i]);
+        const __m256 zi = _mm256_set1_ps((D > 2u) ? z[i] : 0.0f);
+        const __m256 cc = _mm256_set1_ps(c);
+        const __m256 md = _mm256_set1_ps(MIN_DIST2);
+        __m256 fx = _mm256_setzero_ps();
+        __m256 fy = _mm256_setzero_ps();
+        __m256 fz = _mm256_setzero_ps();
+
+        size_t j = 0u;
+        for (; j < n8; j += 8u)
+        {
+            const __m256 ux = _mm256_sub_ps(xi, _mm256_load_ps(x + j));
+            const __m256 uy = _mm256_sub_ps(yi, _mm256_load_ps(y + j));
+            __m256 d2 = _mm256_fmadd_ps(ux, ux, _mm256_mul_ps(uy, uy));
+            __m256 uz = _mm256_setzero_ps();
+            if (D > 2u)
+            {
+                uz = _mm256_sub_ps(zi, _mm256_load_ps(z + j));
+                d2 = _mm256_fmadd_ps(uz, uz, d2);
+            }
+            const __m256 s = _mm256_mul_ps(_mm256_div_ps(cc, _mm256_max_ps(md, d2)), _mm256_load_ps(m + j));
+            fx = _mm256_fmadd_ps(ux, s, fx);
+            fy = _mm256_fmadd_ps(uy, s, fy);
+            if (D > 2u)
+                fz = _mm256_fmadd_ps(uz, s, fz);
+        }
+
+        alignas(32) float sx[8], sy[8], sz[8];
+        _mm256_store_ps(sx, fx);
+        _mm256_store_ps(sy, fy);
+        _mm256_store_ps(sz, fz);
+        float sumx = ((sx[0] + sx[1]) + (sx[2] + sx[3])) + ((sx[4] + sx[5]) + (sx[6] + sx[7]));
+        float sumy = ((sy[0] + sy[1]) + (sy[2] + sy[3])) + ((sy[4] + sy[5]) + (sy[6] + sy[7]));
+        float sumz = ((sz[0] + sz[1]) + (sz[2] + sz[3])) + ((sz[4] + sz[5]) + (sz[6] + sz[7]));
+
+        for (; j < n; ++j)
+        {
+            const float ux = x[i] - x[j];
+            const float uy = y[i] - y[j];
+            const float uz = (D > 2u) ? z[i] - z[j] : 0.0f;
+            const float s = c / std::max(MIN_DIST2, ux * ux + uy * uy + uz * uz) * m[j];
+            sumx += ux * s;
+            sumy += uy * s;
+            sumz += uz * s;
+        }
+        soa.dx[i] += sumx;
+        soa.dy[i] += sumy;
+        if (D > 2u)
+            soa.dz[i] += sumz;
+    }
+}
+
+#endif // SOA_X86
+
+//------------------------------------------------------------------------------
+SoALayout::SoALayout()
+    : m_isa(detect())
+{}
+
+//------------------------------------------------------------------------------
+void SoALayout::resize(size_t const count, size_t const dimension)
+{
+    x.resize(count);
+    y.resize(count);
+    z.resize((dimension > 2u) ? count : 0u);
+    dx.resize(count);
+    dy.resize(count);
+    dz.resize((dimension > 2u) ? count : 0u);
+    mass.resize(count, 1.0f);
+}
+
+//------------------------------------------------------------------------------
+SoALayout::ISA SoALayout::detect()
+{
+#if defined(SOA_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return ISA::AVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return ISA::SSE2;
+#endif
+    return ISA::Scalar;
+}
+
+//------------------------------------------------------------------------------
+void SoALayout::isa(ISA const set)
+{
+    m_isa = std::min(set, detect());
+}
+
+//------------------------------------------------------------------------------
+const char* SoALayout::name(ISA const set)
+{
+    switch (set)
+    {
+    case ISA::AVX2:
+        return "AVX2";
+    case ISA::SSE2:
+        return "SSE2";
+    case ISA::Scalar:
+    default:
+        return "scalar";
+    }
+}
+
+//------------------------------------------------------------------------------
+//! \brief Dispatch to the kernel of the given instruction set.
+//! \param[in] targets vertices to update, nullptr for all vertices.
+template<size_t D>
+static void repulsion(SoALayout& soa, SoALayout::ISA const isa, float const c,
+                      uint32_t const* targets, size_t const count)
+{
+    switch (isa)
+    {
+#if defined(SOA_X86)
+    case SoALayout::ISA::AVX2:
+        repulsion_avx2<D>(soa, c, targets, count);
+        break;
+    case SoALayout::ISA::SSE2:
+        repulsion_sse2<D>(soa, c, targets, count);
+        break;
+#endif
+    case SoALayout::ISA::Scalar:
+    default:
+        repulsion_scalar<D>(soa, c, targets, count);
+        break;
+    }
+}
+
+//------------------------------------------------------------------------------
+//! \brief Dispatch to the kernel of the dimension of the layout.
+static void repulsion(SoALayout& soa, SoALayout::ISA const isa, float const c,
+                      uint32_t const* targets, size_t const count)
+{
+    if (soa.z.empty())
+        repulsion<2u>(soa, isa, c, targets, count);
+    else
+        repulsion<3u>(soa, isa, c, targets, count);
+}
+
+//------------------------------------------------------------------------------
+void SoALayout::repulsion(float const c)
+{
+    ::repulsion(*this, m_isa, c, nullptr, size());
+}
+
+//------------------------------------------------------------------------------
+void SoALayout::repulsion(float const c, std::vector<uint32_t> const& targets)
+{
+    ::repulsion(*this, m_isa, c, targets.data(), targets.size());
+}
@@ -0,0 +1,186 @@
+/* *****************************************************************************
+** MIT License
+**
+** Copyright (c) 2022 Quentin Quadrat
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+********************************************************************************
+*/
+
+#ifndef SOALAYOUT_HPP
+#  define SOALAYOUT_HPP
+
+#  include <vector>
+#  include <cstddef>
+#  include <cstdint>
+#  include <cstdlib>
+#  include <new>
+
+// *****************************************************************************
+//! \brief Allocator returning memory aligned on the given number of bytes, as
+//! needed by SIMD load and store instructions.
+// *****************************************************************************
+template<class T, size_t Alignment>
+class AlignedAllocator
+{
+public:
+
+    using value_type = T;
+
+    template<class U>
+    struct rebind
+    {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() = default;
+
+    template<class U>
+    AlignedAllocator(AlignedAllocator<U, Alignment> const&) {}
+
+    T* allocate(size_t const n)
+    {
+        void* ptr = nullptr;
+        if (posix_memalign(&ptr, Alignment, n * sizeof(T)) != 0)
+            throw std::bad_alloc();
+        return static_cast<T*>(ptr);
+    }
+
+    void deallocate(T* ptr, size_t const)
+    {
+        free(ptr);
+    }
+
+    template<class U>
+    bool operator==(AlignedAllocator<U, Alignment> const&) const { return true; }
+
+    template<class U>
+    bool operator!=(AlignedAllocator<U, Alignment> const&) const { return false; }
+};
+
+// *****************************************************************************
+//! \brief Structure-of-arrays storage of the vertex positions and displacements
+//! used by the SIMD repulsion kernels. Contrary to ForceDirectedGraph::Vertex,
+//! which mixes positions, displacements and colors, the repulsion loop only
+//! streams the 12 bytes it needs per vertex (16 bytes in 3D).
+//!
+//! The kernel is explicitly vectorized for AVX2 (8 vertices per instruction)
+//! and SSE2 (4 vertices per instruction) with a scalar fallback. The best
+//! instruction set supported by the CPU is picked at runtime.
+//!
+//! Tolerance: all kernels compute the same sum, only the summation order and
+//! the fused multiply-add rounding differ. The displacement of each vertex
+//! matches the scalar kernel within a relative error of 1e-5 of the sum of the
+//! magnitudes of the individual forces applied on it (checked by
+//! tests/ForceTests.cpp).
+// *****************************************************************************
+class SoALayout
+{
+public:
+
+    //! \brief Array of floats aligned on 32 bytes (AVX2 registers).
+    using Floats = std::vector<float, AlignedAllocator<float, 32u>>;
+
+    // *************************************************************************
+    //! \brief Instruction set used by the repulsion kernel.
+    // *************************************************************************
+    enum class ISA
+    {
+        Scalar,
+        SSE2,
+        AVX2
+    };
+
+public:
+
+    //----------------------------------------------------------------------
+    //! \brief Default constructor: select the best instruction set of the
+    //! CPU.
+    //----------------------------------------------------------------------
+    SoALayout();
+
+    //----------------------------------------------------------------------
+    //! \brief Set the number of vertices and the dimension of the space (2
+    //! or 3). The z and dz arrays are empty in 2D. New vertices weigh 1.
+    //----------------------------------------------------------------------
+    void resize(size_t const count, size_t const dimension = 2u);
+
+    //----------------------------------------------------------------------
+    //! \brief Return the number of vertices.
+    //----------------------------------------------------------------------
+    inline size_t size() const
+    {
+        return x.size();
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Force the instruction set (for example to compare kernels). It
+    //! falls back on the best one supported by the CPU if not available.
+    //----------------------------------------------------------------------
+    void isa(ISA const set);
+
+    //----------------------------------------------------------------------
+    //! \brief Return the instruction set used by the repulsion kernel.
+    //----------------------------------------------------------------------
+    inline ISA isa() const
+    {
+        return m_isa;
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Return the name of the given instruction set.
+    //----------------------------------------------------------------------
+    static const char* name(ISA const set);
+
+    //----------------------------------------------------------------------
+    //! \brief Return the best instruction set supported by the CPU.
+    //----------------------------------------------------------------------
+    static ISA detect();
+
+    //----------------------------------------------------------------------
+    //! \brief Add to dx, dy (and dz) the repulsive forces c * mj * (pi - pj) / |pi - pj|^2
+    //! between all pairs of vertices i and j.
+    //! \param[in] c repulsion coefficient.
+    //----------------------------------------------------------------------
+    void repulsion(float const c);
+
+    //----------------------------------------------------------------------
+    //! \brief Same than repulsion(c) but only update displacements of the given
+    //! vertices i (all vertices j still apply a force).
+    //! \param[in] c repulsion coefficient.
+    //! \param[in] targets indices of vertices i.
+    //----------------------------------------------------------------------
+    void repulsion(float const c, std::vector<uint32_t> const& targets);
+
+public:
+
+    //! \brief Positions of vertices.
+    Floats x, y, z;
+    //! \brief Displacements of vertices.
+    Floats dx, dy, dz;
+    //! \brief Masses of vertices.
+    Floats mass;
+
+private:
+
+    //! \brief Instruction set used by the repulsion kernel.
+    ISA m_isa;
+};
+
+#endif
@@ -0,0 +1,175 @@
+/* *****************************************************************************
+** MIT License
+**
+** Copyright (c) 2022 Quentin Quadrat
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+********************************************************************************
+*/
+
+#include "SubtreeIndex.hpp"
+
+//------------------------------------------------------------------------------
+void SubtreeIndex::build(DiGraph const& digraph, std::map<int, Bookmark> const& bookmarks,
+                         std::map<int, Folder> const& folders)
+{
+    const size_t count = digraph.size();
+    auto arrays = std::make_shared<Arrays>();
+
+    // Titles and kinds by node index. Leaves are looked up among bookmarks
+    // first (empty folders are leaves too), other nodes among folders first.
+    std::string& titles = arrays->titles;
+    arrays->title_offsets.resize(count + 1u);
+    arrays->kinds.resize(count, Kind::None);
+    for (DiGraph::Index n = 0u; n < count; ++n)
+    {
+        const int id = int(digraph.id(n));
+        auto const bookmark = bookmarks.find(id);
+        auto const folder = folders.find(id);
+        const bool leaf = (digraph.degree(n) == 0u);
+        if ((bookmark != bookmarks.end()) && (leaf || (folder == folders.end())))
+        {
+            titles += bookmark->second.title;
+            arrays->kinds[n] = Kind::Bookmark;
+        }
+        else if (folder != folders.end())
+        {
+            titles += folder->second.title;
+            arrays->kinds[n] = Kind::Folder;
+        }
+        arrays->title_offsets[n + 1u] = uint32_t(titles.size());
+    }
+
+    // Depth-first traversal from the roots, then from nodes only reachable
+    // through a cycle. The stack holds the nodes being visited and their
+    // next child to visit.
+    std::vector<uint32_t>& first = arrays->first;
+    std::vector<uint32_t>& last = arrays->last;
+    std::string& urls = arrays->urls;
+    std::vector<uint32_t>& offsets = arrays->url_offsets;
+    first.assign(count, 0u);
+    last.assign(count, 0u);
+    std::vector<uint8_t> visited(count, 0u);
+    std::vector<std::pair<DiGraph::Index, uint32_t>> stack;
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        for (DiGraph::Index root = 0u; root < count; ++root)
+        {
+            if ((visited[root] != 0u) ||
+                ((pass == 0) && (digraph.parent(root) != DiGraph::npos)))
+                continue ;
+
+            visited[root] = 1u;
+            stack.emplace_back(root, 0u);
+            first[root] = uint32_t(offsets.size() - 1u);
+            while (!stack.empty())
+            {
+                const DiGraph::Index n = stack.back().first;
+                uint32_t& cursor = stack.back().second;
+                DiGraph::Neighbors const children = digraph.neighbors(n);
+
+                // Leaf: rank the bookmark
+                if (children.empty())
+                {
+                    auto const it = bookmarks.find(int(digraph.id(n)));
+                    if (it != bookmarks.end())
+                    {
+                        quote(urls, it->second.uri);
+                        offsets.push_back(uint32_t(urls.size()));
+                    }
+                }
+
+                // Descend into the next child not visited yet
+                while ((cursor < children.size()) && (visited[children[cursor]] != 0u))
+                {
+                    ++cursor;
+                }
+                if (cursor < children.size())
+                {
+                    const DiGraph::Index child = children[cursor++];
+                    visited[child] = 1u;
+                    first[child] = uint32_t(offsets.size() - 1u);
+                    stack.emplace_back(child, 0u);
+                }
+                else
+                {
+                    last[n] = uint32_t(offsets.size() - 1u);
+                    stack.pop_back();
+                }
+            }
+        }
+    }
+
+    own(arrays);
+}
+
+//------------------------------------------------------------------------------
+void SubtreeIndex::quote(std::string& urls, std::string const& url)
+{
+    urls += " '";
+    for (auto const& c: url)
+    {
+        if (c == '\'')
+            urls += "'\\''";
+        else
+            urls += c;
+    }
+    urls += '\'';
+}
+
+//------------------------------------------------------------------------------
+std::string SubtreeIndex::unquote(Slice const& quoted)
+{
+    // Skip the space and the opening quote, drop the closing quote, and
+    // turn each '\'' back into a single quote.
+    std::string url;
+    if (quoted.size() < 3u)
+        return url;
+
+    const char* c = quoted.data() + 2;
+    const char* const end = quoted.data() + quoted.size() - 1u;
+    while (c < end)
+    {
+        if ((*c == '\'') && (end - c >= 4) && (std::string(c, 4u) == "'\\''"))
+        {
+            url += '\'';
+            c += 4;
+        }
+        else
+        {
+            url += *c++;
+        }
+    }
+    return url;
+}
+
+//------------------------------------------------------------------------------
+void SubtreeIndex::own(std::shared_ptr<Arrays> const& arrays)
+{
+    m_size = arrays->kinds.size();
+    m_ranks = arrays->url_offsets.size() - 1u;
+    m_first = arrays->first.data();
+    m_last = arrays->last.data();
+    m_urls = arrays->urls.data();
+    m_url_offsets = arrays->url_offsets.data();
+    m_titles = arrays->titles.data();
+    m_title_offsets = arrays->title_offsets.data();
+    m_kinds = arrays->kinds.data();
+    m_storage = arrays;
+}
@@ -0,0 +1,196 @@
+/* *****************************************************************************
+** MIT License
+**
+** Copyright (c) 2022 Quentin Quadrat
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+********************************************************************************
+*/
+
+#ifndef SUBTREEINDEX_HPP
+#  define SUBTREEINDEX_HPP
+
+#  include "Bookmarks.hpp"
+#  include "Graph.hpp"
+#  include <map>
+#  include <memory>
+#  include <string>
+
+// *****************************************************************************
+//! \brief URLs and titles of the bookmark tree packed once for picking.
+//!
+//! Nodes are numbered by a depth-first traversal of the tree (Euler tour):
+//! the bookmarks below a folder get consecutive ranks, so their URLs are one
+//! contiguous range of a packed buffer. "All URLs under this folder" is then
+//! a slice of this buffer, with the number of bookmarks and the number of
+//! bytes known in advance: no recursion and no allocation per click.
+//!
+//! The traversal marks visited nodes: a node reachable twice (the graph is not
+//! a tree) only belongs to the subtree it was first reached from, and cycles
+//! are visited once.
+//!
+//! As for DiGraph, the packed buffers are shared by the copies of the index
+//! and may be read in place from a memory mapped file (see IslandSnapshot).
+// *****************************************************************************
+class SubtreeIndex
+{
+public:
+
+    // *************************************************************************
+    //! \brief What a node of the graph stands for.
+    // *************************************************************************
+    enum class Kind : uint8_t
+    {
+        //! \brief Neither a folder nor a bookmark (unknown parent).
+        None,
+        Folder,
+        Bookmark
+    };
+
+    // *************************************************************************
+    //! \brief Read-only view on a part of the packed buffers. Valid until the
+    //! next build().
+    // *************************************************************************
+    class Slice
+    {
+    public:
+
+        Slice(const char* data = "", size_t const size = 0u)
+            : m_data(data), m_size(size)
+        {}
+
+        inline const char* data() const { return m_data; }
+        inline size_t size() const { return m_size; }
+        inline bool empty() const { return m_size == 0u; }
+
+    private:
+
+        const char* m_data;
+        size_t m_size;
+    };
+
+    //----------------------------------------------------------------------
+    //! \brief Append a space then the given URL between single quotes, each
+    //! single quote of the URL being written '\''. Nothing in the URL is
+    //! interpreted by a POSIX shell (no $, backquote, double quote, ...).
+    //----------------------------------------------------------------------
+    static void quote(std::string& urls, std::string const& url);
+
+    //----------------------------------------------------------------------
+    //! \brief Return the URL quoted by quote().
+    //----------------------------------------------------------------------
+    static std::string unquote(Slice const& quoted);
+
+    //----------------------------------------------------------------------
+    //! \brief Empty index.
+    //----------------------------------------------------------------------
+    SubtreeIndex()
+    {
+        own(std::make_shared<Arrays>());
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Traverse the graph and pack the URLs and titles of its nodes.
+    //! To be called each time the graph is rebuilt.
+    //----------------------------------------------------------------------
+    void build(DiGraph const& digraph, std::map<int, Bookmark> const& bookmarks,
+               std::map<int, Folder> const& folders);
+
+    //----------------------------------------------------------------------
+    //! \brief Return the URLs of the bookmarks below the given node (the URL
+    //! of the node itself if it is a bookmark), each one preceded by a space
+    //! and quoted for the shell (see quote()): the slice can be appended to
+    //! a command line as it is.
+    //----------------------------------------------------------------------
+    inline Slice urls(DiGraph::Index const node) const
+    {
+        const uint32_t first = m_url_offsets[m_first[node]];
+        return Slice(m_urls + first, m_url_offsets[m_last[node]] - first);
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Return the number of bookmarks below the given node.
+    //----------------------------------------------------------------------
+    inline size_t count(DiGraph::Index const node) const
+    {
+        return m_last[node] - m_first[node];
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Return the title of the bookmark or the folder of the node.
+    //----------------------------------------------------------------------
+    inline Slice title(DiGraph::Index const node) const
+    {
+        const uint32_t first = m_title_offsets[node];
+        return Slice(m_titles + first, m_title_offsets[node + 1u] - first);
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Return whether the node is a folder or a bookmark.
+    //----------------------------------------------------------------------
+    inline Kind kind(DiGraph::Index const node) const
+    {
+        return m_kinds[node];
+    }
+
+private:
+
+    friend class IslandSnapshot;
+
+    // *************************************************************************
+    //! \brief Buffers owned by the index.
+    // *************************************************************************
+    struct Arrays
+    {
+        std::vector<uint32_t> first;
+        std::vector<uint32_t> last;
+        std::string urls;
+        std::vector<uint32_t> url_offsets{ 0u };
+        std::string titles;
+        std::vector<uint32_t> title_offsets{ 0u };
+        std::vector<Kind> kinds;
+    };
+
+    //----------------------------------------------------------------------
+    //! \brief Point to the given owned buffers.
+    //----------------------------------------------------------------------
+    void own(std::shared_ptr<Arrays> const& arrays);
+
+private:
+
+    //! \brief Keep alive the buffers below (Arrays or mapped file).
+    std::shared_ptr<void const> m_storage;
+    //! \brief Number of nodes and of bookmarks ranked.
+    size_t m_size = 0u;
+    size_t m_ranks = 0u;
+    //! \brief Bookmarks below node n have ranks in [m_first[n] m_last[n][.
+    uint32_t const* m_first = nullptr;
+    uint32_t const* m_last = nullptr;
+    //! \brief Quoted URLs of all bookmarks by rank. The URL of rank r is
+    //! m_urls[m_url_offsets[r] .. m_url_offsets[r + 1][.
+    const char* m_urls = nullptr;
+    uint32_t const* m_url_offsets = nullptr;
+    //! \brief Titles of all nodes by index.
+    const char* m_titles = nullptr;
+    uint32_t const* m_title_offsets = nullptr;
+    //! \brief Folder or bookmark, by node index.
+    Kind const* m_kinds = nullptr;
+};
+
+#endif
@@ -0,0 +1,108 @@
+/* *****************************************************************************
+** MIT License
+**
+** Copyright (c) 2022 Quentin Quadrat
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+********************************************************************************
+*/
+
+#ifndef TRIPLEBUFFER_HPP
+#  define TRIPLEBUFFER_HPP
+
+#  include <atomic>
+#  include <cstdint>
+
+// *****************************************************************************
+//! \brief Lock-free triple buffer passing values from a single producer thread
+//! to a single consumer thread. The producer fills the back buffer and
+//! publishes it; the consumer fetches the newest published buffer. Neither of
+//! them ever waits for the other: the producer always has a buffer to write
+//! and the consumer always has a complete buffer to read (possibly the same
+//! than the previous time if nothing new was published).
+//!
+//! The three buffers are swapped by index through a single atomic byte holding
+//! the index of the middle buffer and a flag telling if it holds unread data.
+// *****************************************************************************
+template<class T>
+class TripleBuffer
+{
+public:
+
+    //----------------------------------------------------------------------
+    //! \brief Producer side: buffer to fill before calling publish(). Its
+    //! content is the one of an older buffer: overwrite it entirely.
+    //----------------------------------------------------------------------
+    inline T& back()
+    {
+        return m_buffers[m_back];
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Producer side: make the back buffer the newest one and get
+    //! another buffer to write.
+    //----------------------------------------------------------------------
+    inline void publish()
+    {
+        const uint8_t middle = m_middle.exchange(uint8_t(m_back | DIRTY),
+                                                 std::memory_order_acq_rel);
+        m_back = uint8_t(middle & INDEX);
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Consumer side: take the newest published buffer if any.
+    //! \return true if front() has changed.
+    //----------------------------------------------------------------------
+    inline bool fetch()
+    {
+        if ((m_middle.load(std::memory_order_relaxed) & DIRTY) == 0u)
+            return false;
+
+        const uint8_t middle = m_middle.exchange(m_front, std::memory_order_acq_rel);
+        m_front = uint8_t(middle & INDEX);
+        return true;
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Consumer side: the buffer got from the last fetch(). It stays
+    //! unchanged until the next call to fetch().
+    //----------------------------------------------------------------------
+    inline T const& front() const
+    {
+        return m_buffers[m_front];
+    }
+
+private:
+
+    //! \brief Mask of the buffer index.
+    static constexpr uint8_t INDEX = 0x03u;
+    //! \brief Flag set when the middle buffer has not yet been read.
+    static constexpr uint8_t DIRTY = 0x04u;
+
+    //! \brief The three buffers.
+    T m_buffers[3];
+    //! \brief Index (and dirty flag) of the buffer exchanged between threads.
+    std::atomic<uint8_t> m_middle{1u};
+    //! \brief Index of the buffer owned by the producer.
+    uint8_t m_back = 0u;
+    //! \brief Index of the buffer owned by the consumer.
+    uint8_t m_front = 2u;
+};
+
+#endif
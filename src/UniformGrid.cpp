@@ -0,0 +1,104 @@
+/* *****************************************************************************
+** MIT License
+**
+** Copyright (c) 2022 Quentin Quadrat
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+********************************************************************************
+*/
+
+#include "UniformGrid.hpp"
+#include <cmath>
+
+//------------------------------------------------------------------------------
+template<size_t D>
+void UniformGrid<D>::reset(size_t const count, Vector const& min,
+                           Vector const& max, float const size)
+{
+    // Limit the number of cells in case of tiny size
+    float extent = 0.0f;
+    for (size_t i = 0u; i < D; ++i)
+    {
+        extent = std::max(extent, coordinate(max, i) - coordinate(min, i));
+    }
+    const float cell_size = std::max(size, extent / float(MAX_CELLS));
+
+    m_min = min;
+    m_inv_size = 1.0f / std::max(cell_size, 1e-6f);
+    for (size_t i = 0u; i < D; ++i)
+    {
+        m_cells[i] = std::max(1, int32_t(std::ceil((coordinate(max, i) - coordinate(min, i)) * m_inv_size)));
+    }
+    m_cell_of.resize(count);
+    m_sorted.resize(count);
+    m_start.resize(cells() + 1u);
+}
+
+//------------------------------------------------------------------------------
+template<size_t D>
+void UniformGrid<D>::sort()
+{
+    const size_t count = m_cell_of.size();
+    const size_t ncells = cells();
+    m_histograms.assign(size_t(omp_get_max_threads()) * ncells, 0u);
+
+    #pragma omp parallel default(shared)
+    {
+        const size_t threads = size_t(omp_get_num_threads());
+        const size_t thread = size_t(omp_get_thread_num());
+        const size_t begin = count * thread / threads;
+        const size_t end = count * (thread + 1u) / threads;
+        uint32_t* histogram = &m_histograms[thread * ncells];
+
+        // Pass 1: count vertices of the chunk per cell
+        for (size_t i = begin; i < end; ++i)
+        {
+            ++histogram[m_cell_of[i]];
+        }
+
+        #pragma omp barrier
+
+        // Prefix sum: cell by cell then thread by thread, so that each thread
+        // gets its own contiguous range inside each cell.
+        #pragma omp single
+        {
+            uint32_t offset = 0u;
+            for (size_t c = 0u; c < ncells; ++c)
+            {
+                m_start[c] = offset;
+                for (size_t t = 0u; t < threads; ++t)
+                {
+                    const uint32_t n = m_histograms[t * ncells + c];
+                    m_histograms[t * ncells + c] = offset;
+                    offset += n;
+                }
+            }
+            m_start[ncells] = offset;
+        }
+
+        // Pass 2: scatter vertices of the chunk into their cell
+        for (size_t i = begin; i < end; ++i)
+        {
+            m_sorted[histogram[m_cell_of[i]]++] = uint32_t(i);
+        }
+    }
+}
+
+template class UniformGrid<2u>;
+template class UniformGrid<3u>;
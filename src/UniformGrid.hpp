@@ -0,0 +1,201 @@
+/* *****************************************************************************
+** MIT License
+**
+** Copyright (c) 2022 Quentin Quadrat
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+********************************************************************************
+*/
+
+#ifndef UNIFORMGRID_HPP
+#  define UNIFORMGRID_HPP
+
+#  include "Vector.hpp"
+#  include <vector>
+#  include <cstdint>
+#  include <algorithm>
+#  include <omp.h>
+
+// *****************************************************************************
+//! \brief Uniform grid (also named cell list) binning vertices into square
+//! cells. Vertices of a cell are stored contiguously so that only pairs of
+//! vertices in neighboring cells are visited: with a cell size equal to the
+//! cutoff distance of a force, computing it costs O(N) instead of O(N^2).
+//!
+//! The grid is rebuilt at each step by a parallel counting sort: each thread
+//! counts the vertices of its chunk per cell, a prefix sum gives where each
+//! thread writes in each cell, then each thread scatters its chunk. The order
+//! of vertices inside a cell is therefore the same whatever the scheduling.
+//!
+//! The grid is written for any dimension D: the neighborhood of a cell is
+//! made of the 3^D cells around it (3x3 in 2D, 3x3x3 in 3D).
+// *****************************************************************************
+template<size_t D>
+class UniformGrid
+{
+public:
+
+    //! \brief Position in the space.
+    using Vector = typename Space<D>::Vector;
+
+    //----------------------------------------------------------------------
+    //! \brief Bin vertices into cells.
+    //! \param[in] count number of vertices.
+    //! \param[in] min lowest corner of the bounding box of the vertices.
+    //! \param[in] max highest corner of the bounding box of the vertices.
+    //! \param[in] size dimension of cells.
+    //! \param[in] position functor position(i) returning the position of the
+    //! i-th vertex.
+    //----------------------------------------------------------------------
+    template<class Position>
+    void build(size_t const count, Vector const& min, Vector const& max,
+               float const size, Position const& position)
+    {
+        reset(count, min, max, size);
+
+        // Cell of each vertex
+        #pragma omp parallel for default(shared) schedule(static)
+        for (size_t i = 0u; i < count; ++i)
+        {
+            m_cell_of[i] = cell(position(i));
+        }
+
+        sort();
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Call visit(j) for each vertex j in the 3^D cells around the
+    //! given position (including the vertex itself if it is in the grid).
+    //----------------------------------------------------------------------
+    template<class Visitor>
+    void neighbors(Vector const& position, Visitor const& visit) const
+    {
+        // Range of neighboring cells along each axis, clipped to the grid
+        int32_t first[D], last[D], c[D];
+        for (size_t i = 0u; i < D; ++i)
+        {
+            const int32_t center = axis(coordinate(position, i), i);
+            first[i] = std::max(0, center - 1);
+            last[i] = std::min(m_cells[i] - 1, center + 1);
+            c[i] = first[i];
+        }
+
+        // Odometer over the range, the first axis varying the fastest
+        while (true)
+        {
+            const size_t k = linear(c);
+            for (uint32_t j = m_start[k]; j < m_start[k + 1u]; ++j)
+            {
+                visit(size_t(m_sorted[j]));
+            }
+
+            size_t i = 0u;
+            while ((i < D) && (++c[i] > last[i]))
+            {
+                c[i] = first[i];
+                ++i;
+            }
+            if (i == D)
+                break ;
+        }
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Return the number of cells.
+    //----------------------------------------------------------------------
+    inline size_t cells() const
+    {
+        size_t count = 1u;
+        for (size_t i = 0u; i < D; ++i)
+        {
+            count *= size_t(m_cells[i]);
+        }
+        return count;
+    }
+
+private:
+
+    //----------------------------------------------------------------------
+    //! \brief Allocate cells covering the bounding box.
+    //----------------------------------------------------------------------
+    void reset(size_t const count, Vector const& min, Vector const& max,
+               float const size);
+
+    //----------------------------------------------------------------------
+    //! \brief Parallel counting sort of vertices by cells.
+    //----------------------------------------------------------------------
+    void sort();
+
+    //----------------------------------------------------------------------
+    //! \brief Index of the cell along the given axis.
+    //----------------------------------------------------------------------
+    inline int32_t axis(float const x, size_t const i) const
+    {
+        return std::min(m_cells[i] - 1,
+                        std::max(0, int32_t((x - coordinate(m_min, i)) * m_inv_size)));
+    }
+
+    //----------------------------------------------------------------------
+    //! \brief Index of the cell from its indices along each axis.
+    //----------------------------------------------------------------------
+    inline size_t linear(int32_t const (&c)[D]) const
+    {
+        size_t k = size_t(c[D - 1u]);
+        for (size_t i = D - 1u; i-- > 0u; )
+        {
+            k = k * size_t(m_cells[i]) + size_t(c[i]);
+        }
+        return k;
+    }
+
+    inline uint32_t cell(Vector const& p) const
+    {
+        int32_t c[D];
+        for (size_t i = 0u; i < D; ++i)
+        {
+            c[i] = axis(coordinate(p, i), i);
+        }
+        return uint32_t(linear(c));
+    }
+
+private:
+
+    //! \brief Maximum number of cells along an axis, limiting the memory in
+    //! case of tiny cells.
+    static constexpr int32_t MAX_CELLS = (D == 2u) ? 4096 : 256;
+
+    //! \brief Lowest corner of the grid.
+    Vector m_min;
+    //! \brief Inverse of the dimension of cells.
+    float m_inv_size = 1.0f;
+    //! \brief Number of cells along each axis.
+    int32_t m_cells[D] = {};
+    //! \brief Cell of each vertex.
+    std::vector<uint32_t> m_cell_of;
+    //! \brief Vertices sorted by cells.
+    std::vector<uint32_t> m_sorted;
+    //! \brief Index in m_sorted of the first vertex of each cell. One more
+    //! element to hold the end of the last cell.
+    std::vector<uint32_t> m_start;
+    //! \brief Per thread number of vertices in each cell (then per thread
+    //! write position in each cell).
+    std::vector<uint32_t> m_histograms;
+};
+
+#endif
@@ -0,0 +1,126 @@
+/* *****************************************************************************
+** MIT License
+**
+** Copyright (c) 2022 Quentin Quadrat
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+********************************************************************************
+*/
+
+#ifndef VECTOR_HPP
+#  define VECTOR_HPP
+
+#  include <SFML/System/Vector2.hpp>
+#  include <SFML/System/Vector3.hpp>
+#  include <algorithm>
+#  include <cstddef>
+
+// *****************************************************************************
+//! \brief Vector type of the space of the given dimension, so that algorithms
+//! can be written once for 2D and 3D layouts. Algorithms loop over coordinates
+//! with coordinate(); for a fixed dimension these loops are unrolled by the
+//! compiler and cost the same than hand written .x and .y accesses.
+// *****************************************************************************
+template<size_t D>
+struct Space;
+
+template<>
+struct Space<2u>
+{
+    using Vector = sf::Vector2f;
+
+    //! \brief Vector with all coordinates set to the given value.
+    static inline Vector splat(float const value)
+    {
+        return { value, value };
+    }
+};
+
+template<>
+struct Space<3u>
+{
+    using Vector = sf::Vector3f;
+
+    //! \brief Vector with all coordinates set to the given value.
+    static inline Vector splat(float const value)
+    {
+        return { value, value, value };
+    }
+};
+
+//------------------------------------------------------------------------------
+//! \brief Access to the i-th coordinate.
+//------------------------------------------------------------------------------
+inline float& coordinate(sf::Vector2f& v, size_t const i)
+{
+    return (i == 0u) ? v.x : v.y;
+}
+
+inline float coordinate(sf::Vector2f const& v, size_t const i)
+{
+    return (i == 0u) ? v.x : v.y;
+}
+
+inline float& coordinate(sf::Vector3f& v, size_t const i)
+{
+    return (i == 0u) ? v.x : ((i == 1u) ? v.y : v.z);
+}
+
+inline float coordinate(sf::Vector3f const& v, size_t const i)
+{
+    return (i == 0u) ? v.x : ((i == 1u) ? v.y : v.z);
+}
+
+//------------------------------------------------------------------------------
+//! \brief Dot product.
+//------------------------------------------------------------------------------
+inline float dot(sf::Vector2f const& a, sf::Vector2f const& b)
+{
+    return a.x * b.x + a.y * b.y;
+}
+
+inline float dot(sf::Vector3f const& a, sf::Vector3f const& b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+//------------------------------------------------------------------------------
+//! \brief Coordinate-wise minimum and maximum.
+//------------------------------------------------------------------------------
+inline sf::Vector2f lower(sf::Vector2f const& a, sf::Vector2f const& b)
+{
+    return { std::min(a.x, b.x), std::min(a.y, b.y) };
+}
+
+inline sf::Vector3f lower(sf::Vector3f const& a, sf::Vector3f const& b)
+{
+    return { std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z) };
+}
+
+inline sf::Vector2f upper(sf::Vector2f const& a, sf::Vector2f const& b)
+{
+    return { std::max(a.x, b.x), std::max(a.y, b.y) };
+}
+
+inline sf::Vector3f upper(sf::Vector3f const& a, sf::Vector3f const& b)
+{
+    return { std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z) };
+}
+
+#endif
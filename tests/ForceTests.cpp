@@ -0,0 +1,353 @@
+/* *****************************************************************************
+** MIT License
+**
+** Copyright (c) 2022 Quentin Quadrat
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+********************************************************************************
+*/
+
+#include "ForceDirectedGraph.hpp"
+#include "QuadTree.hpp"
+#include "SoALayout.hpp"
+#include "Trees.hpp"
+#include <gtest/gtest.h>
+#include <random>
+#include <cmath>
+
+// *****************************************************************************
+//! \brief Random vertices and their repulsive forces c * mj * (pi - pj) /
+//! |pi - pj|^2 computed by the scalar kernel of SoALayout, the reference of
+//! the other kernels.
+// *****************************************************************************
+template<size_t D>
+struct Forces
+{
+    using Vector = typename Space<D>::Vector;
+
+    //! \brief Repulsion coefficient.
+    static constexpr float C = 100.0f;
+
+    Forces(size_t const count)
+    {
+        std::mt19937 generator(42u);
+        std::uniform_real_distribution<float> coordinate(0.0f, 1000.0f);
+        std::uniform_real_distribution<float> mass(1.0f, 4.0f);
+        soa.resize(count, D);
+        for (size_t i = 0u; i < count; ++i)
+        {
+            soa.x[i] = coordinate(generator);
+            soa.y[i] = coordinate(generator);
+            if (D > 2u)
+                soa.z[i] = coordinate(generator);
+            soa.mass[i] = mass(generator);
+        }
+
+        // Sum of the magnitudes of the forces applied on each vertex: the
+        // scale of the rounding errors of the sum.
+        magnitudes.resize(count);
+        for (size_t i = 0u; i < count; ++i)
+        {
+            double sum = 0.0;
+            for (size_t j = 0u; j < count; ++j)
+            {
+                if (j != i)
+                    sum += double(C * soa.mass[j]) / double(norm(position(i) - position(j)));
+            }
+            magnitudes[i] = float(sum);
+        }
+
+        reference = repulsion(SoALayout::ISA::Scalar);
+    }
+
+    //! \brief Euclidean norm.
+    static float norm(Vector const& v)
+    {
+        return std::sqrt(dot(v, v));
+    }
+
+    //! \brief Position of the i-th vertex.
+    Vector position(size_t const i) const
+    {
+        Vector p = Space<D>::splat(0.0f);
+        coordinate(p, 0u) = soa.x[i];
+        coordinate(p, 1u) = soa.y[i];
+        if (D > 2u)
+            coordinate(p, 2u) = soa.z[i];
+        return p;
+    }
+
+    //! \brief Displacement of the i-th vertex.
+    Vector displacement(size_t const i) const
+    {
+        Vector d = Space<D>::splat(0.0f);
+        coordinate(d, 0u) = soa.dx[i];
+        coordinate(d, 1u) = soa.dy[i];
+        if (D > 2u)
+            coordinate(d, 2u) = soa.dz[i];
+        return d;
+    }
+
+    //! \brief Forces computed by the SoA kernel for the given instruction
+    //! set (or the best one available).
+    std::vector<Vector> repulsion(SoALayout::ISA const set)
+    {
+        soa.isa(set);
+        std::fill(soa.dx.begin(), soa.dx.end(), 0.0f);
+        std::fill(soa.dy.begin(), soa.dy.end(), 0.0f);
+        std::fill(soa.dz.begin(), soa.dz.end(), 0.0f);
+        soa.repulsion(C);
+
+        std::vector<Vector> forces(soa.size());
+        for (size_t i = 0u; i < soa.size(); ++i)
+        {
+            forces[i] = displacement(i);
+        }
+        return forces;
+    }
+
+    //! \brief Forces approximated by Barnes-Hut.
+    std::vector<Vector> barnes_hut(float const theta) const
+    {
+        Vector min = position(0u), max = position(0u);
+        for (size_t i = 0u; i < soa.size(); ++i)
+        {
+            min = lower(min, position(i));
+            max = upper(max, position(i));
+        }
+        Orthtree<D> tree;
+        tree.reset(min, max);
+        for (size_t i = 0u; i < soa.size(); ++i)
+        {
+            tree.insert(position(i), soa.mass[i]);
+        }
+        tree.finalize();
+
+        auto const force = [](Vector const& direction, float const mass)
+        {
+            return direction * (C * mass / std::max(1e-6f, dot(direction, direction)));
+        };
+        std::vector<Vector> forces(soa.size());
+        for (size_t i = 0u; i < soa.size(); ++i)
+        {
+            forces[i] = tree.accumulate(position(i), theta, force);
+        }
+        return forces;
+    }
+
+    //! \brief Largest error against the scalar kernel, relative to the sum
+    //! of the magnitudes of the forces applied on the vertex.
+    float error(std::vector<Vector> const& forces) const
+    {
+        float largest = 0.0f;
+        for (size_t i = 0u; i < soa.size(); ++i)
+        {
+            largest = std::max(largest, norm(forces[i] - reference[i]) / magnitudes[i]);
+        }
+        return largest;
+    }
+
+    SoALayout soa;
+    std::vector<float> magnitudes;
+    std::vector<Vector> reference;
+};
+
+template<size_t D>
+constexpr float Forces<D>::C;
+
+//! \brief Relative error documented in SoALayout.hpp.
+static constexpr float TOLERANCE = 1e-5f;
+
+//------------------------------------------------------------------------------
+//! \brief The vectorized kernels match the scalar one within the tolerance
+//! documented in SoALayout.hpp.
+//------------------------------------------------------------------------------
+template<size_t D>
+static void simd(size_t const count)
+{
+    Forces<D> forces(count);
+    for (auto const set: { SoALayout::ISA::SSE2, SoALayout::ISA::AVX2 })
+    {
+        std::vector<typename Forces<D>::Vector> const f = forces.repulsion(set);
+        EXPECT_LT(forces.error(f), TOLERANCE) << SoALayout::name(forces.soa.isa());
+    }
+}
+
+//------------------------------------------------------------------------------
+//! \brief Only the displacements of the targets are updated, by all vertices.
+//------------------------------------------------------------------------------
+template<size_t D>
+static void targets(size_t const count)
+{
+    Forces<D> forces(count);
+    std::vector<uint32_t> targets;
+    for (uint32_t i = 0u; i < count; i += 3u)
+    {
+        targets.push_back(i);
+    }
+    std::fill(forces.soa.dx.begin(), forces.soa.dx.end(), 0.0f);
+    std::fill(forces.soa.dy.begin(), forces.soa.dy.end(), 0.0f);
+    std::fill(forces.soa.dz.begin(), forces.soa.dz.end(), 0.0f);
+    forces.soa.isa(SoALayout::detect());
+    forces.soa.repulsion(Forces<D>::C, targets);
+
+    for (size_t i = 0u; i < count; ++i)
+    {
+        const float error = Forces<D>::norm(forces.displacement(i) - forces.reference[i]);
+        if (i % 3u == 0u)
+        {
+            EXPECT_LT(error / forces.magnitudes[i], TOLERANCE);
+        }
+        else
+        {
+            EXPECT_EQ(Forces<D>::norm(forces.displacement(i)), 0.0f);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+//! \brief Barnes-Hut with a null opening angle is the exact sum, and stays
+//! close to it with the default angle.
+//------------------------------------------------------------------------------
+template<size_t D>
+static void barnes_hut(size_t const count)
+{
+    Forces<D> forces(count);
+    EXPECT_LT(forces.error(forces.barnes_hut(0.0f)), TOLERANCE);
+    EXPECT_LT(forces.error(forces.barnes_hut(0.8f)), 5e-2f);
+}
+
+//------------------------------------------------------------------------------
+TEST(Forces, SIMD2D)
+{
+    simd<2u>(2003u);
+}
+
+//------------------------------------------------------------------------------
+TEST(Forces, SIMD3D)
+{
+    simd<3u>(2003u);
+}
+
+//------------------------------------------------------------------------------
+TEST(Forces, Targets2D)
+{
+    targets<2u>(2003u);
+}
+
+//------------------------------------------------------------------------------
+TEST(Forces, Targets3D)
+{
+    targets<3u>(2003u);
+}
+
+//------------------------------------------------------------------------------
+TEST(Forces, BarnesHut2D)
+{
+    barnes_hut<2u>(2003u);
+}
+
+//------------------------------------------------------------------------------
+TEST(Forces, BarnesHut3D)
+{
+    barnes_hut<3u>(2003u);
+}
+
+//------------------------------------------------------------------------------
+//! \brief Positions after one step of a layout where only the vertices near
+//! a few new nodes are active, with the given repulsion mode.
+//------------------------------------------------------------------------------
+static ForceDirectedGraph::Placements partial(DiGraph const& graph, ForceDirectedGraph::Repulsion const mode,
+                                              size_t& active)
+{
+    const sf::Vector2f dimension(WINDOWS_WIDTH, WINDOWS_HEIGHT);
+    ForceDirectedGraph layout(dimension, graph);
+    layout.reset();
+    for (size_t s = 0u; s < 20u; ++s)
+    {
+        layout.update();
+    }
+
+    // Every 50th node is new
+    ForceDirectedGraph::Placements previous;
+    ForceDirectedGraph::Placements const placements = layout.placements();
+    for (size_t i = 0u; i < placements.size(); ++i)
+    {
+        if (i % 50u != 0u)
+            previous.push_back(placements[i]);
+    }
+
+    layout.repulsion(mode);
+    layout.incremental(previous, 0u, 1u);
+    active = layout.active();
+    layout.update();
+    return layout.placements();
+}
+
+//------------------------------------------------------------------------------
+TEST(Forces, ExactActiveSubset)
+{
+    DiGraph const graph = tree(Corpus::Shape::Balanced, 1500u);
+    size_t active, reference;
+    ForceDirectedGraph::Placements const exact = partial(graph, ForceDirectedGraph::Repulsion::Exact, active);
+    ForceDirectedGraph::Placements const simd = partial(graph, ForceDirectedGraph::Repulsion::SIMD, reference);
+    ASSERT_EQ(active, reference);
+    ASSERT_GT(active, 0u);
+    ASSERT_LT(active, graph.size());
+    ASSERT_EQ(exact.size(), simd.size());
+    for (size_t i = 0u; i < exact.size(); ++i)
+    {
+        EXPECT_NEAR(exact[i].position.x, simd[i].position.x, 1e-2f);
+        EXPECT_NEAR(exact[i].position.y, simd[i].position.y, 1e-2f);
+    }
+}
+
+//------------------------------------------------------------------------------
+//! \brief Lay out the given graph with leaves on fans and return the
+//! positions.
+//------------------------------------------------------------------------------
+static ForceDirectedGraph::Placements fans(DiGraph const& graph)
+{
+    ForceDirectedGraph layout(sf::Vector2f(WINDOWS_WIDTH, WINDOWS_HEIGHT), graph);
+    layout.leaves(ForceDirectedGraph::Leaves::Fans);
+    layout.reset();
+    layout.update();
+    return layout.placements();
+}
+
+//------------------------------------------------------------------------------
+TEST(Forces, FansOfNonTree)
+{
+    // Leaf 3 has two folders
+    DiGraphBuilder shared;
+    shared.add_edge(0u, 1u);
+    shared.add_edge(0u, 2u);
+    shared.add_edge(1u, 3u);
+    shared.add_edge(2u, 3u);
+    shared.add_edge(2u, 4u);
+    EXPECT_EQ(fans(shared.build()).size(), 5u);
+
+    // Leaf 3 is added twice in folder 1
+    DiGraphBuilder duplicated;
+    duplicated.add_edge(0u, 1u);
+    duplicated.add_edge(1u, 3u);
+    duplicated.add_edge(1u, 3u);
+    duplicated.add_edge(1u, 4u);
+    EXPECT_EQ(fans(duplicated.build()).size(), 4u);
+}
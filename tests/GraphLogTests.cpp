@@ -0,0 +1,177 @@
+/* *****************************************************************************
+** MIT License
+**
+** Copyright (c) 2022 Quentin Quadrat
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+********************************************************************************
+*/
+#include "Graph.hpp"
+#include <gtest/gtest.h>
+
+//------------------------------------------------------------------------------
+//! \brief Commit a batch of renames of the given nodes.
+//------------------------------------------------------------------------------
+static uint64_t commit(DiGraphLog& log, std::vector<DiGraph::Node> const& nodes)
+{
+    for (auto const node: nodes)
+    {
+        log.rename(node);
+    }
+    return log.commit();
+}
+
+//------------------------------------------------------------------------------
+//! \brief Nodes of the given changes, oldest first.
+//------------------------------------------------------------------------------
+static std::vector<DiGraph::Node> nodes(DiGraphLog::Changes const& changes)
+{
+    std::vector<DiGraph::Node> result;
+    for (auto const& change: changes)
+    {
+        result.push_back(change.node);
+    }
+    return result;
+}
+
+//------------------------------------------------------------------------------
+TEST(GraphLog, Empty)
+{
+    DiGraphLog log(8u);
+    EXPECT_EQ(log.epoch(), 0u);
+    EXPECT_TRUE(log.complete(0u));
+    EXPECT_TRUE(log.changes(0u).empty());
+
+    // Nothing pending: no new epoch
+    EXPECT_EQ(log.commit(), 0u);
+    EXPECT_TRUE(log.changes(0u).empty());
+
+    // Up to date, or ahead of the log
+    EXPECT_EQ(commit(log, { 1u, 2u }), 1u);
+    EXPECT_EQ(log.commit(), 1u);
+    EXPECT_TRUE(log.changes(1u).empty());
+    EXPECT_TRUE(log.changes(2u).empty());
+}
+
+//------------------------------------------------------------------------------
+TEST(GraphLog, Since)
+{
+    DiGraphLog log(64u);
+    log.add(1u, 0u);
+    EXPECT_EQ(log.commit(), 1u);
+    log.move(2u, 1u);
+    log.remove(3u);
+    EXPECT_EQ(log.commit(), 2u);
+    EXPECT_EQ(commit(log, { 4u, 5u, 6u }), 3u);
+
+    EXPECT_EQ(nodes(log.changes(0u)), std::vector<DiGraph::Node>({ 1u, 2u, 3u, 4u, 5u, 6u }));
+    EXPECT_EQ(nodes(log.changes(1u)), std::vector<DiGraph::Node>({ 2u, 3u, 4u, 5u, 6u }));
+    EXPECT_EQ(nodes(log.changes(2u)), std::vector<DiGraph::Node>({ 4u, 5u, 6u }));
+    EXPECT_TRUE(log.changes(3u).empty());
+
+    // Epochs and kinds of the changes
+    DiGraphLog::Changes const changes = log.changes(1u);
+    EXPECT_EQ(changes.begin()[0].epoch, 2u);
+    EXPECT_EQ(changes.begin()[0].kind, DiGraphLog::Kind::Move);
+    EXPECT_EQ(changes.begin()[0].parent, 1u);
+    EXPECT_EQ(changes.begin()[1].epoch, 2u);
+    EXPECT_EQ(changes.begin()[1].kind, DiGraphLog::Kind::Remove);
+    EXPECT_EQ(changes.begin()[2].epoch, 3u);
+    EXPECT_EQ(changes.begin()[2].kind, DiGraphLog::Kind::Rename);
+
+    // Pending changes are not returned until committed
+    log.rename(7u);
+    EXPECT_EQ(log.epoch(), 3u);
+    EXPECT_EQ(log.changes(0u).size(), 6u);
+    EXPECT_TRUE(log.changes(3u).empty());
+    EXPECT_EQ(log.commit(), 4u);
+    EXPECT_EQ(nodes(log.changes(3u)), std::vector<DiGraph::Node>({ 7u }));
+}
+
+//------------------------------------------------------------------------------
+TEST(GraphLog, Trimmed)
+{
+    // Epochs of three changes: the third exceeds the capacity. Down to half
+    // the capacity, the second epoch would be split: it is dropped whole.
+    DiGraphLog log(8u);
+    EXPECT_EQ(commit(log, { 1u, 2u, 3u }), 1u);
+    EXPECT_EQ(commit(log, { 4u, 5u, 6u }), 2u);
+    EXPECT_TRUE(log.complete(0u));
+    EXPECT_EQ(log.changes(0u).size(), 6u);
+
+    EXPECT_EQ(commit(log, { 7u, 8u, 9u }), 3u);
+    EXPECT_FALSE(log.complete(0u));
+    EXPECT_FALSE(log.complete(1u));
+    EXPECT_TRUE(log.complete(2u));
+    EXPECT_TRUE(log.complete(3u));
+    EXPECT_EQ(nodes(log.changes(0u)), std::vector<DiGraph::Node>({ 7u, 8u, 9u }));
+    EXPECT_EQ(nodes(log.changes(2u)), std::vector<DiGraph::Node>({ 7u, 8u, 9u }));
+
+    // Not trimmed again until the capacity is exceeded
+    EXPECT_EQ(commit(log, { 10u, 11u }), 4u);
+    EXPECT_EQ(commit(log, { 12u, 13u, 14u }), 5u);
+    EXPECT_TRUE(log.complete(2u));
+    EXPECT_EQ(log.changes(2u).size(), 8u);
+    // Half the capacity starts with the fifth epoch: the fourth is dropped
+    EXPECT_EQ(commit(log, { 15u }), 6u);
+    EXPECT_FALSE(log.complete(2u));
+    EXPECT_FALSE(log.complete(3u));
+    EXPECT_TRUE(log.complete(4u));
+    EXPECT_EQ(nodes(log.changes(4u)), std::vector<DiGraph::Node>({ 12u, 13u, 14u, 15u }));
+}
+
+//------------------------------------------------------------------------------
+TEST(GraphLog, EpochLargerThanCapacity)
+{
+    DiGraphLog log(4u);
+    EXPECT_EQ(commit(log, { 1u }), 1u);
+    EXPECT_EQ(commit(log, { 2u, 3u, 4u, 5u, 6u, 7u }), 2u);
+
+    // The last epoch is kept whole, the previous ones are dropped
+    EXPECT_FALSE(log.complete(0u));
+    EXPECT_TRUE(log.complete(1u));
+    EXPECT_EQ(nodes(log.changes(1u)), std::vector<DiGraph::Node>({ 2u, 3u, 4u, 5u, 6u, 7u }));
+
+    // Then dropped at the next commit
+    EXPECT_EQ(commit(log, { 8u }), 3u);
+    EXPECT_FALSE(log.complete(1u));
+    EXPECT_TRUE(log.complete(2u));
+    EXPECT_EQ(nodes(log.changes(2u)), std::vector<DiGraph::Node>({ 8u }));
+}
+
+//------------------------------------------------------------------------------
+TEST(GraphLog, FallenBehind)
+{
+    // A consumer reading the log after each commit always finds the changes
+    // it missed, while another one stuck at the first epoch shall rebuild.
+    DiGraphLog log(4u);
+    const uint64_t behind = commit(log, { 0u });
+    uint64_t up_to_date = behind;
+    for (DiGraph::Node node = 1u; node < 20u; ++node)
+    {
+        EXPECT_EQ(commit(log, { node }), node + 1u);
+        ASSERT_TRUE(log.complete(up_to_date));
+        EXPECT_EQ(nodes(log.changes(up_to_date)), std::vector<DiGraph::Node>({ node }));
+        up_to_date = log.epoch();
+    }
+    EXPECT_FALSE(log.complete(behind));
+    EXPECT_LE(log.changes(behind).size(), 4u);
+    EXPECT_TRUE(log.complete(up_to_date));
+    EXPECT_TRUE(log.changes(up_to_date).empty());
+}
@@ -0,0 +1,96 @@
+/* *****************************************************************************
+** MIT License
+**
+** Copyright (c) 2022 Quentin Quadrat
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+********************************************************************************
+*/
+
+#include "LayoutCache.hpp"
+#include <gtest/gtest.h>
+#include <cstdio>
+
+//------------------------------------------------------------------------------
+//! \brief Chain of nodes first to last - 1.
+//------------------------------------------------------------------------------
+static DiGraph chain(size_t const first, size_t const last)
+{
+    DiGraphBuilder builder;
+    builder.add_node(first);
+    for (size_t n = first + 1u; n < last; ++n)
+    {
+        builder.add_edge(n - 1u, n);
+    }
+    return builder.build();
+}
+
+//------------------------------------------------------------------------------
+//! \brief Save the layout of nodes 0 to 99 and load it for the given graph.
+//------------------------------------------------------------------------------
+static LayoutCache::Match reload(DiGraph const& graph, ForceDirectedGraph::Placements& placements)
+{
+    const sf::Vector2f dimension(WINDOWS_WIDTH, WINDOWS_HEIGHT);
+    DiGraph const saved = chain(0u, 100u);
+    ForceDirectedGraph::Placements layout;
+    for (size_t n = 0u; n < 100u; ++n)
+    {
+        layout.push_back({ n, sf::Vector2f(float(10u + n), 100.0f), 2u });
+    }
+
+    const std::string path = testing::TempDir() + "layout.cache";
+    LayoutCache cache(path);
+    EXPECT_TRUE(cache.save(saved, dimension, layout));
+    const LayoutCache::Match match = cache.load(graph, dimension, placements);
+    std::remove(path.c_str());
+    return match;
+}
+
+//------------------------------------------------------------------------------
+TEST(LayoutCache, Exact)
+{
+    ForceDirectedGraph::Placements placements;
+    EXPECT_EQ(reload(chain(0u, 100u), placements), LayoutCache::Match::Exact);
+    EXPECT_EQ(placements.size(), 100u);
+}
+
+//------------------------------------------------------------------------------
+//! \brief Half of the nodes in common (relative to the larger graph) is
+//! still a warm start.
+//------------------------------------------------------------------------------
+TEST(LayoutCache, Near)
+{
+    ForceDirectedGraph::Placements placements;
+    EXPECT_EQ(reload(chain(0u, 120u), placements), LayoutCache::Match::Near);
+    EXPECT_EQ(reload(chain(50u, 150u), placements), LayoutCache::Match::Near);
+    EXPECT_EQ(reload(chain(0u, 200u), placements), LayoutCache::Match::Near);
+    EXPECT_EQ(placements.size(), 100u);
+}
+
+//------------------------------------------------------------------------------
+//! \brief Less than half of the nodes in common: the saved layout is ignored.
+//------------------------------------------------------------------------------
+TEST(LayoutCache, None)
+{
+    ForceDirectedGraph::Placements placements;
+    EXPECT_EQ(reload(chain(51u, 151u), placements), LayoutCache::Match::None);
+    EXPECT_TRUE(placements.empty());
+    EXPECT_EQ(reload(chain(0u, 201u), placements), LayoutCache::Match::None);
+    EXPECT_EQ(reload(chain(1000u, 1100u), placements), LayoutCache::Match::None);
+}
@@ -0,0 +1,168 @@
+/* *****************************************************************************
+** MIT License
+**
+** Copyright (c) 2022 Quentin Quadrat
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+********************************************************************************
+*/
+
+#include "BookmarkLoader.hpp"
+#include <gtest/gtest.h>
+#include <cstring>
+
+//------------------------------------------------------------------------------
+//! \brief Small export: the root holds a folder with a bookmark, a
+//! separator and a bookmark. Members unknown to the loader are skipped.
+//------------------------------------------------------------------------------
+static const char* EXPORT = R"({"guid":"root________","title":"","index":0,"id":1,
+"annos":[{"name":"x","value":"]}{[\"","flags":0}],"typeCode":2,"root":"placesRoot",
+"children":[
+  {"id":2,"title":"Folder","dateAdded":1600000000000,"readonly":true,"children":[
+    {"id":3,"title":"Mozilla","uri":"https://www.mozilla.org/","tags":null}]},
+  {"id":4,"title":"","type":"text/x-moz-place-separator","typeCode":3},
+  {"id":5,"title":"Search","uri":"https://duckduckgo.com/?q=%s","keyword":"d",
+   "postData":null,"charset":{"nested":[1,[2,{"three":3}]]}}]})";
+
+//------------------------------------------------------------------------------
+//! \brief Parse the given text, which shall be a JSON object holding one
+//! bookmark (id 2 in Firefox) below the root, and return its title or URI.
+//------------------------------------------------------------------------------
+static std::string bookmark(std::string const& members, bool const uri = false)
+{
+    const std::string text = R"({"id":1,"children":[{"id":2,)" + members + "}]}";
+    std::map<int, Bookmark> bookmarks;
+    std::map<int, Folder> folders;
+    BookmarkLoader loader;
+    EXPECT_TRUE(loader.parse(text.data(), text.size(), bookmarks, folders)) << loader.error();
+    auto const it = bookmarks.find(1);
+    if (it == bookmarks.end())
+        return "<none>";
+    return uri ? it->second.uri : it->second.title;
+}
+
+//------------------------------------------------------------------------------
+TEST(Loader, Export)
+{
+    std::map<int, Bookmark> bookmarks;
+    std::map<int, Folder> folders;
+    BookmarkLoader loader;
+    ASSERT_TRUE(loader.parse(EXPORT, strlen(EXPORT), bookmarks, folders)) << loader.error();
+
+    // Identifiers are Firefox ones minus one, the root being its own parent
+    ASSERT_EQ(folders.size(), 2u);
+    EXPECT_EQ(folders[0].id, 0u);
+    EXPECT_EQ(folders[0].parent, 0u);
+    EXPECT_EQ(folders[1].title, "Folder");
+    EXPECT_EQ(folders[1].parent, 0u);
+
+    // The separator is ignored
+    ASSERT_EQ(bookmarks.size(), 2u);
+    EXPECT_EQ(bookmarks[2].title, "Mozilla");
+    EXPECT_EQ(bookmarks[2].uri, "https://www.mozilla.org/");
+    EXPECT_EQ(bookmarks[2].parent, 1u);
+    EXPECT_EQ(bookmarks[4].title, "Search");
+    EXPECT_EQ(bookmarks[4].uri, "https://duckduckgo.com/?q=%s");
+    EXPECT_EQ(bookmarks[4].parent, 0u);
+
+    // Parsing again replaces the nodes with the same identifiers
+    bookmarks[2].title = "old";
+    ASSERT_TRUE(loader.parse(EXPORT, strlen(EXPORT), bookmarks, folders));
+    EXPECT_EQ(bookmarks[2].title, "Mozilla");
+    EXPECT_EQ(bookmarks.size(), 2u);
+}
+
+//------------------------------------------------------------------------------
+TEST(Loader, Escapes)
+{
+    EXPECT_EQ(bookmark(R"("title":"a\"b\\c\/d\be\ff\ng\rh\ti","uri":"u")"),
+              "a\"b\\c/d\be\ff\ng\rh\ti");
+    EXPECT_EQ(bookmark(R"("title":"caf\u00e9 \u20AC","uri":"u")"), "caf\xc3\xa9 \xe2\x82\xac");
+    EXPECT_EQ(bookmark(R"json("title":"x","uri":"javascript:alert(\"x\")")json", true),
+              "javascript:alert(\"x\")");
+}
+
+//------------------------------------------------------------------------------
+TEST(Loader, SurrogatePairs)
+{
+    // U+1F600 is encoded in UTF-16 as D83D DE00, in UTF-8 as F0 9F 98 80
+    EXPECT_EQ(bookmark(R"("title":"\ud83d\ude00!","uri":"u")"), "\xf0\x9f\x98\x80!");
+    EXPECT_EQ(bookmark(R"("title":"\uD834\uDD1E","uri":"u")"), "\xf0\x9d\x84\x9e");
+}
+
+//------------------------------------------------------------------------------
+TEST(Loader, NullMembers)
+{
+    // A null title or URI is a missing one: no bookmark
+    EXPECT_EQ(bookmark(R"("title":null,"uri":"u")"), "<none>");
+    EXPECT_EQ(bookmark(R"("title":"t","uri":null)"), "<none>");
+    EXPECT_EQ(bookmark(R"("title" : null , "uri":"u", "title":"t")"), "t");
+
+    // A folder with a null title keeps an empty one
+    const std::string text = R"({"id":1,"title":null,"children":[]})";
+    std::map<int, Bookmark> bookmarks;
+    std::map<int, Folder> folders;
+    BookmarkLoader loader;
+    ASSERT_TRUE(loader.parse(text.data(), text.size(), bookmarks, folders));
+    ASSERT_EQ(folders.size(), 1u);
+    EXPECT_EQ(folders[0].title, "");
+}
+
+//------------------------------------------------------------------------------
+//! \brief Return true if the parse failed and left the collections as they
+//! were.
+//------------------------------------------------------------------------------
+static bool rejected(std::string const& text)
+{
+    std::map<int, Bookmark> bookmarks;
+    std::map<int, Folder> folders;
+    bookmarks[100] = { "kept", "https://kept/", 100u, 0u };
+    folders[200] = { "kept", 200u, 0u };
+
+    BookmarkLoader loader;
+    const bool parsed = loader.parse(text.data(), text.size(), bookmarks, folders);
+    return !parsed && !loader.error().empty() &&
+           (bookmarks.size() == 1u) && (bookmarks[100].title == "kept") &&
+           (folders.size() == 1u) && (folders[200].title == "kept");
+}
+
+//------------------------------------------------------------------------------
+TEST(Loader, Truncated)
+{
+    // Each strict prefix of the export is rejected
+    const std::string text(EXPORT);
+    for (size_t size = 0u; size < text.size(); ++size)
+    {
+        EXPECT_TRUE(rejected(text.substr(0u, size))) << "prefix of " << size << " bytes";
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST(Loader, Invalid)
+{
+    EXPECT_TRUE(rejected(R"([{"id":1}])"));
+    EXPECT_TRUE(rejected(R"({"id":1,"children":[{"title":"no id","uri":"u"}]})"));
+    EXPECT_TRUE(rejected(R"({"id":null,"children":[]})"));
+    EXPECT_TRUE(rejected(R"({"id":1,"title":"\q","children":[]})"));
+    EXPECT_TRUE(rejected(R"({"id":1,"title":"\u12G4","children":[]})"));
+    EXPECT_TRUE(rejected(R"({"id":1,"title":"\u12","children":[]})"));
+    EXPECT_TRUE(rejected(R"({"id":1 "children":[]})"));
+    EXPECT_TRUE(rejected(R"({"id":1,"children":[],})"));
+    EXPECT_TRUE(rejected(R"({"id":1,"skipped":,"children":[]})"));
+}
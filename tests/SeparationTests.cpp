@@ -0,0 +1,129 @@
+/* *****************************************************************************
+** MIT License
+**
+** Copyright (c) 2022 Quentin Quadrat
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+********************************************************************************
+*/
+
+#include "ForceDirectedGraph.hpp"
+#include "LayoutMetrics.hpp"
+#include "Trees.hpp"
+#include <gtest/gtest.h>
+#include <cmath>
+
+// *****************************************************************************
+//! \brief Edge crossings of a layout before and after separate().
+// *****************************************************************************
+struct Separation
+{
+    size_t before;
+    size_t after;
+};
+
+//------------------------------------------------------------------------------
+//! \brief Run the layout of the given tree until convergence (or the given
+//! number of steps), then remove overlaps. Check that no vertices overlap
+//! anymore.
+//------------------------------------------------------------------------------
+static Separation separate(Corpus::Shape const shape, size_t const count, size_t const steps)
+{
+    DiGraph const graph = tree(shape, count);
+    ForceDirectedGraph layout(sf::Vector2f(WINDOWS_WIDTH, WINDOWS_HEIGHT), graph);
+    layout.reset();
+    for (size_t step = 0u; (step < steps) && !layout.converged(); ++step)
+    {
+        layout.update();
+    }
+
+    LayoutMetrics<2u> metrics;
+    Separation separation;
+    separation.before = metrics.measure(layout).crossings;
+    EXPECT_EQ(layout.separate(), 0u);
+    EXPECT_EQ(metrics.measure(layout).overlaps, 0u);
+    separation.after = metrics.metrics().crossings;
+    return separation;
+}
+
+//------------------------------------------------------------------------------
+//! \brief Relative positions are kept: a converged layout gains a few edge
+//! crossings only (a quarter more, plus one for ten vertices for the leaves
+//! stacked on the same place, whose order is unknown). Large enough for the
+//! converged layout to be far denser than the loosely packed one.
+//------------------------------------------------------------------------------
+static void converged(Corpus::Shape const shape)
+{
+    const size_t count = 5000u;
+    Separation const separation = separate(shape, count, 1000u);
+    EXPECT_LE(separation.after, separation.before + separation.before / 4u + count / 10u);
+}
+
+//------------------------------------------------------------------------------
+TEST(Separation, Flat)
+{
+    converged(Corpus::Shape::Flat);
+}
+
+//------------------------------------------------------------------------------
+TEST(Separation, Deep)
+{
+    converged(Corpus::Shape::Deep);
+}
+
+//------------------------------------------------------------------------------
+TEST(Separation, Balanced)
+{
+    converged(Corpus::Shape::Balanced);
+}
+
+//------------------------------------------------------------------------------
+TEST(Separation, PowerLaw)
+{
+    converged(Corpus::Shape::PowerLaw);
+}
+
+//------------------------------------------------------------------------------
+//! \brief Early stop: vertices are stacked and crowded in a small part of the
+//! window. They shall be spread to not overlap anymore.
+//------------------------------------------------------------------------------
+TEST(Separation, Unconverged)
+{
+    separate(Corpus::Shape::Deep, 5000u, 20u);
+}
+
+//------------------------------------------------------------------------------
+//! \brief More vertices than the window can hold: the diameter shrinks to
+//! the loosely packed one.
+//------------------------------------------------------------------------------
+TEST(Separation, Crowded)
+{
+    const size_t count = 20000u;
+    DiGraph const graph = tree(Corpus::Shape::PowerLaw, count);
+    ForceDirectedGraph layout(sf::Vector2f(WINDOWS_WIDTH, WINDOWS_HEIGHT), graph);
+    layout.reset();
+    EXPECT_GT(layout.separate(), 0u);
+
+    const float room = (WINDOWS_WIDTH - 2.0f * LAYOUT_BORDER_X) * (WINDOWS_HEIGHT - 2.0f * LAYOUT_BORDER_Y);
+    const float packing = 0.6f; // ForceDirectedLayout::SEPARATION_PACKING
+    const float diameter = packing * std::sqrt(room / float(count));
+    ASSERT_LT(diameter, 2.0f * NODE_RADIUS);
+    LayoutMetrics<2u> metrics(32u, 0.5f * diameter);
+    EXPECT_EQ(metrics.measure(layout).overlaps, 0u);
+}
@@ -0,0 +1,188 @@
+/* *****************************************************************************
+** MIT License
+**
+** Copyright (c) 2022 Quentin Quadrat
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+********************************************************************************
+*/
+
+#include "IslandSnapshot.hpp"
+#include "Corpus.hpp"
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+//! \brief Sections of the snapshot file (see IslandSnapshot.cpp).
+enum Section { Ids, Order, Parents, Kinds, Offsets, Destinations };
+//! \brief Offset of the table of sections in the header: magic, version
+//! then seven 64-bit counts.
+static constexpr size_t SECTIONS_OFFSET = 2u * sizeof(uint32_t) + 7u * sizeof(uint64_t);
+
+// *****************************************************************************
+//! \brief Snapshot of a synthetic tree of bookmarks saved in a temporary
+//! file, whose bytes can be altered before opening it again.
+// *****************************************************************************
+class Snapshot: public testing::Test
+{
+protected:
+
+    void SetUp() override
+    {
+        std::vector<Folder> folders;
+        std::vector<Bookmark> bookmarks;
+        Corpus::generate(Corpus::Shape::Balanced, 500u, 42u, folders, bookmarks);
+
+        DiGraphBuilder builder;
+        for (auto const& folder: folders)
+        {
+            builder.add_edge(folder.parent, folder.id);
+            m_folders[int(folder.id)] = folder;
+        }
+        for (auto const& bookmark: bookmarks)
+        {
+            builder.add_edge(bookmark.parent, bookmark.id);
+            m_bookmarks[int(bookmark.id)] = bookmark;
+        }
+        m_digraph = builder.build();
+        m_subtrees.build(m_digraph, m_bookmarks, m_folders);
+
+        m_path = testing::TempDir() + "islanded.snapshot";
+        ASSERT_TRUE(IslandSnapshot::save(m_path, STAMP, m_digraph, m_subtrees));
+        std::ifstream file(m_path, std::ios::binary);
+        m_bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    void TearDown() override
+    {
+        std::remove(m_path.c_str());
+    }
+
+    //! \brief Pointer on the given 32-bit element of a section.
+    uint32_t* element(Section const section, size_t const i)
+    {
+        uint64_t offset;
+        memcpy(&offset, m_bytes.data() + SECTIONS_OFFSET + size_t(section) * sizeof(uint64_t),
+               sizeof(uint64_t));
+        return reinterpret_cast<uint32_t*>(m_bytes.data() + offset) + i;
+    }
+
+    //! \brief Write the altered bytes back. If sealed, update the checksum
+    //! as the writer of a forged file would.
+    void write(bool const sealed)
+    {
+        const size_t payload = m_bytes.size() - sizeof(uint64_t);
+        if (sealed)
+        {
+            uint64_t hash = 0xcbf29ce484222325ull;
+            for (size_t i = 0u; i < payload; i += sizeof(uint64_t))
+            {
+                uint64_t word;
+                memcpy(&word, m_bytes.data() + i, sizeof(uint64_t));
+                hash = (hash ^ word) * 0x100000001b3ull;
+            }
+            memcpy(m_bytes.data() + payload, &hash, sizeof(uint64_t));
+        }
+        std::ofstream file(m_path, std::ios::binary | std::ios::trunc);
+        file.write(m_bytes.data(), std::streamsize(m_bytes.size()));
+    }
+
+protected:
+
+    static constexpr uint64_t STAMP = 1234u;
+    std::map<int, Bookmark> m_bookmarks;
+    std::map<int, Folder> m_folders;
+    DiGraph m_digraph;
+    SubtreeIndex m_subtrees;
+    std::string m_path;
+    std::vector<char> m_bytes;
+};
+
+//------------------------------------------------------------------------------
+TEST_F(Snapshot, Open)
+{
+    IslandSnapshot island;
+    ASSERT_TRUE(island.open(m_path, STAMP)) << island.error();
+    DiGraph const& graph = island.graph();
+    ASSERT_EQ(graph.size(), m_digraph.size());
+    ASSERT_EQ(graph.edges(), m_digraph.edges());
+    for (DiGraph::Index n = 0u; n < graph.size(); ++n)
+    {
+        EXPECT_EQ(graph.index(m_digraph.id(n)), n);
+        EXPECT_EQ(graph.parent(n), m_digraph.parent(n));
+        EXPECT_EQ(island.subtrees().kind(n), m_subtrees.kind(n));
+    }
+    EXPECT_FALSE(island.open(m_path, STAMP + 1u));
+}
+
+//------------------------------------------------------------------------------
+TEST_F(Snapshot, Checksum)
+{
+    *element(Destinations, 0u) ^= 1u;
+    write(false);
+    IslandSnapshot island;
+    EXPECT_FALSE(island.open(m_path, STAMP));
+    EXPECT_EQ(island.graph().size(), 0u);
+}
+
+//------------------------------------------------------------------------------
+TEST_F(Snapshot, DestinationOutOfRange)
+{
+    *element(Destinations, 3u) = uint32_t(m_digraph.size());
+    write(true);
+    IslandSnapshot island;
+    EXPECT_FALSE(island.open(m_path, STAMP));
+    EXPECT_EQ(island.error(), m_path + ": inconsistent snapshot");
+}
+
+//------------------------------------------------------------------------------
+TEST_F(Snapshot, DecreasingOffsets)
+{
+    std::swap(*element(Offsets, 1u), *element(Offsets, 2u));
+    ASSERT_NE(*element(Offsets, 1u), *element(Offsets, 2u));
+    write(true);
+    IslandSnapshot island;
+    EXPECT_FALSE(island.open(m_path, STAMP));
+}
+
+//------------------------------------------------------------------------------
+TEST_F(Snapshot, ParentOutOfRange)
+{
+    *element(Parents, 5u) = uint32_t(m_digraph.size()) + 1u;
+    write(true);
+    IslandSnapshot island;
+    EXPECT_FALSE(island.open(m_path, STAMP));
+}
+
+//------------------------------------------------------------------------------
+TEST_F(Snapshot, UnsortedOrder)
+{
+    std::swap(*element(Order, 10u), *element(Order, 11u));
+    write(true);
+    IslandSnapshot island;
+    EXPECT_FALSE(island.open(m_path, STAMP));
+
+    // Sorted but not a permutation
+    std::swap(*element(Order, 10u), *element(Order, 11u));
+    *element(Order, 11u) = *element(Order, 10u);
+    write(true);
+    EXPECT_FALSE(island.open(m_path, STAMP));
+}
@@ -0,0 +1,89 @@
+/* *****************************************************************************
+** MIT License
+**
+** Copyright (c) 2022 Quentin Quadrat
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+********************************************************************************
+*/
+
+#include "SubtreeIndex.hpp"
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+
+//------------------------------------------------------------------------------
+//! \brief Words given by /bin/sh for the given quoted URLs, one per line.
+//------------------------------------------------------------------------------
+static std::string shell(std::string const& urls)
+{
+    const std::string path = testing::TempDir() + "urls.txt";
+    const std::string command = "printf '%s\\n'" + urls + " > " + path;
+    EXPECT_EQ(std::system(command.c_str()), 0);
+    std::ifstream file(path);
+    std::string words((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::remove(path.c_str());
+    return words;
+}
+
+//------------------------------------------------------------------------------
+TEST(SubtreeIndex, QuotedForTheShell)
+{
+    const std::vector<std::string> urls =
+    {
+        "https://example.com/?a=1&b=2",
+        "javascript:alert(\"x\")",
+        "javascript:alert('x')",
+        "http://$(touch /tmp/pwned)/`id`;ls|cat>x",
+        "'", "", "\\'\\\\",
+    };
+
+    std::string quoted, expected;
+    for (auto const& url: urls)
+    {
+        std::string one;
+        SubtreeIndex::quote(one, url);
+        EXPECT_EQ(SubtreeIndex::unquote(SubtreeIndex::Slice(one.data(), one.size())), url);
+        quoted += one;
+        expected += url + "\n";
+    }
+    EXPECT_EQ(shell(quoted), expected);
+}
+
+//------------------------------------------------------------------------------
+TEST(SubtreeIndex, QuotedURLs)
+{
+    DiGraphBuilder builder;
+    builder.add_edge(1u, 2u);
+    builder.add_edge(1u, 3u);
+    DiGraph const graph = builder.build();
+
+    std::map<int, Folder> folders;
+    folders[1] = { "folder", 1u, 1u };
+    std::map<int, Bookmark> bookmarks;
+    bookmarks[2] = { "a", "http://a/\"$(x)\"", 2u, 1u };
+    bookmarks[3] = { "b", "http://b/'", 3u, 1u };
+
+    SubtreeIndex index;
+    index.build(graph, bookmarks, folders);
+    SubtreeIndex::Slice const urls = index.urls(graph.index(1u));
+    EXPECT_EQ(shell(std::string(urls.data(), urls.size())), "http://a/\"$(x)\"\nhttp://b/'\n");
+}
@@ -0,0 +1,55 @@
+/* *****************************************************************************
+** MIT License
+**
+** Copyright (c) 2022 Quentin Quadrat
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+********************************************************************************
+*/
+
+#ifndef TREES_HPP
+#  define TREES_HPP
+
+#  include "Corpus.hpp"
+#  include "Graph.hpp"
+
+// -----------------------------------------------------------------------------
+//! \brief Generate a synthetic tree of bookmarks (see Corpus) and return its
+//! graph, built the same way than IslandedBrowser::createGraph().
+// -----------------------------------------------------------------------------
+inline DiGraph tree(Corpus::Shape const shape, size_t const count, uint64_t const seed = 42u)
+{
+    std::vector<Folder> folders;
+    std::vector<Bookmark> bookmarks;
+    Corpus::generate(shape, count, seed, folders, bookmarks);
+
+    DiGraphBuilder builder;
+    builder.reserve(count + 1u, count);
+    for (auto const& folder: folders)
+    {
+        builder.add_edge(folder.parent, folder.id);
+    }
+    for (auto const& bookmark: bookmarks)
+    {
+        builder.add_edge(bookmark.parent, bookmark.id);
+    }
+    return builder.build();
+}
+
+#endif